@@ -392,6 +392,7 @@ static int __al_write_transaction(struct drbd_device *device, struct al_transact
 			} else {
 				device->al_tr_number++;
 				device->al_writ_cnt++;
+				device->al_upd_cnt += be16_to_cpu(buffer->n_updates);
 			}
 		}
 	}
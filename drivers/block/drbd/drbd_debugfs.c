@@ -715,6 +715,57 @@ static int device_oldest_requests_show(struct seq_file *m, void *ignored)
 	return 0;
 }
 
+static int device_resync_stats_show(struct seq_file *m, void *ignored)
+{
+	struct drbd_device *device = m->private;
+	union drbd_state state = drbd_read_state(device);
+	unsigned long now = jiffies;
+	unsigned long rs_left, db, dt;
+	int i;
+
+	/* BUMP me if you change the file format/content/presentation */
+	seq_printf(m, "v: %u\n\n", 0);
+
+	if (!get_ldev_if_state(device, D_FAILED))
+		return 0;
+
+	if (state.conn == C_VERIFY_S || state.conn == C_VERIFY_T)
+		rs_left = device->ov_left;
+	else
+		rs_left = drbd_bm_total_weight(device) - device->rs_failed;
+	if (rs_left > device->rs_total)
+		rs_left = device->rs_total;
+
+	seq_printf(m, "total_kb\t%lu\n", (unsigned long)Bit2KB(device->rs_total));
+	seq_printf(m, "left_kb\t%lu\n", (unsigned long)Bit2KB(rs_left));
+	seq_printf(m, "failed_kb\t%lu\n", (unsigned long)Bit2KB(device->rs_failed));
+	seq_printf(m, "same_csum_kb\t%lu\n", (unsigned long)Bit2KB(device->rs_same_csum));
+	seq_printf(m, "in_flight_kb\t%d\n", device->rs_in_flight / 2);
+	seq_printf(m, "pending\t%d\n", atomic_read(&device->rs_pending_cnt));
+
+	/* same ~3s window drbd_rs_should_slow_down() looks at */
+	i = (device->rs_last_mark + DRBD_SYNC_MARKS - 1) % DRBD_SYNC_MARKS;
+	dt = (now - device->rs_mark_time[i]) / HZ;
+	db = device->rs_mark_left[i] - rs_left;
+	seq_printf(m, "speed_kbps\t%lu\n", (unsigned long)Bit2KB(db / (dt ?: 1)));
+
+	/* mean speed since resync started, PausedSync periods excluded */
+	dt = (now - device->rs_start - device->rs_paused) / HZ;
+	db = device->rs_total - rs_left;
+	seq_printf(m, "avg_speed_kbps\t%lu\n", (unsigned long)Bit2KB(db / (dt ?: 1)));
+	seq_printf(m, "want_kbps\t%d\n", device->c_sync_rate);
+
+	seq_printf(m, "requests\t%lu\n", device->rs_req_cnt);
+	seq_printf(m, "avg_request_kb\t%lu\n", device->rs_req_cnt ?
+		   (unsigned long)Bit2KB(device->rs_req_bits) / device->rs_req_cnt : 0);
+
+	seq_printf(m, "al_writes\t%u\n", device->al_writ_cnt);
+	seq_printf(m, "al_updates\t%u\n", device->al_upd_cnt);
+
+	put_ldev(device);
+	return 0;
+}
+
 static int device_data_gen_id_show(struct seq_file *m, void *ignored)
 {
 	struct drbd_device *device = m->private;
@@ -765,6 +816,7 @@ static const struct file_operations device_ ## name ## _fops = {		\
 drbd_debugfs_device_attr(oldest_requests)
 drbd_debugfs_device_attr(act_log_extents)
 drbd_debugfs_device_attr(resync_extents)
+drbd_debugfs_device_attr(resync_stats)
 drbd_debugfs_device_attr(data_gen_id)
 drbd_debugfs_device_attr(ed_gen_id)
 
@@ -803,6 +855,7 @@ void drbd_debugfs_device_add(struct drbd_device *device)
 	DCF(oldest_requests);
 	DCF(act_log_extents);
 	DCF(resync_extents);
+	DCF(resync_stats);
 	DCF(data_gen_id);
 	DCF(ed_gen_id);
 #undef DCF
@@ -819,6 +872,7 @@ void drbd_debugfs_device_cleanup(struct drbd_device *device)
 	drbd_debugfs_remove(&device->debugfs_vol_oldest_requests);
 	drbd_debugfs_remove(&device->debugfs_vol_act_log_extents);
 	drbd_debugfs_remove(&device->debugfs_vol_resync_extents);
+	drbd_debugfs_remove(&device->debugfs_vol_resync_stats);
 	drbd_debugfs_remove(&device->debugfs_vol_data_gen_id);
 	drbd_debugfs_remove(&device->debugfs_vol_ed_gen_id);
 	drbd_debugfs_remove(&device->debugfs_vol);
@@ -824,6 +824,7 @@ struct drbd_device {
 	struct dentry *debugfs_vol_oldest_requests;
 	struct dentry *debugfs_vol_act_log_extents;
 	struct dentry *debugfs_vol_resync_extents;
+	struct dentry *debugfs_vol_resync_stats;
 	struct dentry *debugfs_vol_data_gen_id;
 	struct dentry *debugfs_vol_ed_gen_id;
 #endif
@@ -862,6 +863,7 @@ struct drbd_device {
 	unsigned int read_cnt;
 	unsigned int writ_cnt;
 	unsigned int al_writ_cnt;
+	unsigned int al_upd_cnt; /* extent updates carried by those transactions */
 	unsigned int bm_writ_cnt;
 	atomic_t ap_bio_cnt;	 /* Requests we need to complete */
 	atomic_t ap_actlog_cnt;  /* Requests waiting for activity log */
@@ -892,6 +894,9 @@ struct drbd_device {
 	unsigned long rs_paused;
 	/* skipped because csum was equal [unit BM_BLOCK_SIZE] */
 	unsigned long rs_same_csum;
+	/* resync requests sent in this run, and their size [unit BM_BLOCK_SIZE] */
+	unsigned long rs_req_cnt;
+	unsigned long rs_req_bits;
 #define DRBD_SYNC_MARKS 8
 #define DRBD_SYNC_MARK_STEP (3*HZ)
 	/* block not up-to-date at mark [unit BM_BLOCK_SIZE] */
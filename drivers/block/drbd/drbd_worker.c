@@ -727,6 +727,8 @@ static int make_resync_request(struct drbd_device *const device, int cancel)
 				goto requeue;
 			case 0:
 				/* everything ok */
+				device->rs_req_cnt++;
+				device->rs_req_bits += DIV_ROUND_UP(size, BM_BLOCK_SIZE);
 				break;
 			default:
 				BUG();
@@ -744,6 +746,8 @@ static int make_resync_request(struct drbd_device *const device, int cancel)
 				put_ldev(device);
 				return err;
 			}
+			device->rs_req_cnt++;
+			device->rs_req_bits += DIV_ROUND_UP(size, BM_BLOCK_SIZE);
 		}
 	}
 
@@ -1825,6 +1829,8 @@ void drbd_start_resync(struct drbd_device *device, enum drbd_conns side)
 		device->rs_failed    = 0;
 		device->rs_paused    = 0;
 		device->rs_same_csum = 0;
+		device->rs_req_cnt   = 0;
+		device->rs_req_bits  = 0;
 		device->rs_last_sect_ev = 0;
 		device->rs_total     = tw;
 		device->rs_start     = now;
@@ -352,6 +352,14 @@ struct cached_dev {
 	struct closure_waitlist writeback_ordering_wait;
 	atomic_t		writeback_sequence_next;
 
+	/* Writeback statistics, see update_writeback_bandwidth() */
+	atomic_long_t		writeback_sectors_done;
+	unsigned long		writeback_sectors_last;
+	unsigned long		writeback_bandwidth_last;	/* jiffies */
+	uint64_t		writeback_bandwidth;		/* sectors/sec */
+	unsigned long		writeback_keys_issued;
+	unsigned long		writeback_keys_contiguous;
+
 	/* For tracking sequential IO */
 #define RECENT_IO_BITS	7
 #define RECENT_IO	(1 << RECENT_IO_BITS)
@@ -704,6 +712,8 @@ struct cache_set {
 	struct time_stats	btree_read_time;
 
 	atomic_long_t		cache_read_races;
+	/* Result of the last internal/btree_lookup_bench run */
+	unsigned long		btree_lookup_rate;
 	atomic_long_t		writeback_keys_done;
 	atomic_long_t		writeback_keys_failed;
 
@@ -1111,6 +1111,14 @@ static struct bkey *__bch_btree_iter_init(struct btree_keys *b,
 #endif
 
 	for (; start <= bset_tree_last(b); start++) {
+		/*
+		 * The searches of the individual sets don't depend on each
+		 * other: get the next set's auxiliary search tree moving in
+		 * while we walk this one.
+		 */
+		if (start < bset_tree_last(b) && start[1].size > 1 << 4)
+			prefetch(&start[1].tree[1 << 4]);
+
 		ret = bch_bset_search(b, start, search);
 		bch_btree_iter_push(iter, ret, bset_bkey_last(start->data));
 	}
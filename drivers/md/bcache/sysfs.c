@@ -16,6 +16,8 @@
 #include <linux/blkdev.h>
 #include <linux/sort.h>
 #include <linux/sched/clock.h>
+#include <linux/sched/signal.h>
+#include <linux/random.h>
 
 extern bool bcache_is_reboot;
 
@@ -95,6 +97,7 @@ read_attribute(feature_incompat);
 
 read_attribute(state);
 read_attribute(cache_read_races);
+rw_attribute(btree_lookup_bench);
 read_attribute(reclaim);
 read_attribute(reclaimed_journal_buckets);
 read_attribute(flush_write);
@@ -123,6 +126,8 @@ rw_attribute(writeback_rate_i_term_inverse);
 rw_attribute(writeback_rate_p_term_inverse);
 rw_attribute(writeback_rate_minimum);
 read_attribute(writeback_rate_debug);
+read_attribute(writeback_bandwidth);
+read_attribute(writeback_merge_ratio);
 
 read_attribute(stripe_size);
 read_attribute(partial_stripes_expensive);
@@ -245,6 +250,15 @@ SHOW(__bch_cached_dev)
 			       integral, change, next_io);
 	}
 
+	sysfs_hprint(writeback_bandwidth,
+		     wb ? dc->writeback_bandwidth << 9 : 0);
+	/* Percentage of written back keys contiguous with the previous one */
+	sysfs_print(writeback_merge_ratio,
+		    dc->writeback_keys_issued
+		    ? dc->writeback_keys_contiguous * 100 /
+		      dc->writeback_keys_issued
+		    : 0);
+
 	sysfs_hprint(dirty_data,
 		     bcache_dev_sectors_dirty(&dc->disk) << 9);
 
@@ -504,6 +518,8 @@ static struct attribute *bch_cached_dev_files[] = {
 	&sysfs_writeback_rate_p_term_inverse,
 	&sysfs_writeback_rate_minimum,
 	&sysfs_writeback_rate_debug,
+	&sysfs_writeback_bandwidth,
+	&sysfs_writeback_merge_ratio,
 	&sysfs_io_errors,
 	&sysfs_io_error_limit,
 	&sysfs_io_disable,
@@ -634,6 +650,75 @@ static int bch_bset_print_stats(struct cache_set *c, char *buf)
 			op.stats.floats, op.stats.failed);
 }
 
+struct lookup_bench_op {
+	struct btree_op op;
+	size_t keys;
+};
+
+static int bch_btree_lookup_bench_fn(struct btree_op *b_op, struct btree *b,
+				     struct bkey *k)
+{
+	struct lookup_bench_op *op = container_of(b_op,
+					struct lookup_bench_op, op);
+
+	op->keys++;
+	return MAP_DONE;
+}
+
+/* Upper bound on the lookups done by one btree_lookup_bench write */
+#define BCH_LOOKUP_BENCH_MAX	(1UL << 24)
+
+/*
+ * Time @nr read-locked point lookups of random keys, the same way
+ * cache_lookup() walks the btree for a read, and report lookups per second.
+ * Runs on the calling CPU only; pin the writer to measure a particular core.
+ *
+ * Called without bch_register_lock, so that a long run does not hold up
+ * registration; stops early if the cache set is being stopped.
+ */
+static int bch_btree_lookup_bench(struct cache_set *c, unsigned long nr)
+{
+	struct lookup_bench_op op;
+	unsigned int inodes = c->devices_max_used ?: 1;
+	uint64_t start, elapsed;
+	unsigned long i;
+	int ret = 0;
+
+	if (nr > BCH_LOOKUP_BENCH_MAX)
+		return -EINVAL;
+
+	memset(&op, 0, sizeof(op));
+
+	start = local_clock();
+	for (i = 0; i < nr; i++) {
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+		if (test_bit(CACHE_SET_STOPPING, &c->flags)) {
+			ret = -EBUSY;
+			break;
+		}
+
+		bch_btree_op_init(&op.op, -1);
+
+		ret = bch_btree_map_keys(&op.op, c,
+				&KEY(prandom_u32_max(inodes),
+				     (uint64_t) prandom_u32() << 9, 0),
+				bch_btree_lookup_bench_fn, MAP_END_KEY);
+		if (ret < 0)
+			break;
+
+		cond_resched();
+	}
+	elapsed = local_clock() - start;
+
+	c->btree_lookup_rate = div64_u64((uint64_t) i * NSEC_PER_SEC,
+					 elapsed ?: 1);
+
+	return ret < 0 ? ret : 0;
+}
+
 static unsigned int bch_root_usage(struct cache_set *c)
 {
 	unsigned int bytes = 0;
@@ -733,6 +818,7 @@ SHOW(__bch_cache_set)
 
 	sysfs_print(cache_read_races,
 		    atomic_long_read(&c->cache_read_races));
+	sysfs_print(btree_lookup_bench,	c->btree_lookup_rate);
 
 	sysfs_print(reclaim,
 		    atomic_long_read(&c->reclaim));
@@ -929,6 +1015,13 @@ STORE(bch_cache_set_internal)
 	if (bcache_is_reboot)
 		return -EBUSY;
 
+	/* May run for a long time, keep it out of bch_register_lock */
+	if (attr == &sysfs_btree_lookup_bench) {
+		int r = bch_btree_lookup_bench(c, strtoul_or_return(buf));
+
+		return r ? r : size;
+	}
+
 	return bch_cache_set_store(&c->kobj, attr, buf, size);
 }
 
@@ -977,6 +1070,7 @@ static struct attribute *bch_cache_set_internal_files[] = {
 
 	&sysfs_bset_tree_stats,
 	&sysfs_cache_read_races,
+	&sysfs_btree_lookup_bench,
 	&sysfs_reclaim,
 	&sysfs_reclaimed_journal_buckets,
 	&sysfs_flush_write,
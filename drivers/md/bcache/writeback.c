@@ -170,6 +170,21 @@ static bool set_at_max_writeback_rate(struct cache_set *c,
 	return true;
 }
 
+static void update_writeback_bandwidth(struct cached_dev *dc)
+{
+	unsigned long done = atomic_long_read(&dc->writeback_sectors_done);
+	unsigned long now = jiffies;
+	unsigned long elapsed = now - dc->writeback_bandwidth_last;
+
+	if (!elapsed)
+		return;
+
+	dc->writeback_bandwidth = div_u64((uint64_t)
+			(done - dc->writeback_sectors_last) * HZ, elapsed);
+	dc->writeback_sectors_last = done;
+	dc->writeback_bandwidth_last = now;
+}
+
 static void update_writeback_rate(struct work_struct *work)
 {
 	struct cached_dev *dc = container_of(to_delayed_work(work),
@@ -197,6 +212,8 @@ static void update_writeback_rate(struct work_struct *work)
 		return;
 	}
 
+	update_writeback_bandwidth(dc);
+
 	if (atomic_read(&dc->has_dirty) && dc->writeback_percent) {
 		/*
 		 * If the whole cache set is idle, set_at_max_writeback_rate()
@@ -302,6 +319,7 @@ static void write_dirty_finish(struct closure *cl)
 		atomic_long_inc(ret
 				? &dc->disk.c->writeback_keys_failed
 				: &dc->disk.c->writeback_keys_done);
+		atomic_long_add(KEY_SIZE(&w->key), &dc->writeback_sectors_done);
 	}
 
 	bch_keybuf_del(&dc->writeback_keys, w);
@@ -397,9 +415,9 @@ static void read_dirty_submit(struct closure *cl)
 static void read_dirty(struct cached_dev *dc)
 {
 	unsigned int delay = 0;
-	struct keybuf_key *next, *keys[MAX_WRITEBACKS_IN_PASS], *w;
-	size_t size;
-	int nk, i;
+	struct keybuf_key *next, *keys[MAX_WRITEBACKS_IN_PASS_IDLE], *w;
+	size_t size, max_size;
+	int nk, i, max_keys;
 	struct dirty_io *io;
 	struct closure cl;
 	uint16_t sequence = 0;
@@ -421,6 +439,21 @@ static void read_dirty(struct cached_dev *dc)
 		size = 0;
 		nk = 0;
 
+		/*
+		 * Passes are kept short so that the rate limiter can space
+		 * writeback out between foreground I/O. When the whole cache
+		 * set is idle the rate is unlimited anyway, so gather longer
+		 * contiguous runs and let the backing device see them back
+		 * to back.
+		 */
+		if (atomic_read(&dc->disk.c->at_max_writeback_rate)) {
+			max_keys = MAX_WRITEBACKS_IN_PASS_IDLE;
+			max_size = MAX_WRITESIZE_IN_PASS_IDLE;
+		} else {
+			max_keys = MAX_WRITEBACKS_IN_PASS;
+			max_size = MAX_WRITESIZE_IN_PASS;
+		}
+
 		do {
 			BUG_ON(ptr_stale(dc->disk.c, &next->key, 0));
 
@@ -428,14 +461,14 @@ static void read_dirty(struct cached_dev *dc)
 			 * Don't combine too many operations, even if they
 			 * are all small.
 			 */
-			if (nk >= MAX_WRITEBACKS_IN_PASS)
+			if (nk >= max_keys)
 				break;
 
 			/*
 			 * If the current operation is very large, don't
 			 * further combine operations.
 			 */
-			if (size >= MAX_WRITESIZE_IN_PASS)
+			if (size >= max_size)
 				break;
 
 			/*
@@ -455,7 +488,10 @@ static void read_dirty(struct cached_dev *dc)
 			keys[nk++] = next;
 		} while ((next = bch_keybuf_next(&dc->writeback_keys)));
 
-		/* Now we have gathered a set of 1..5 keys to write back. */
+		dc->writeback_keys_issued += nk;
+		dc->writeback_keys_contiguous += nk - 1;
+
+		/* Now we have gathered a set of 1..max_keys keys to write back. */
 		for (i = 0; i < nk; i++) {
 			w = keys[i];
 
@@ -977,6 +1013,8 @@ void bch_cached_dev_writeback_init(struct cached_dev *dc)
 	dc->writeback_rate_p_term_inverse = 40;
 	dc->writeback_rate_i_term_inverse = 10000;
 
+	dc->writeback_bandwidth_last	= jiffies;
+
 	WARN_ON(test_and_clear_bit(BCACHE_DEV_WB_RUNNING, &dc->disk.flags));
 	INIT_DELAYED_WORK(&dc->writeback_rate_update, update_writeback_rate);
 }
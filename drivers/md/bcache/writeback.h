@@ -11,6 +11,10 @@
 #define MAX_WRITEBACKS_IN_PASS  5
 #define MAX_WRITESIZE_IN_PASS   5000	/* *512b */
 
+/* Limits used instead while the whole cache set is idle */
+#define MAX_WRITEBACKS_IN_PASS_IDLE	32
+#define MAX_WRITESIZE_IN_PASS_IDLE	32768	/* *512b */
+
 #define WRITEBACK_RATE_UPDATE_SECS_MAX		60
 #define WRITEBACK_RATE_UPDATE_SECS_DEFAULT	5
 
@@ -37,25 +37,37 @@ static void array_insert(void *base, size_t elt_size, unsigned nr_elts,
 
 /*----------------------------------------------------------------*/
 
-/* makes the assumption that no two keys are the same. */
+/*
+ * makes the assumption that no two keys are the same.
+ *
+ * Narrows down to the last key not above 'key' without an early exit on
+ * equality, so the halving step is a conditional move rather than a
+ * branch on the key that mispredicts about every other level.
+ */
 static int bsearch(struct btree_node *n, uint64_t key, int want_hi)
 {
-	int lo = -1, hi = le32_to_cpu(n->header.nr_entries);
+	int len = le32_to_cpu(n->header.nr_entries);
+	__le64 *base = n->keys;
+	int lo;
 
-	while (hi - lo > 1) {
-		int mid = lo + ((hi - lo) / 2);
-		uint64_t mid_key = le64_to_cpu(n->keys[mid]);
+	if (!len)
+		return want_hi ? 0 : -1;
 
-		if (mid_key == key)
-			return mid;
+	while (len > 1) {
+		int half = len / 2;
 
-		if (mid_key < key)
-			lo = mid;
-		else
-			hi = mid;
+		if (le64_to_cpu(base[half]) <= key)
+			base += half;
+		len -= half;
 	}
 
-	return want_hi ? hi : lo;
+	lo = base - n->keys;
+	if (le64_to_cpu(*base) == key)
+		return lo;
+	if (le64_to_cpu(*base) > key)
+		lo--;
+
+	return want_hi ? lo + 1 : lo;
 }
 
 int lower_bound(struct btree_node *n, uint64_t key)
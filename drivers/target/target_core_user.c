@@ -161,6 +161,15 @@ struct tcmu_dev {
 	char dev_config[TCMU_CONFIG_LEN];
 
 	int nl_reply_supported;
+
+	/* Ring entries queued since userspace was last woken up */
+	bool notify_pending;
+
+	/* Ring statistics, protected by cmdr_lock */
+	u64 ring_cmds;
+	u64 ring_wakeups;
+	u64 ring_completions;
+	u64 ring_completion_batches;
 };
 
 #define TCMU_DEV(_se_dev) container_of(_se_dev, struct tcmu_dev, se_dev)
@@ -973,6 +982,21 @@ static uint32_t ring_insert_padding(struct tcmu_dev *udev, size_t cmd_size)
 	return cmd_head;
 }
 
+/*
+ * Wake up userspace once for all entries queued to the ring since the last
+ * wakeup, instead of once per entry.  Must be called with cmdr_lock held by
+ * every path that queues to the ring, before dropping the lock.
+ */
+static void tcmu_notify_ring(struct tcmu_dev *udev)
+{
+	if (!udev->notify_pending)
+		return;
+
+	udev->notify_pending = false;
+	udev->ring_wakeups++;
+	uio_event_notify(&udev->uio_info);
+}
+
 /**
  * queue_cmd_ring - queue cmd to ring or internally
  * @tcmu_cmd: cmd to queue
@@ -1100,8 +1124,8 @@ static int queue_cmd_ring(struct tcmu_cmd *tcmu_cmd, sense_reason_t *scsi_err)
 
 	list_add_tail(&tcmu_cmd->queue_entry, &udev->inflight_queue);
 
-	/* TODO: only if FLUSH and FUA? */
-	uio_event_notify(&udev->uio_info);
+	udev->ring_cmds++;
+	udev->notify_pending = true;
 
 	return 0;
 
@@ -1164,7 +1188,7 @@ queue_tmr_ring(struct tcmu_dev *udev, struct tcmu_tmr *tmr)
 	UPDATE_HEAD(mb->cmd_head, cmd_size, udev->cmdr_size);
 	tcmu_flush_dcache_range(mb, sizeof(*mb));
 
-	uio_event_notify(&udev->uio_info);
+	udev->notify_pending = true;
 
 out_free:
 	kfree(tmr);
@@ -1192,6 +1216,7 @@ tcmu_queue_cmd(struct se_cmd *se_cmd)
 		tcmu_free_cmd(tcmu_cmd);
 	else
 		se_cmd->priv = tcmu_cmd;
+	tcmu_notify_ring(udev);
 	mutex_unlock(&udev->cmdr_lock);
 	return scsi_ret;
 }
@@ -1286,6 +1311,7 @@ tcmu_tmr_notify(struct se_device *se_dev, enum tcm_tmreq_table tmf,
 	}
 
 	queue_tmr_ring(udev, tmr);
+	tcmu_notify_ring(udev);
 
 unlock:
 	mutex_unlock(&udev->cmdr_lock);
@@ -1438,13 +1464,17 @@ static bool tcmu_handle_completions(struct tcmu_dev *udev)
 		}
 
 		tcmu_handle_completion(cmd, entry);
+		udev->ring_completions++;
 
 		UPDATE_HEAD(udev->cmdr_last_cleaned,
 			    tcmu_hdr_get_len(entry->hdr.len_op),
 			    udev->cmdr_size);
 	}
-	if (free_space)
+	if (free_space) {
+		udev->ring_completion_batches++;
 		free_space = tcmu_run_tmr_queue(udev);
+		tcmu_notify_ring(udev);
+	}
 
 	if (atomic_read(&global_db_count) > tcmu_global_max_blocks &&
 	    idr_is_empty(&udev->commands) && list_empty(&udev->qfull_queue)) {
@@ -1637,6 +1667,8 @@ static void run_qfull_queue(struct tcmu_dev *udev, bool fail)
 		}
 	}
 
+	tcmu_notify_ring(udev);
+
 	tcmu_set_next_deadline(&udev->qfull_queue, &udev->qfull_timer);
 }
 
@@ -2515,6 +2547,29 @@ static ssize_t tcmu_max_data_area_mb_show(struct config_item *item, char *page)
 }
 CONFIGFS_ATTR_RO(tcmu_, max_data_area_mb);
 
+static ssize_t tcmu_ring_stats_show(struct config_item *item, char *page)
+{
+	struct se_dev_attrib *da = container_of(to_config_group(item),
+						struct se_dev_attrib, da_group);
+	struct tcmu_dev *udev = TCMU_DEV(da->da_dev);
+	ssize_t ret;
+
+	mutex_lock(&udev->cmdr_lock);
+	ret = snprintf(page, PAGE_SIZE,
+		       "cmds %llu\nwakeups %llu\ncmds_per_wakeup %llu\n"
+		       "completions %llu\ncompletion_batches %llu\n"
+		       "completions_per_batch %llu\n",
+		       udev->ring_cmds, udev->ring_wakeups,
+		       div64_u64(udev->ring_cmds, udev->ring_wakeups ?: 1),
+		       udev->ring_completions, udev->ring_completion_batches,
+		       div64_u64(udev->ring_completions,
+				 udev->ring_completion_batches ?: 1));
+	mutex_unlock(&udev->cmdr_lock);
+
+	return ret;
+}
+CONFIGFS_ATTR_RO(tcmu_, ring_stats);
+
 static ssize_t tcmu_dev_config_show(struct config_item *item, char *page)
 {
 	struct se_dev_attrib *da = container_of(to_config_group(item),
@@ -2826,6 +2881,7 @@ static struct configfs_attribute *tcmu_attrib_attrs[] = {
 	&tcmu_attr_cmd_time_out,
 	&tcmu_attr_qfull_time_out,
 	&tcmu_attr_max_data_area_mb,
+	&tcmu_attr_ring_stats,
 	&tcmu_attr_dev_config,
 	&tcmu_attr_dev_size,
 	&tcmu_attr_emulate_write_cache,
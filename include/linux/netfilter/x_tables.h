@@ -264,6 +264,9 @@ struct xt_table_info {
 	unsigned int stacksize;
 	void ***jumpstack;
 
+	/* Optional family private rule index, built when translating */
+	void *compiled;
+
 	unsigned char entries[] __aligned(8);
 };
 
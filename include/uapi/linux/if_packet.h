@@ -59,6 +59,7 @@ struct sockaddr_ll {
 #define PACKET_ROLLOVER_STATS		21
 #define PACKET_FANOUT_DATA		22
 #define PACKET_IGNORE_OUTGOING		23
+#define PACKET_FANOUT_STATS		24
 
 #define PACKET_FANOUT_HASH		0
 #define PACKET_FANOUT_LB		1
@@ -68,6 +69,7 @@ struct sockaddr_ll {
 #define PACKET_FANOUT_QM		5
 #define PACKET_FANOUT_CBPF		6
 #define PACKET_FANOUT_EBPF		7
+#define PACKET_FANOUT_FLOW		8
 #define PACKET_FANOUT_FLAG_ROLLOVER	0x1000
 #define PACKET_FANOUT_FLAG_UNIQUEID	0x2000
 #define PACKET_FANOUT_FLAG_DEFRAG	0x8000
@@ -81,6 +83,9 @@ struct tpacket_stats_v3 {
 	unsigned int	tp_packets;
 	unsigned int	tp_drops;
 	unsigned int	tp_freeze_q_cnt;
+	unsigned int	tp_blk_full_cnt;	/* blocks retired when full */
+	unsigned int	tp_blk_tmo_cnt;		/* blocks retired by the timer */
+	unsigned int	tp_snap_trunc_cnt;	/* packets clamped to the block */
 };
 
 struct tpacket_rollover_stats {
@@ -89,6 +94,16 @@ struct tpacket_rollover_stats {
 	__aligned_u64	tp_failed;
 };
 
+/* PACKET_FANOUT_FLOW: flows moved to and away from this member, and
+ * packets it took while full because their flow was not idle long
+ * enough, or still had unread packets here, to move.
+ */
+struct tpacket_fanout_stats {
+	__aligned_u64	tp_flows_in;
+	__aligned_u64	tp_flows_out;
+	__aligned_u64	tp_held;
+};
+
 union tpacket_stats_u {
 	struct tpacket_stats stats1;
 	struct tpacket_stats_v3 stats3;
@@ -128,6 +143,11 @@ struct tpacket_auxdata {
 
 /* Rx ring - feature request bits */
 #define TP_FT_REQ_FILL_RXHASH	0x1
+/* Wake the reader once per batch of full blocks rather than per block.
+ * The batch grows while blocks keep filling up and drops back to one
+ * when the retire timer closes a block, so the timer bounds the latency.
+ */
+#define TP_FT_REQ_BATCH_WAKEUP	0x2
 
 struct tpacket_hdr {
 	unsigned long	tp_status;
@@ -25,6 +25,13 @@
  * application.
  */
 #define XDP_USE_NEED_WAKEUP (1 << 3)
+/* If this option is set on the socket that owns the umem, the buffer
+ * pools of all sockets sharing the umem lend each other free frames: a
+ * pool whose fill ring is empty borrows frames that other pools took
+ * from their fill rings. Sockets bound with XDP_SHARED_UMEM take part
+ * without setting it themselves.
+ */
+#define XDP_SHARED_FILL (1 << 4)
 
 /* Flags for xsk_umem_config flags */
 #define XDP_UMEM_UNALIGNED_CHUNK_FLAG (1 << 0)
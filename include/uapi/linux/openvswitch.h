@@ -74,6 +74,11 @@ enum ovs_datapath_cmd {
  * datapath.  Always present in notifications.
  * @OVS_DP_ATTR_MEGAFLOW_STATS: Statistics about mega flow masks usage for the
  * datapath. Always present in notifications.
+ * @OVS_DP_ATTR_MASKS_STATS: Array of __u64 flow lookup hits per mask, in the
+ * order the masks are tried, since the masks were last rebalanced.  Covers
+ * at most the first %OVS_DP_MAX_MASKS_STATS masks.  Present in notifications.
+ * @OVS_DP_ATTR_UPCALL_STATS: Statistics about batched upcalls, see
+ * %OVS_DP_F_UPCALL_BATCH.  Always present in notifications.
  *
  * These attributes follow the &struct ovs_header within the Generic Netlink
  * payload for %OVS_DP_* commands.
@@ -87,11 +92,15 @@ enum ovs_datapath_attr {
 	OVS_DP_ATTR_USER_FEATURES,	/* OVS_DP_F_*  */
 	OVS_DP_ATTR_PAD,
 	OVS_DP_ATTR_MASKS_CACHE_SIZE,
+	OVS_DP_ATTR_MASKS_STATS,	/* __u64[] hits per mask */
+	OVS_DP_ATTR_UPCALL_STATS,	/* struct ovs_dp_upcall_stats */
 	__OVS_DP_ATTR_MAX
 };
 
 #define OVS_DP_ATTR_MAX (__OVS_DP_ATTR_MAX - 1)
 
+#define OVS_DP_MAX_MASKS_STATS 64
+
 struct ovs_dp_stats {
 	__u64 n_hit;             /* Number of flow table matches. */
 	__u64 n_missed;          /* Number of flow table misses. */
@@ -107,6 +116,13 @@ struct ovs_dp_megaflow_stats {
 	__u64 pad1;		 /* Pad for future expension. */
 };
 
+struct ovs_dp_upcall_stats {
+	__u64 n_batches;	/* Number of batched upcall messages sent. */
+	__u64 n_batched;	/* Number of upcalls sent in batches. */
+	__u64 n_pending;	/* Upcalls waiting in a batch right now. */
+	__u64 pad;		/* Pad for future expension. */
+};
+
 struct ovs_vport_stats {
 	__u64   rx_packets;		/* total packets received       */
 	__u64   tx_packets;		/* total packets transmitted    */
@@ -127,6 +143,11 @@ struct ovs_vport_stats {
 /* Allow tc offload recirc sharing */
 #define OVS_DP_F_TC_RECIRC_SHARING	(1 << 2)
 
+/* Allow upcalls to the same Netlink PID to be packed, back to back, into
+ * one Netlink datagram.  Each upcall is still a complete, padded message.
+ */
+#define OVS_DP_F_UPCALL_BATCH	(1 << 3)
+
 /* Fixed logical ports. */
 #define OVSP_LOCAL      ((__u32)0)
 
@@ -47,6 +47,7 @@ enum {
 	SMC_DIAG_SHUTDOWN,
 	SMC_DIAG_DMBINFO,
 	SMC_DIAG_FALLBACK,
+	SMC_DIAG_LINKSTATS,
 	__SMC_DIAG_MAX,
 };
 
@@ -96,6 +97,15 @@ struct smc_diag_lgrinfo {
 	__u8				role;
 };
 
+/* SMC_DIAG_LINKSTATS, send side of the link the connection uses */
+struct smc_diag_linkstats {
+	__u8		link_id;	/* link identifier */
+	__u8		reserved[7];
+	__aligned_u64	tx_msgs;	/* messages posted, CDC or LLC */
+	__aligned_u64	tx_wrs;		/* WRs posted, RDMA writes included */
+	__aligned_u64	tx_autocorks;	/* sends left for a send completion */
+};
+
 struct smc_diag_fallback {
 	__u32 reason;
 	__u32 peer_diagnosis;
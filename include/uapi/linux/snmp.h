@@ -341,6 +341,9 @@ enum
 	LINUX_MIB_TLSRXDEVICE,			/* TlsRxDevice */
 	LINUX_MIB_TLSDECRYPTERROR,		/* TlsDecryptError */
 	LINUX_MIB_TLSRXDEVICERESYNC,		/* TlsRxDeviceResync */
+	LINUX_MIB_TLSRXZEROCOPY,		/* TlsRxZeroCopy */
+	LINUX_MIB_TLSRXCOPY,			/* TlsRxCopy */
+	LINUX_MIB_TLSRXREDECRYPT,		/* TlsRxRedecrypt */
 	__LINUX_MIB_TLSMAX
 };
 
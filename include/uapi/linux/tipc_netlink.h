@@ -180,6 +180,13 @@ enum {
 	TIPC_NLA_NET_NODEID,		/* u64 */
 	TIPC_NLA_NET_NODEID_W1,		/* u64 */
 	TIPC_NLA_NET_ADDR_LEGACY,	/* flag */
+	TIPC_NLA_NET_NAMED_BULK_SENT,	/* u32 */
+	TIPC_NLA_NET_NAMED_BULK_ITEMS_SENT, /* u64 */
+	TIPC_NLA_NET_NAMED_BULK_SYNCS,	/* u32 */
+	TIPC_NLA_NET_NAMED_BULK_ITEMS,	/* u64 */
+	TIPC_NLA_NET_NAMED_UPDATES,	/* u64 */
+	TIPC_NLA_NET_NAMED_SYNC_LAST,	/* u32 */
+	TIPC_NLA_NET_NAMED_SYNC_MAX,	/* u32 */
 
 	__TIPC_NLA_NET_MAX,
 	TIPC_NLA_NET_MAX = __TIPC_NLA_NET_MAX - 1
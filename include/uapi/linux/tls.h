@@ -39,6 +39,16 @@
 /* TLS socket options */
 #define TLS_TX			1	/* Set transmit parameters */
 #define TLS_RX			2	/* Set receive parameters */
+#define TLS_RX_EXPECT_NO_PAD	4	/* Attempt opportunistic zero-copy */
+#define TLS_TX_INFLIGHT		16	/* Get records queued for transmit */
+#define TLS_TX_PARALLEL		17	/* Encrypt records on several CPUs */
+
+/* TLS_RX_EXPECT_NO_PAD: the peer is not expected to pad TLS 1.3 records,
+ * so they may be decrypted straight into the recvmsg() buffer.  A record
+ * that turns out to be padded, or to be a control record, is decrypted
+ * again in the kernel.  The part of the user buffer beyond the data
+ * returned by recvmsg() may have been overwritten in that case.
+ */
 
 /* Supported versions */
 #define TLS_VERSION_MINOR(ver)	((ver) & 0xFF)
@@ -109,6 +119,12 @@ struct tls12_crypto_info_aes_ccm_128 {
 	unsigned char rec_seq[TLS_CIPHER_AES_CCM_128_REC_SEQ_SIZE];
 };
 
+/* TLS_TX_INFLIGHT, software crypto only */
+struct tls_tx_inflight {
+	__u32 records;		/* records not yet fully handed to TCP */
+	__u32 encrypting;	/* of which still being encrypted */
+};
+
 enum {
 	TLS_INFO_UNSPEC,
 	TLS_INFO_VERSION,
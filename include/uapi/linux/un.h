@@ -12,5 +12,12 @@ struct sockaddr_un {
 };
 
 #define SIOCUNIXFILE (SIOCPROTOPRIVATE + 0) /* open a socket file with O_PATH */
+/* Set (int 1) or clear (int 0) zero-copy sends on a stream socket.
+ * Large MSG_ZEROCOPY sends then pass references to the sender's pages
+ * instead of copying them.  As with MSG_ZEROCOPY on TCP, each such send
+ * gets a SO_EE_ORIGIN_ZEROCOPY completion on the error queue, and the
+ * buffer must not be modified before its completion has been read.
+ */
+#define SIOCUNIXZEROCOPY (SIOCPROTOPRIVATE + 1)
 
 #endif /* _LINUX_UN_H */
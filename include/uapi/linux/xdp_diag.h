@@ -43,6 +43,8 @@ enum {
 	XDP_DIAG_UMEM_COMPLETION_RING,
 	XDP_DIAG_MEMINFO,
 	XDP_DIAG_STATS,
+	XDP_DIAG_TX_BATCH,
+	XDP_DIAG_FILL_SHARE,
 	__XDP_DIAG_MAX,
 };
 
@@ -80,4 +82,25 @@ struct xdp_diag_stats {
 	__u64	n_tx_ring_empty;
 };
 
+/* Copy mode transmit bursts; n_tx_burst_descs / n_tx_bursts is the
+ * average number of descriptors handed to the driver per burst.
+ */
+struct xdp_diag_tx_batch {
+	__u64	n_tx_bursts;
+	__u64	n_tx_burst_descs;
+};
+
+/* Frames lent between the buffer pools of an XDP_SHARED_FILL umem.
+ * n_starved counts allocations the pool's own fill ring could not serve,
+ * n_exhausted those the shared frames could not serve either.
+ */
+struct xdp_diag_fill_share {
+	__u64	n_starved;
+	__u64	n_exhausted;
+	__u64	n_borrowed;
+	__u64	n_donated;
+	__u32	n_entries;
+	__u32	pad;
+};
+
 #endif /* _LINUX_XDP_DIAG_H */
@@ -22,6 +22,8 @@
 #include <linux/proc_fs.h>
 #include <linux/err.h>
 #include <linux/cpumask.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
 
 #include <linux/netfilter/x_tables.h>
 #include <linux/netfilter_ipv4/ip_tables.h>
@@ -220,6 +222,132 @@ struct ipt_entry *ipt_next_entry(const struct ipt_entry *entry)
 	return (void *)entry + entry->next_offset;
 }
 
+/*
+ * Rule index.
+ *
+ * When a table is translated, runs of consecutive rules that all match
+ * one exact (/32, not inverted) destination or source address are
+ * grouped into segments.  Each segment has a small open addressed hash
+ * from address to the first rule of the run using it, and each rule of
+ * the run links to the next one with the same address.  ipt_do_table()
+ * uses this to step over rules whose address cannot match the packet.
+ *
+ * Rules that are not skipped are still evaluated in full, including
+ * their matches and targets, so first-match semantics are unchanged and
+ * anything the index does not understand is simply interpreted.
+ */
+#define IPT_SEG_MIN_RULES	8
+#define IPT_SEG_EMPTY		0xFFFFFFFFU
+
+/* No two rules can start within this many bytes of each other */
+#define IPT_HINT_GRAIN	(sizeof(struct ipt_entry) + \
+			 sizeof(struct xt_entry_target))
+#define IPT_HINT_START	0x80000000U	/* first rule of its segment */
+#define IPT_HINT_SRC	0x40000000U	/* segment is keyed on saddr */
+#define IPT_HINT_SEG	0x3FFFFFFFU	/* segment index + 1 */
+
+struct ipt_rule_hint {
+	u32 next;	/* next rule with the same address, or segment end */
+	u32 seg;	/* IPT_HINT_* flags, 0 if not part of a segment */
+};
+
+struct ipt_seg_slot {
+	__be32 key;
+	u32 first;
+};
+
+struct ipt_seg {
+	u32 end;
+	u32 bits;
+	struct ipt_seg_slot *slots;
+};
+
+struct ipt_compiled {
+	unsigned int nsegs;
+	struct ipt_seg *segs;
+	struct ipt_rule_hint hints[];
+};
+
+static inline const struct ipt_rule_hint *
+ipt_hint(const struct ipt_compiled *c, const void *base,
+	 const struct ipt_entry *e)
+{
+	return &c->hints[((const void *)e - base) / IPT_HINT_GRAIN];
+}
+
+static inline __be32 ipt_packet_key(const struct iphdr *ip, u32 seg)
+{
+	return seg & IPT_HINT_SRC ? ip->saddr : ip->daddr;
+}
+
+static inline __be32 ipt_rule_key(const struct ipt_entry *e, u32 seg)
+{
+	return seg & IPT_HINT_SRC ? e->ip.src.s_addr : e->ip.dst.s_addr;
+}
+
+/* Returns the slot holding @key, or the empty slot it would go in. */
+static inline struct ipt_seg_slot *
+ipt_seg_slot(const struct ipt_seg *s, __be32 key)
+{
+	u32 mask = (1U << s->bits) - 1;
+	u32 i = hash_32((__force u32)key, s->bits);
+
+	while (s->slots[i].first != IPT_SEG_EMPTY && s->slots[i].key != key)
+		i = (i + 1) & mask;
+
+	return &s->slots[i];
+}
+
+/* Skip from segment start @e to the first rule in it that may match. */
+static inline struct ipt_entry *
+ipt_seg_enter(const struct ipt_compiled *c, const void *base,
+	      const struct iphdr *ip, struct ipt_entry *e)
+{
+	const struct ipt_rule_hint *h;
+	const struct ipt_seg_slot *slot;
+	const struct ipt_seg *s;
+	u32 off;
+
+	if (!c)
+		return e;
+
+	for (;;) {
+		h = ipt_hint(c, base, e);
+		if (!(h->seg & IPT_HINT_START))
+			return e;
+
+		s = &c->segs[(h->seg & IPT_HINT_SEG) - 1];
+		slot = ipt_seg_slot(s, ipt_packet_key(ip, h->seg));
+		off = slot->first == IPT_SEG_EMPTY ? s->end : slot->first;
+		if (base + off == e)
+			return e;
+		/* The segment end may start the next segment */
+		e = get_entry(base, off);
+	}
+}
+
+/* Returns the next rule after @e that may match the packet. */
+static inline struct ipt_entry *
+ipt_next_rule(const struct ipt_compiled *c, const void *base,
+	      const struct iphdr *ip, const struct ipt_entry *e)
+{
+	const struct ipt_rule_hint *h;
+
+	if (!c)
+		return ipt_next_entry(e);
+
+	/*
+	 * The same-address link is only valid if the packet still has the
+	 * address of @e: we may have got here linearly, e.g. after a jump
+	 * into the middle of a segment, or a target may have mangled it.
+	 */
+	h = ipt_hint(c, base, e);
+	if (h->seg && ipt_rule_key(e, h->seg) == ipt_packet_key(ip, h->seg))
+		return ipt_seg_enter(c, base, ip, get_entry(base, h->next));
+
+	return ipt_seg_enter(c, base, ip, ipt_next_entry(e));
+}
+
 /* Returns one of the generic firewall policies, like NF_ACCEPT. */
 unsigned int
 ipt_do_table(struct sk_buff *skb,
@@ -236,6 +364,7 @@ ipt_do_table(struct sk_buff *skb,
 	struct ipt_entry *e, **jumpstack;
 	unsigned int stackidx, cpu;
 	const struct xt_table_info *private;
+	const struct ipt_compiled *compiled;
 	struct xt_action_param acpar;
 	unsigned int addend;
 
@@ -261,6 +390,7 @@ ipt_do_table(struct sk_buff *skb,
 	private = READ_ONCE(table->private); /* Address dependency. */
 	cpu        = smp_processor_id();
 	table_base = private->entries;
+	compiled   = private->compiled;
 	jumpstack  = (struct ipt_entry **)private->jumpstack[cpu];
 
 	/* Switch to alternate jumpstack if we're being invoked via TEE.
@@ -274,6 +404,7 @@ ipt_do_table(struct sk_buff *skb,
 		jumpstack += private->stacksize * __this_cpu_read(nf_skb_duplicated);
 
 	e = get_entry(table_base, private->hook_entry[hook]);
+	e = ipt_seg_enter(compiled, table_base, ip, e);
 
 	do {
 		const struct xt_entry_target *t;
@@ -284,7 +415,7 @@ ipt_do_table(struct sk_buff *skb,
 		if (!ip_packet_match(ip, indev, outdev,
 		    &e->ip, acpar.fragoff)) {
  no_match:
-			e = ipt_next_entry(e);
+			e = ipt_next_rule(compiled, table_base, ip, e);
 			continue;
 		}
 
@@ -323,7 +454,8 @@ ipt_do_table(struct sk_buff *skb,
 					    private->underflow[hook]);
 				} else {
 					e = jumpstack[--stackidx];
-					e = ipt_next_entry(e);
+					e = ipt_next_rule(compiled, table_base,
+							  ip, e);
 				}
 				continue;
 			}
@@ -337,6 +469,7 @@ ipt_do_table(struct sk_buff *skb,
 			}
 
 			e = get_entry(table_base, v);
+			e = ipt_seg_enter(compiled, table_base, ip, e);
 			continue;
 		}
 
@@ -347,7 +480,7 @@ ipt_do_table(struct sk_buff *skb,
 		if (verdict == XT_CONTINUE) {
 			/* Target might have changed stuff. */
 			ip = ip_hdr(skb);
-			e = ipt_next_entry(e);
+			e = ipt_next_rule(compiled, table_base, ip, e);
 		} else {
 			/* Verdict */
 			break;
@@ -655,6 +788,149 @@ cleanup_entry(struct ipt_entry *e, struct net *net)
 	xt_percpu_counter_free(&e->counters);
 }
 
+static bool ipt_rule_keyed(const struct ipt_entry *e, u32 field)
+{
+	if (field & IPT_HINT_SRC)
+		return e->ip.smsk.s_addr == htonl(0xFFFFFFFF) &&
+		       !(e->ip.invflags & IPT_INV_SRCIP);
+
+	return e->ip.dmsk.s_addr == htonl(0xFFFFFFFF) &&
+	       !(e->ip.invflags & IPT_INV_DSTIP);
+}
+
+static unsigned int ipt_seg_run(const void *entry0, unsigned int size,
+				unsigned int off, u32 field, unsigned int *end)
+{
+	const struct ipt_entry *e;
+	unsigned int n = 0;
+
+	/* Never take in the last entry, the segment end must be a rule */
+	for (; off < size; off += e->next_offset, n++) {
+		e = entry0 + off;
+		if (off + e->next_offset >= size || !ipt_rule_keyed(e, field))
+			break;
+	}
+	*end = off;
+
+	return n;
+}
+
+/* Returns the length of the segment starting at @off, 0 if none. */
+static unsigned int ipt_seg_find(const void *entry0, unsigned int size,
+				 unsigned int off, u32 *field,
+				 unsigned int *end)
+{
+	unsigned int n;
+
+	*field = 0;
+	n = ipt_seg_run(entry0, size, off, *field, end);
+	if (n >= IPT_SEG_MIN_RULES)
+		return n;
+
+	*field = IPT_HINT_SRC;
+	n = ipt_seg_run(entry0, size, off, *field, end);
+	if (n >= IPT_SEG_MIN_RULES)
+		return n;
+
+	return 0;
+}
+
+static unsigned int ipt_seg_bits(unsigned int n)
+{
+	return ilog2(roundup_pow_of_two(n * 2));
+}
+
+/* Builds the rule index of a translated table.  Failure is not fatal. */
+static void ipt_compile_table(struct xt_table_info *newinfo, void *entry0)
+{
+	unsigned int off, end, start, n, nhints, nsegs = 0, nslots = 0;
+	unsigned int maxslots = 0;
+	struct ipt_seg_slot *slots, *slot;
+	const struct ipt_entry *e;
+	struct ipt_rule_hint *h;
+	struct ipt_compiled *c;
+	struct ipt_seg *s;
+	u32 field, *last;
+
+	for (off = 0; off < newinfo->size; ) {
+		n = ipt_seg_find(entry0, newinfo->size, off, &field, &end);
+		if (!n) {
+			e = entry0 + off;
+			off += e->next_offset;
+			continue;
+		}
+		n = 1U << ipt_seg_bits(n);
+		nslots += n;
+		maxslots = max(maxslots, n);
+		nsegs++;
+		off = end;
+	}
+
+	if (!nsegs)
+		return;
+
+	nhints = newinfo->size / IPT_HINT_GRAIN + 1;
+	c = kvzalloc(struct_size(c, hints, nhints) +
+		     nsegs * sizeof(struct ipt_seg) +
+		     nslots * sizeof(struct ipt_seg_slot), GFP_KERNEL_ACCOUNT);
+	if (!c)
+		return;
+	last = kvmalloc_array(maxslots, sizeof(*last), GFP_KERNEL);
+	if (!last) {
+		kvfree(c);
+		return;
+	}
+
+	c->nsegs = nsegs;
+	c->segs = (void *)&c->hints[nhints];
+	slots = (void *)&c->segs[nsegs];
+	memset(slots, 0xFF, nslots * sizeof(*slots));
+
+	for (off = 0, nsegs = 0; off < newinfo->size; ) {
+		n = ipt_seg_find(entry0, newinfo->size, off, &field, &end);
+		if (!n) {
+			e = entry0 + off;
+			off += e->next_offset;
+			continue;
+		}
+
+		start = off;
+		s = &c->segs[nsegs++];
+		s->end = end;
+		s->bits = ipt_seg_bits(n);
+		s->slots = slots;
+		slots += 1U << s->bits;
+
+		for (; off < end; off += e->next_offset) {
+			e = entry0 + off;
+			slot = ipt_seg_slot(s, ipt_rule_key(e, field));
+			if (slot->first == IPT_SEG_EMPTY) {
+				slot->key = ipt_rule_key(e, field);
+				slot->first = off;
+			} else {
+				c->hints[last[slot - s->slots] /
+					 IPT_HINT_GRAIN].next = off;
+			}
+			last[slot - s->slots] = off;
+
+			h = &c->hints[off / IPT_HINT_GRAIN];
+			h->next = end;
+			h->seg = field | nsegs;
+			if (off == start)
+				h->seg |= IPT_HINT_START;
+		}
+	}
+
+	kvfree(last);
+	newinfo->compiled = c;
+}
+
+static void ipt_free_table_info(struct xt_table_info *info)
+{
+	kvfree(info->compiled);
+	xt_free_table_info(info);
+}
+
 /* Checks and translates the user-supplied table segment (held in
    newinfo) */
 static int
@@ -730,6 +1006,7 @@ translate_table(struct net *net, struct xt_table_info *newinfo, void *entry0,
 		return ret;
 	}
 
+	ipt_compile_table(newinfo, entry0);
 	return ret;
  out_free:
 	kvfree(offsets);
@@ -1083,7 +1360,7 @@ __do_replace(struct net *net, const char *name, unsigned int valid_hooks,
 	xt_entry_foreach(iter, oldinfo->entries, oldinfo->size)
 		cleanup_entry(iter, net);
 
-	xt_free_table_info(oldinfo);
+	ipt_free_table_info(oldinfo);
 	if (copy_to_user(counters_ptr, counters,
 			 sizeof(struct xt_counters) * num_counters) != 0) {
 		/* Silent error, can't fail, new table is already in place */
@@ -1146,7 +1423,7 @@ do_replace(struct net *net, sockptr_t arg, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1468,11 +1745,11 @@ translate_compat_table(struct net *net,
 
 	*pinfo = newinfo;
 	*pentry0 = entry1;
-	xt_free_table_info(info);
+	ipt_free_table_info(info);
 	return 0;
 
 free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 out_unlock:
 	xt_compat_flush_offsets(AF_INET);
@@ -1530,7 +1807,7 @@ compat_do_replace(struct net *net, sockptr_t arg, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1711,7 +1988,7 @@ static void __ipt_unregister_table(struct net *net, struct xt_table *table)
 		cleanup_entry(iter, net);
 	if (private->number > private->initial_entries)
 		module_put(table_owner);
-	xt_free_table_info(private);
+	ipt_free_table_info(private);
 }
 
 int ipt_register_table(struct net *net, const struct xt_table *table,
@@ -1755,7 +2032,7 @@ int ipt_register_table(struct net *net, const struct xt_table *table,
 	return ret;
 
 out_free:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1053,38 +1053,32 @@ static void mptcp_nospace(struct mptcp_sock *msk)
 	}
 }
 
-static bool mptcp_subflow_active(struct mptcp_subflow_context *subflow)
-{
-	struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
-
-	/* can't send if JOIN hasn't completed yet (i.e. is usable for mptcp) */
-	if (subflow->request_join && !subflow->fully_established)
-		return false;
-
-	/* only send if our side has not closed yet */
-	return ((1 << ssk->sk_state) & (TCPF_ESTABLISHED | TCPF_CLOSE_WAIT));
-}
-
 #define MPTCP_SEND_BURST_SIZE		((1 << 16) - \
 					 sizeof(struct tcphdr) - \
 					 MAX_TCP_OPTION_SPACE - \
 					 sizeof(struct ipv6hdr) - \
 					 sizeof(struct frag_hdr))
 
-struct subflow_send_info {
-	struct sock *ssk;
-	u64 ratio;
-};
+/* Bursts end on a GSO size boundary, so that moving on to another
+ * subflow does not leave a runt skb behind on this one.
+ */
+static int mptcp_subflow_burst(struct sock *ssk)
+{
+	const struct tcp_sock *tp = tcp_sk(ssk);
+	int burst, goal;
+
+	burst = min_t(int, MPTCP_SEND_BURST_SIZE, sk_stream_wspace(ssk));
+	goal = READ_ONCE(tp->xmit_size_goal_segs) * READ_ONCE(tp->mss_cache);
+	if (goal && burst > goal)
+		burst = rounddown(burst, goal);
+	return burst;
+}
 
 static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk,
 					   u32 *sndbuf)
 {
-	struct subflow_send_info send_info[2];
 	struct mptcp_subflow_context *subflow;
-	int i, nr_active = 0;
 	struct sock *ssk;
-	u64 ratio;
-	u32 pace;
 
 	sock_owned_by_me((struct sock *)msk);
 
@@ -1099,59 +1093,27 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk,
 		return sk_stream_memory_free(msk->first) ? msk->first : NULL;
 	}
 
-	/* re-use last subflow, if the burst allow that */
-	if (msk->last_snd && msk->snd_burst > 0 &&
-	    sk_stream_memory_free(msk->last_snd) &&
-	    mptcp_subflow_active(mptcp_subflow_ctx(msk->last_snd))) {
-		mptcp_for_each_subflow(msk, subflow) {
-			ssk =  mptcp_subflow_tcp_sock(subflow);
-			*sndbuf = max(tcp_sk(ssk)->snd_wnd, *sndbuf);
-		}
-		return msk->last_snd;
-	}
-
-	/* pick the subflow with the lower wmem/wspace ratio */
-	for (i = 0; i < 2; ++i) {
-		send_info[i].ssk = NULL;
-		send_info[i].ratio = -1;
-	}
 	mptcp_for_each_subflow(msk, subflow) {
 		ssk =  mptcp_subflow_tcp_sock(subflow);
-		if (!mptcp_subflow_active(subflow))
-			continue;
-
-		nr_active += !subflow->backup;
-		*sndbuf = max(tcp_sk(ssk)->snd_wnd, *sndbuf);
-		if (!sk_stream_memory_free(subflow->tcp_sock))
-			continue;
-
-		pace = READ_ONCE(ssk->sk_pacing_rate);
-		if (!pace)
-			continue;
-
-		ratio = div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) << 32,
-				pace);
-		if (ratio < send_info[subflow->backup].ratio) {
-			send_info[subflow->backup].ssk = ssk;
-			send_info[subflow->backup].ratio = ratio;
-		}
+		if (mptcp_subflow_active(subflow))
+			*sndbuf = max(tcp_sk(ssk)->snd_wnd, *sndbuf);
 	}
 
-	pr_debug("msk=%p nr_active=%d ssk=%p:%lld backup=%p:%lld",
-		 msk, nr_active, send_info[0].ssk, send_info[0].ratio,
-		 send_info[1].ssk, send_info[1].ratio);
+	/* re-use last subflow, if the burst allow that */
+	if (msk->last_snd && msk->snd_burst > 0 &&
+	    sk_stream_memory_free(msk->last_snd) &&
+	    mptcp_subflow_active(mptcp_subflow_ctx(msk->last_snd)))
+		return msk->last_snd;
 
-	/* pick the best backup if no other subflow is active */
-	if (!nr_active)
-		send_info[0].ssk = send_info[1].ssk;
+	ssk = msk->sched->get_subflow(msk);
+	if (!ssk)
+		return NULL;
 
-	if (send_info[0].ssk) {
-		msk->last_snd = send_info[0].ssk;
-		msk->snd_burst = min_t(int, MPTCP_SEND_BURST_SIZE,
-				       sk_stream_wspace(msk->last_snd));
-		return msk->last_snd;
-	}
-	return NULL;
+	msk->last_snd = ssk;
+	msk->snd_burst = mptcp_subflow_burst(ssk);
+	subflow = mptcp_subflow_ctx(ssk);
+	WRITE_ONCE(subflow->sched_bursts, subflow->sched_bursts + 1);
+	return ssk;
 }
 
 static void ssk_check_wmem(struct mptcp_sock *msk)
@@ -1163,6 +1125,7 @@ static void ssk_check_wmem(struct mptcp_sock *msk)
 static int mptcp_sendmsg(struct sock *sk, struct msghdr *msg, size_t len)
 {
 	int mss_now = 0, size_goal = 0, ret = 0;
+	struct mptcp_subflow_context *subflow;
 	struct mptcp_sock *msk = mptcp_sk(sk);
 	struct page_frag *pfrag;
 	size_t copied = 0;
@@ -1251,11 +1214,22 @@ static int mptcp_sendmsg(struct sock *sk, struct msghdr *msg, size_t len)
 		 */
 		msk->snd_burst -= ret;
 		copied += ret;
+		subflow = mptcp_subflow_ctx(ssk);
+		WRITE_ONCE(subflow->sched_bytes, subflow->sched_bytes + ret);
 
 		tx_ok = msg_data_left(msg);
 		if (!tx_ok)
 			break;
 
+		/* burst done, let the scheduler pick the next subflow */
+		if (msk->snd_burst <= 0) {
+			tcp_push(ssk, msg->msg_flags, mss_now,
+				 tcp_sk(ssk)->nonagle, size_goal);
+			mptcp_set_timeout(sk, ssk);
+			release_sock(ssk);
+			goto restart;
+		}
+
 		if (!sk_stream_memory_free(ssk) ||
 		    !mptcp_page_frag_refill(ssk, pfrag) ||
 		    !mptcp_ext_cache_refill(msk)) {
@@ -1837,6 +1811,7 @@ static int __mptcp_init_sock(struct sock *sk)
 	inet_csk(sk)->icsk_sync_mss = mptcp_sync_mss;
 
 	mptcp_pm_data_init(msk);
+	mptcp_init_sched(msk, mptcp_get_scheduler(sock_net(sk)));
 
 	/* re-use the csk retrans timer for MPTCP-level retrans */
 	timer_setup(&msk->sk.icsk_retransmit_timer, mptcp_retransmit_timer, 0);
@@ -2174,6 +2149,7 @@ void mptcp_destroy_common(struct mptcp_sock *msk)
 	skb_rbtree_purge(&msk->out_of_order_queue);
 	mptcp_token_destroy(msk);
 	mptcp_pm_free_anno_list(msk);
+	mptcp_release_sched(msk);
 }
 
 static void mptcp_destroy(struct sock *sk)
@@ -2815,6 +2791,7 @@ void __init mptcp_proto_init(void)
 
 	mptcp_subflow_init();
 	mptcp_pm_init();
+	mptcp_sched_init();
 	mptcp_token_init();
 
 	if (proto_register(&mptcp_prot, 1) != 0)
@@ -193,6 +193,26 @@ struct mptcp_data_frag {
 	struct page *page;
 };
 
+#define MPTCP_SCHED_NAME_MAX	16
+
+struct mptcp_sock;
+
+/* A subflow scheduler decides which subflow carries the next burst of
+ * data. get_subflow() is called with the msk socket lock held and
+ * returns NULL when no subflow can take data right now; how much goes
+ * out before it is asked again is up to the core, see
+ * mptcp_subflow_get_send().
+ */
+struct mptcp_sched_ops {
+	struct sock	*(*get_subflow)(struct mptcp_sock *msk);
+	void		(*init)(struct mptcp_sock *msk);
+	void		(*release)(struct mptcp_sock *msk);
+
+	char		name[MPTCP_SCHED_NAME_MAX];
+	struct module	*owner;
+	struct list_head list;
+};
+
 /* MPTCP connection sock */
 struct mptcp_sock {
 	/* inet_connection_sock must be the first member */
@@ -204,6 +224,7 @@ struct mptcp_sock {
 	u64		rcv_data_fin_seq;
 	struct sock	*last_snd;
 	int		snd_burst;
+	struct mptcp_sched_ops	*sched;
 	atomic64_t	snd_una;
 	unsigned long	timer_ival;
 	u32		token;
@@ -321,6 +342,8 @@ struct mptcp_subflow_context {
 	u8	hmac[MPTCPOPT_HMAC_LEN];
 	u8	local_id;
 	u8	remote_id;
+	u32	sched_bursts;	    /* times picked by the scheduler */
+	u64	sched_bytes;	    /* bytes sent by mptcp_sendmsg() */
 
 	struct	sock *tcp_sock;	    /* tcp sk backpointer */
 	struct	sock *conn;	    /* parent mptcp_sock */
@@ -361,7 +384,20 @@ mptcp_subflow_get_mapped_dsn(const struct mptcp_subflow_context *subflow)
 	return subflow->map_seq + mptcp_subflow_get_map_offset(subflow);
 }
 
+static inline bool mptcp_subflow_active(struct mptcp_subflow_context *subflow)
+{
+	struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+
+	/* can't send if JOIN hasn't completed yet (i.e. is usable for mptcp) */
+	if (subflow->request_join && !subflow->fully_established)
+		return false;
+
+	/* only send if our side has not closed yet */
+	return ((1 << ssk->sk_state) & (TCPF_ESTABLISHED | TCPF_CLOSE_WAIT));
+}
+
 int mptcp_is_enabled(struct net *net);
+const char *mptcp_get_scheduler(struct net *net);
 void mptcp_subflow_fully_established(struct mptcp_subflow_context *subflow,
 				     struct mptcp_options_received *mp_opt);
 bool mptcp_subflow_data_available(struct sock *sk);
@@ -412,6 +448,13 @@ void mptcp_subflow_eof(struct sock *sk);
 bool mptcp_update_rcv_data_fin(struct mptcp_sock *msk, u64 data_fin_seq, bool use_64bit);
 void mptcp_destroy_common(struct mptcp_sock *msk);
 
+void __init mptcp_sched_init(void);
+bool mptcp_sched_exists(const char *name);
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_init_sched(struct mptcp_sock *msk, const char *name);
+void mptcp_release_sched(struct mptcp_sock *msk);
+
 void __init mptcp_token_init(void);
 static inline void mptcp_token_init_request(struct request_sock *req)
 {
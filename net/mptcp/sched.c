@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Multipath TCP
+ *
+ * Subflow schedulers
+ */
+#define pr_fmt(fmt) "MPTCP: " fmt
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
+#include <net/tcp.h>
+#include "protocol.h"
+
+static DEFINE_SPINLOCK(mptcp_sched_list_lock);
+static LIST_HEAD(mptcp_sched_list);
+
+struct subflow_send_info {
+	struct sock *ssk;
+	u64 delay;
+};
+
+/* Pick the subflow on which newly queued data is expected to arrive
+ * first: the time needed to drain what is already queued there at the
+ * current pacing rate, plus half the smoothed RTT. Backup subflows are
+ * only used when no other subflow is active.
+ */
+static struct sock *mptcp_sched_default_get_subflow(struct mptcp_sock *msk)
+{
+	struct subflow_send_info send_info[2];
+	struct mptcp_subflow_context *subflow;
+	int i, nr_active = 0;
+	struct sock *ssk;
+	u64 delay;
+	u32 pace;
+
+	for (i = 0; i < 2; ++i) {
+		send_info[i].ssk = NULL;
+		send_info[i].delay = -1;
+	}
+
+	mptcp_for_each_subflow(msk, subflow) {
+		ssk =  mptcp_subflow_tcp_sock(subflow);
+		if (!mptcp_subflow_active(subflow))
+			continue;
+
+		nr_active += !subflow->backup;
+		if (!sk_stream_memory_free(ssk))
+			continue;
+
+		pace = READ_ONCE(ssk->sk_pacing_rate);
+		if (!pace)
+			continue;
+
+		delay = div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) *
+				NSEC_PER_SEC, pace);
+		/* srtt_us is kept left shifted by 3 */
+		delay += (u64)(READ_ONCE(tcp_sk(ssk)->srtt_us) >> 4) *
+			 NSEC_PER_USEC;
+		if (delay < send_info[subflow->backup].delay) {
+			send_info[subflow->backup].ssk = ssk;
+			send_info[subflow->backup].delay = delay;
+		}
+	}
+
+	pr_debug("msk=%p nr_active=%d ssk=%p:%llu backup=%p:%llu",
+		 msk, nr_active, send_info[0].ssk, send_info[0].delay,
+		 send_info[1].ssk, send_info[1].delay);
+
+	/* pick the best backup if no other subflow is active */
+	if (!nr_active)
+		send_info[0].ssk = send_info[1].ssk;
+
+	return send_info[0].ssk;
+}
+
+static struct mptcp_sched_ops mptcp_sched_default = {
+	.get_subflow	= mptcp_sched_default_get_subflow,
+	.name		= "default",
+	.owner		= THIS_MODULE,
+};
+
+/* Hand the bursts to the active non backup subflows in turn, starting
+ * after the last one used. Without such a subflow, use the default
+ * scheduler's backup handling.
+ */
+static struct sock *mptcp_sched_rr_get_subflow(struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow;
+	struct sock *ssk, *first = NULL;
+	bool after_last = false;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		ssk = mptcp_subflow_tcp_sock(subflow);
+		if (ssk == msk->last_snd)
+			after_last = true;
+
+		if (!mptcp_subflow_active(subflow) || subflow->backup ||
+		    !sk_stream_memory_free(ssk))
+			continue;
+
+		if (after_last && ssk != msk->last_snd)
+			return ssk;
+		if (!first)
+			first = ssk;
+	}
+
+	return first ? : mptcp_sched_default_get_subflow(msk);
+}
+
+static struct mptcp_sched_ops mptcp_sched_rr = {
+	.get_subflow	= mptcp_sched_rr_get_subflow,
+	.name		= "roundrobin",
+	.owner		= THIS_MODULE,
+};
+
+/* called with rcu read lock or mptcp_sched_list_lock held */
+static struct mptcp_sched_ops *mptcp_sched_find(const char *name)
+{
+	struct mptcp_sched_ops *sched;
+
+	list_for_each_entry_rcu(sched, &mptcp_sched_list, list) {
+		if (!strcmp(sched->name, name))
+			return sched;
+	}
+	return NULL;
+}
+
+bool mptcp_sched_exists(const char *name)
+{
+	bool ret;
+
+	rcu_read_lock();
+	ret = !!mptcp_sched_find(name);
+	rcu_read_unlock();
+
+	return ret;
+}
+
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched)
+{
+	if (!sched->get_subflow)
+		return -EINVAL;
+
+	spin_lock(&mptcp_sched_list_lock);
+	if (mptcp_sched_find(sched->name)) {
+		spin_unlock(&mptcp_sched_list_lock);
+		return -EEXIST;
+	}
+	list_add_tail_rcu(&sched->list, &mptcp_sched_list);
+	spin_unlock(&mptcp_sched_list_lock);
+
+	pr_debug("%s registered", sched->name);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(mptcp_register_scheduler);
+
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched)
+{
+	if (sched == &mptcp_sched_default)
+		return;
+
+	spin_lock(&mptcp_sched_list_lock);
+	list_del_rcu(&sched->list);
+	spin_unlock(&mptcp_sched_list_lock);
+
+	/* sockets using it hold a module reference, only lookups can race */
+	synchronize_rcu();
+}
+EXPORT_SYMBOL_GPL(mptcp_unregister_scheduler);
+
+/* Unknown names, e.g. a scheduler whose module is gone since the sysctl
+ * was set, fall back to the default scheduler.
+ */
+void mptcp_init_sched(struct mptcp_sock *msk, const char *name)
+{
+	struct mptcp_sched_ops *sched;
+
+	rcu_read_lock();
+	sched = mptcp_sched_find(name);
+	if (!sched || !try_module_get(sched->owner))
+		sched = &mptcp_sched_default;
+	rcu_read_unlock();
+
+	msk->sched = sched;
+	if (sched->init)
+		sched->init(msk);
+
+	pr_debug("msk=%p sched=%s", msk, sched->name);
+}
+
+void mptcp_release_sched(struct mptcp_sock *msk)
+{
+	struct mptcp_sched_ops *sched = msk->sched;
+
+	if (!sched)
+		return;
+
+	msk->sched = NULL;
+	if (sched->release)
+		sched->release(msk);
+	module_put(sched->owner);
+}
+
+void __init mptcp_sched_init(void)
+{
+	if (mptcp_register_scheduler(&mptcp_sched_default))
+		panic("Failed to register MPTCP default scheduler\n");
+	if (mptcp_register_scheduler(&mptcp_sched_rr))
+		panic("Failed to register MPTCP roundrobin scheduler\n");
+}
@@ -32,10 +32,15 @@
 #include <linux/seq_file.h>
 #include <linux/jhash.h>
 #include <linux/random.h>
+#include <linux/percpu_counter.h>
+#include <linux/seqlock.h>
+#include <linux/workqueue.h>
 
 #include <net/net_namespace.h>
 #include <net/ip_vs.h>
 
+#include "ip_vs_internals.h"
+
 
 #ifndef CONFIG_IP_VS_TAB_BITS
 #define CONFIG_IP_VS_TAB_BITS	12
@@ -43,19 +48,59 @@
 
 /*
  * Connection hash size. Default is what was selected at compile time.
+ * The table starts at this size, grows with the number of connections
+ * up to conn_tab_max_bits and never shrinks below it again.
 */
 static int ip_vs_conn_tab_bits = CONFIG_IP_VS_TAB_BITS;
 module_param_named(conn_tab_bits, ip_vs_conn_tab_bits, int, 0444);
 MODULE_PARM_DESC(conn_tab_bits, "Set connections' hash size");
 
-/* size and mask values */
+#define IP_VS_CONN_TAB_MAX_BITS	24
+
+static int ip_vs_conn_tab_max_bits = IP_VS_CONN_TAB_MAX_BITS;
+module_param_named(conn_tab_max_bits, ip_vs_conn_tab_max_bits, int, 0444);
+MODULE_PARM_DESC(conn_tab_max_bits, "Set connections' maximum hash size");
+
+/* current size of the table, for reporting */
 int ip_vs_conn_tab_size __read_mostly;
-static int ip_vs_conn_tab_mask __read_mostly;
 
 /*
  *  Connection hash table: for input and output packets lookups of IPVS
+ *
+ *  While the table is resized, new_tab points to its replacement: new
+ *  connections are hashed there and buckets are moved over one at a time,
+ *  so lookups have to walk both tables.
+ */
+struct ip_vs_conn_tab {
+	struct ip_vs_conn_tab __rcu	*new_tab;
+	unsigned int			size;
+	unsigned int			mask;
+	struct hlist_head		buckets[];
+};
+
+static struct ip_vs_conn_tab __rcu *ip_vs_conn_tab __read_mostly;
+
+/* number of hashed connections in all netns */
+static struct percpu_counter ip_vs_conn_tab_count;
+/* number of non-empty buckets, in both tables during a resize */
+static struct percpu_counter ip_vs_conn_tab_used;
+/* longest chain since the last resize */
+static unsigned int ip_vs_conn_tab_max_chain;
+
+/* Check the load of the table once per second, and back off up to once
+ * per 64 seconds while it needs no resize. A connection that overloads the
+ * table brings the check forward.
  */
-static struct hlist_head *ip_vs_conn_tab __read_mostly;
+#define IP_VS_CONN_RESIZE_PERIOD	HZ
+#define IP_VS_CONN_RESIZE_MAX_PERIOD	(64 * HZ)
+
+static void ip_vs_conn_resize_handler(struct work_struct *work);
+static DECLARE_DELAYED_WORK(ip_vs_conn_resize_work, ip_vs_conn_resize_handler);
+static unsigned long ip_vs_conn_resize_period = IP_VS_CONN_RESIZE_PERIOD;
+static unsigned int ip_vs_conn_tab_grows;
+static unsigned int ip_vs_conn_tab_shrinks;
+/* odd while a resize runs, bumped twice per resize */
+static unsigned int ip_vs_conn_tab_gen;
 
 /*  SLAB cache for IPVS connections */
 static struct kmem_cache *ip_vs_conn_cachep __read_mostly;
@@ -67,7 +112,10 @@ static atomic_t ip_vs_conn_no_cport_cnt = ATOMIC_INIT(0);
 static unsigned int ip_vs_conn_rnd __read_mostly;
 
 /*
- *  Fine locking granularity for big connection hash table
+ *  Fine locking granularity for big connection hash table. The lock of a
+ *  bucket is selected by the low bits of the hash, so the table never gets
+ *  smaller than CT_LOCKARRAY_SIZE and an entry keeps its lock when it is
+ *  moved to a table of another size.
  */
 #define CT_LOCKARRAY_BITS  5
 #define CT_LOCKARRAY_SIZE  (1<<CT_LOCKARRAY_BITS)
@@ -82,7 +130,9 @@ static unsigned int ip_vs_conn_rnd __read_mostly;
 
 struct ip_vs_aligned_lock
 {
-	spinlock_t	l;
+	spinlock_t		l;
+	/* changed while a resize moves buckets of this lock */
+	seqcount_spinlock_t	seq;
 } __attribute__((__aligned__(SMP_CACHE_BYTES)));
 
 /* lock array for conn table */
@@ -99,6 +149,85 @@ static inline void ct_write_unlock_bh(unsigned int key)
 	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
 }
 
+static inline unsigned int ip_vs_conn_tab_read_begin(unsigned int key)
+{
+	return read_seqcount_begin(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].seq);
+}
+
+/* A lookup that missed has to be repeated if a resize moved buckets under
+ * it, the walk could have been diverted to a chain of the new table.
+ */
+static inline bool ip_vs_conn_tab_read_retry(unsigned int key,
+					     unsigned int seq)
+{
+	return read_seqcount_retry(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].seq,
+				   seq);
+}
+
+/* Walk the table and the one that replaces it during a resize */
+#define ip_vs_conn_for_each_tab(t)					\
+	for (t = rcu_dereference(ip_vs_conn_tab); t;			\
+	     t = rcu_dereference(t->new_tab))
+
+/* Bucket @idx of the table followed by the buckets of its replacement,
+ * NULL past the end. Must be called under RCU.
+ */
+static struct hlist_head *ip_vs_conn_tab_bucket(unsigned int idx)
+{
+	struct ip_vs_conn_tab *t = rcu_dereference(ip_vs_conn_tab);
+
+	if (idx < t->size)
+		return &t->buckets[idx];
+	idx -= t->size;
+	t = rcu_dereference(t->new_tab);
+	if (t && idx < t->size)
+		return &t->buckets[idx];
+	return NULL;
+}
+
+/* Accounts @cp just added at the head of its bucket, called with the lock
+ * of the bucket held.
+ */
+static void ip_vs_conn_tab_add_stats(struct ip_vs_conn *cp)
+{
+	unsigned int len = 0, max;
+	struct hlist_node *n;
+
+	if (!cp->c_list.next)
+		percpu_counter_inc(&ip_vs_conn_tab_used);
+
+	/* Chains stay short on average, counting is cheap */
+	for (n = &cp->c_list; n; n = n->next)
+		len++;
+	max = READ_ONCE(ip_vs_conn_tab_max_chain);
+	while (len > max) {
+		unsigned int old = cmpxchg(&ip_vs_conn_tab_max_chain, max, len);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+/* Accounts @cp about to be unlinked from its bucket, called with the lock
+ * of the bucket held.
+ */
+static void ip_vs_conn_tab_del_stats(struct ip_vs_conn *cp, unsigned int hash)
+{
+	struct ip_vs_conn_tab *t;
+
+	if (cp->c_list.next)
+		return;
+	/* the bucket empties if @cp is its only entry */
+	for (t = rcu_dereference_bh(ip_vs_conn_tab); t;
+	     t = rcu_dereference_bh(t->new_tab)) {
+		if (t->buckets[hash & t->mask].first == &cp->c_list) {
+			percpu_counter_dec(&ip_vs_conn_tab_used);
+			break;
+		}
+	}
+}
+
 static void ip_vs_conn_expire(struct timer_list *t);
 
 /*
@@ -112,11 +241,11 @@ static unsigned int ip_vs_conn_hashkey(struct netns_ipvs *ipvs, int af, unsigned
 	if (af == AF_INET6)
 		return (jhash_3words(jhash(addr, 16, ip_vs_conn_rnd),
 				    (__force u32)port, proto, ip_vs_conn_rnd) ^
-			((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+			((size_t)ipvs>>8));
 #endif
 	return (jhash_3words((__force u32)addr->ip, (__force u32)port, proto,
 			    ip_vs_conn_rnd) ^
-		((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+		((size_t)ipvs>>8));
 }
 
 static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
@@ -126,8 +255,7 @@ static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
 	__be16 port;
 
 	if (p->pe_data && p->pe->hashkey_raw)
-		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse) &
-			ip_vs_conn_tab_mask;
+		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse);
 
 	if (likely(!inverse)) {
 		addr = p->caddr;
@@ -162,7 +290,8 @@ static unsigned int ip_vs_conn_hashkey_conn(const struct ip_vs_conn *cp)
  */
 static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 {
-	unsigned int hash;
+	struct ip_vs_conn_tab *t, *new_tab;
+	unsigned int hash, size = 0;
 	int ret;
 
 	if (cp->flags & IP_VS_CONN_F_ONE_PACKET)
@@ -177,7 +306,15 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	if (!(cp->flags & IP_VS_CONN_F_HASHED)) {
 		cp->flags |= IP_VS_CONN_F_HASHED;
 		refcount_inc(&cp->refcnt);
-		hlist_add_head_rcu(&cp->c_list, &ip_vs_conn_tab[hash]);
+		t = rcu_dereference_bh(ip_vs_conn_tab);
+		new_tab = rcu_dereference_bh(t->new_tab);
+		if (new_tab)
+			t = new_tab;
+		hlist_add_head_rcu(&cp->c_list, &t->buckets[hash & t->mask]);
+		ip_vs_conn_tab_add_stats(cp);
+		percpu_counter_inc(&ip_vs_conn_tab_count);
+		if (!new_tab)
+			size = t->size;
 		ret = 1;
 	} else {
 		pr_err("%s(): request for already hashed, called from %pS\n",
@@ -188,6 +325,15 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	spin_unlock(&cp->lock);
 	ct_write_unlock_bh(hash);
 
+	/* The resize check backed off, run it now if the table got full */
+	if (size && size < 1U << ip_vs_conn_tab_max_bits &&
+	    unlikely(percpu_counter_read(&ip_vs_conn_tab_count) >
+		     2 * (s64)size) &&
+	    READ_ONCE(ip_vs_conn_resize_period) > IP_VS_CONN_RESIZE_PERIOD &&
+	    xchg(&ip_vs_conn_resize_period, IP_VS_CONN_RESIZE_PERIOD) >
+	    IP_VS_CONN_RESIZE_PERIOD)
+		mod_delayed_work(system_long_wq, &ip_vs_conn_resize_work, 0);
+
 	return ret;
 }
 
@@ -208,9 +354,11 @@ static inline int ip_vs_conn_unhash(struct ip_vs_conn *cp)
 	spin_lock(&cp->lock);
 
 	if (cp->flags & IP_VS_CONN_F_HASHED) {
+		ip_vs_conn_tab_del_stats(cp, hash);
 		hlist_del_rcu(&cp->c_list);
 		cp->flags &= ~IP_VS_CONN_F_HASHED;
 		refcount_dec(&cp->refcnt);
+		percpu_counter_dec(&ip_vs_conn_tab_count);
 		ret = 1;
 	} else
 		ret = 0;
@@ -240,8 +388,10 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 	if (cp->flags & IP_VS_CONN_F_HASHED) {
 		/* Decrease refcnt and unlink conn only if we are last user */
 		if (refcount_dec_if_one(&cp->refcnt)) {
+			ip_vs_conn_tab_del_stats(cp, hash);
 			hlist_del_rcu(&cp->c_list);
 			cp->flags &= ~IP_VS_CONN_F_HASHED;
+			percpu_counter_dec(&ip_vs_conn_tab_count);
 			ret = true;
 		}
 	}
@@ -262,28 +412,37 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 static inline struct ip_vs_conn *
 __ip_vs_conn_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	struct ip_vs_conn_tab *t;
+	unsigned int hash, seq;
 	struct ip_vs_conn *cp;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (p->cport == cp->cport && p->vport == cp->vport &&
-		    cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
-		    ip_vs_addr_equal(p->af, p->vaddr, &cp->vaddr) &&
-		    ((!p->cport) ^ (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (!__ip_vs_conn_get(cp))
-				continue;
-			/* HIT */
-			rcu_read_unlock();
-			return cp;
+retry:
+	seq = ip_vs_conn_tab_read_begin(hash);
+	ip_vs_conn_for_each_tab(t) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[hash & t->mask],
+					 c_list) {
+			if (p->cport == cp->cport && p->vport == cp->vport &&
+			    cp->af == p->af &&
+			    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
+			    ip_vs_addr_equal(p->af, p->vaddr, &cp->vaddr) &&
+			    ((!p->cport) ^
+			     (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
+			    p->protocol == cp->protocol &&
+			    cp->ipvs == p->ipvs) {
+				if (!__ip_vs_conn_get(cp))
+					continue;
+				/* HIT */
+				rcu_read_unlock();
+				return cp;
+			}
 		}
 	}
+	if (ip_vs_conn_tab_read_retry(hash, seq))
+		goto retry;
 
 	rcu_read_unlock();
 
@@ -348,38 +507,47 @@ EXPORT_SYMBOL_GPL(ip_vs_conn_in_get_proto);
 /* Get reference to connection template */
 struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	struct ip_vs_conn_tab *t;
+	unsigned int hash, seq;
 	struct ip_vs_conn *cp;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (unlikely(p->pe_data && p->pe->ct_match)) {
-			if (cp->ipvs != p->ipvs)
+retry:
+	seq = ip_vs_conn_tab_read_begin(hash);
+	ip_vs_conn_for_each_tab(t) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[hash & t->mask],
+					 c_list) {
+			if (unlikely(p->pe_data && p->pe->ct_match)) {
+				if (cp->ipvs != p->ipvs)
+					continue;
+				if (p->pe == cp->pe && p->pe->ct_match(p, cp)) {
+					if (__ip_vs_conn_get(cp))
+						goto out;
+				}
 				continue;
-			if (p->pe == cp->pe && p->pe->ct_match(p, cp)) {
+			}
+
+			if (cp->af == p->af &&
+			    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
+			    /* protocol should only be IPPROTO_IP if
+			     * p->vaddr is a fwmark */
+			    ip_vs_addr_equal(p->protocol == IPPROTO_IP ?
+					     AF_UNSPEC : p->af,
+					     p->vaddr, &cp->vaddr) &&
+			    p->vport == cp->vport && p->cport == cp->cport &&
+			    cp->flags & IP_VS_CONN_F_TEMPLATE &&
+			    p->protocol == cp->protocol &&
+			    cp->ipvs == p->ipvs) {
 				if (__ip_vs_conn_get(cp))
 					goto out;
 			}
-			continue;
-		}
-
-		if (cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
-		    /* protocol should only be IPPROTO_IP if
-		     * p->vaddr is a fwmark */
-		    ip_vs_addr_equal(p->protocol == IPPROTO_IP ? AF_UNSPEC :
-				     p->af, p->vaddr, &cp->vaddr) &&
-		    p->vport == cp->vport && p->cport == cp->cport &&
-		    cp->flags & IP_VS_CONN_F_TEMPLATE &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (__ip_vs_conn_get(cp))
-				goto out;
 		}
 	}
+	if (ip_vs_conn_tab_read_retry(hash, seq))
+		goto retry;
 	cp = NULL;
 
   out:
@@ -400,7 +568,8 @@ struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
  *	p->vaddr, p->vport: pkt dest address (foreign host) */
 struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	struct ip_vs_conn_tab *t;
+	unsigned int hash, seq;
 	struct ip_vs_conn *cp, *ret=NULL;
 	const union nf_inet_addr *saddr;
 	__be16 sport;
@@ -412,31 +581,39 @@ struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (p->vport != cp->cport)
-			continue;
+retry:
+	seq = ip_vs_conn_tab_read_begin(hash);
+	ip_vs_conn_for_each_tab(t) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[hash & t->mask],
+					 c_list) {
+			if (p->vport != cp->cport)
+				continue;
 
-		if (IP_VS_FWD_METHOD(cp) != IP_VS_CONN_F_MASQ) {
-			sport = cp->vport;
-			saddr = &cp->vaddr;
-		} else {
-			sport = cp->dport;
-			saddr = &cp->daddr;
-		}
+			if (IP_VS_FWD_METHOD(cp) != IP_VS_CONN_F_MASQ) {
+				sport = cp->vport;
+				saddr = &cp->vaddr;
+			} else {
+				sport = cp->dport;
+				saddr = &cp->daddr;
+			}
 
-		if (p->cport == sport && cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->vaddr, &cp->caddr) &&
-		    ip_vs_addr_equal(p->af, p->caddr, saddr) &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (!__ip_vs_conn_get(cp))
-				continue;
-			/* HIT */
-			ret = cp;
-			break;
+			if (p->cport == sport && cp->af == p->af &&
+			    ip_vs_addr_equal(p->af, p->vaddr, &cp->caddr) &&
+			    ip_vs_addr_equal(p->af, p->caddr, saddr) &&
+			    p->protocol == cp->protocol &&
+			    cp->ipvs == p->ipvs) {
+				if (!__ip_vs_conn_get(cp))
+					continue;
+				/* HIT */
+				ret = cp;
+				goto out;
+			}
 		}
 	}
+	if (ip_vs_conn_tab_read_retry(hash, seq))
+		goto retry;
 
+out:
 	rcu_read_unlock();
 
 	IP_VS_DBG_BUF(9, "lookup/out %s %s:%d->%s:%d %s\n",
@@ -1046,26 +1223,45 @@ ip_vs_conn_new(const struct ip_vs_conn_param *p, int dest_af,
 #ifdef CONFIG_PROC_FS
 struct ip_vs_iter_state {
 	struct seq_net_private	p;
-	struct hlist_head	*l;
+	unsigned int		bucket;
+	/* ip_vs_conn_tab_gen when the walk reached bucket */
+	unsigned int		gen;
 };
 
+/* A resize moves the entries between buckets, so a bucket index taken
+ * before it means nothing after it. The walk is restarted from the first
+ * bucket instead.
+ */
+static inline bool ip_vs_conn_iter_stale(struct ip_vs_iter_state *iter)
+{
+	return READ_ONCE(ip_vs_conn_tab_gen) != iter->gen;
+}
+
 static void *ip_vs_conn_array(struct seq_file *seq, loff_t pos)
 {
-	int idx;
+	unsigned int idx;
+	struct hlist_head *head;
 	struct ip_vs_conn *cp;
 	struct ip_vs_iter_state *iter = seq->private;
-
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+	loff_t left;
+
+restart:
+	iter->gen = READ_ONCE(ip_vs_conn_tab_gen);
+	smp_rmb();
+	left = pos;
+	for (idx = 0; (head = ip_vs_conn_tab_bucket(idx)); idx++) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
 			/* __ip_vs_conn_get() is not needed by
 			 * ip_vs_conn_seq_show and ip_vs_conn_sync_seq_show
 			 */
-			if (pos-- == 0) {
-				iter->l = &ip_vs_conn_tab[idx];
+			if (left-- == 0) {
+				iter->bucket = idx;
 				return cp;
 			}
 		}
 		cond_resched_rcu();
+		if (ip_vs_conn_iter_stale(iter))
+			goto restart;
 	}
 
 	return NULL;
@@ -1076,7 +1272,7 @@ static void *ip_vs_conn_seq_start(struct seq_file *seq, loff_t *pos)
 {
 	struct ip_vs_iter_state *iter = seq->private;
 
-	iter->l = NULL;
+	iter->bucket = 0;
 	rcu_read_lock();
 	return *pos ? ip_vs_conn_array(seq, *pos - 1) :SEQ_START_TOKEN;
 }
@@ -1086,27 +1282,33 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 	struct ip_vs_conn *cp = v;
 	struct ip_vs_iter_state *iter = seq->private;
 	struct hlist_node *e;
-	struct hlist_head *l = iter->l;
-	int idx;
+	struct hlist_head *head;
+	unsigned int idx;
 
 	++*pos;
 	if (v == SEQ_START_TOKEN)
 		return ip_vs_conn_array(seq, 0);
 
+	/* entry *pos - 1 of the current table */
+	if (ip_vs_conn_iter_stale(iter))
+		return ip_vs_conn_array(seq, *pos - 1);
+
 	/* more on same hash chain? */
 	e = rcu_dereference(hlist_next_rcu(&cp->c_list));
 	if (e)
 		return hlist_entry(e, struct ip_vs_conn, c_list);
 
-	idx = l - ip_vs_conn_tab;
-	while (++idx < ip_vs_conn_tab_size) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
-			iter->l = &ip_vs_conn_tab[idx];
+	idx = iter->bucket;
+	while ((head = ip_vs_conn_tab_bucket(++idx))) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
+			iter->bucket = idx;
 			return cp;
 		}
 		cond_resched_rcu();
+		if (ip_vs_conn_iter_stale(iter))
+			return ip_vs_conn_array(seq, *pos - 1);
 	}
-	iter->l = NULL;
+	iter->bucket = 0;
 	return NULL;
 }
 
@@ -1300,17 +1502,19 @@ static inline bool ip_vs_conn_ops_mode(struct ip_vs_conn *cp)
 /* Called from keventd and must protect itself from softirqs */
 void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
 {
-	int idx;
+	int idx, n;
 	struct ip_vs_conn *cp;
 
 	rcu_read_lock();
 	/*
 	 * Randomly scan 1/32 of the whole table every second
 	 */
-	for (idx = 0; idx < (ip_vs_conn_tab_size>>5); idx++) {
-		unsigned int hash = prandom_u32() & ip_vs_conn_tab_mask;
+	n = rcu_dereference(ip_vs_conn_tab)->size >> 5;
+	for (idx = 0; idx < n; idx++) {
+		struct ip_vs_conn_tab *t = rcu_dereference(ip_vs_conn_tab);
+		unsigned int hash = prandom_u32() & t->mask;
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[hash], c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 			if (atomic_read(&cp->n_control))
@@ -1370,14 +1574,15 @@ void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
  */
 static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 {
-	int idx;
+	unsigned int idx;
+	struct hlist_head *head;
 	struct ip_vs_conn *cp, *cp_c;
 
 flush_again:
 	rcu_read_lock();
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
+	for (idx = 0; (head = ip_vs_conn_tab_bucket(idx)); idx++) {
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 			if (atomic_read(&cp->n_control))
@@ -1405,13 +1610,14 @@ static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 #ifdef CONFIG_SYSCTL
 void ip_vs_expire_nodest_conn_flush(struct netns_ipvs *ipvs)
 {
-	int idx;
+	unsigned int idx;
+	struct hlist_head *head;
 	struct ip_vs_conn *cp, *cp_c;
 	struct ip_vs_dest *dest;
 
 	rcu_read_lock();
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+	for (idx = 0; (head = ip_vs_conn_tab_bucket(idx)); idx++) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 
@@ -1440,6 +1646,166 @@ void ip_vs_expire_nodest_conn_flush(struct netns_ipvs *ipvs)
 }
 #endif
 
+/* Buckets walked between checks of the sync queues */
+#define IP_VS_CONN_SYNC_BATCH	64
+
+/* Send all connections of @ipvs to the backups, paced by the master sync
+ * queues. Called from process context.
+ */
+int ip_vs_conn_sync_all(struct netns_ipvs *ipvs)
+{
+	struct hlist_head *head;
+	struct ip_vs_conn *cp;
+	unsigned int idx = 0, n;
+	int ret = 0;
+
+	do {
+		rcu_read_lock();
+		for (n = 0; !ret && n < IP_VS_CONN_SYNC_BATCH &&
+		     (head = ip_vs_conn_tab_bucket(idx)); n++, idx++) {
+			hlist_for_each_entry_rcu(cp, head, c_list) {
+				if (cp->ipvs != ipvs)
+					continue;
+				ret = ip_vs_sync_conn_bulk(ipvs, cp);
+				if (ret)
+					break;
+			}
+		}
+		rcu_read_unlock();
+		if (!ret)
+			ret = ip_vs_sync_bulk_wait(ipvs);
+	} while (!ret && head);
+
+	return ret;
+}
+
+static struct ip_vs_conn_tab *ip_vs_conn_tab_alloc(int bits)
+{
+	struct ip_vs_conn_tab *t;
+	unsigned int idx, size = 1U << bits;
+
+	t = kvmalloc(struct_size(t, buckets, size), GFP_KERNEL);
+	if (!t)
+		return NULL;
+	RCU_INIT_POINTER(t->new_tab, NULL);
+	t->size = size;
+	t->mask = size - 1;
+	for (idx = 0; idx < size; idx++)
+		INIT_HLIST_HEAD(&t->buckets[idx]);
+	return t;
+}
+
+/* Move all connections to a table with 2^bits buckets. Only the resize
+ * work calls this, so there is a single writer of ip_vs_conn_tab.
+ */
+static void ip_vs_conn_tab_resize(int bits)
+{
+	struct ip_vs_conn_tab *t, *new_tab;
+	struct ip_vs_aligned_lock *lock;
+	struct hlist_node *n;
+	struct ip_vs_conn *cp;
+	unsigned int idx;
+
+	new_tab = ip_vs_conn_tab_alloc(bits);
+	if (!new_tab)
+		return;
+
+	t = rcu_dereference_protected(ip_vs_conn_tab, 1);
+	/* /proc walks that see the change restart */
+	WRITE_ONCE(ip_vs_conn_tab_gen, ip_vs_conn_tab_gen + 1);
+	WRITE_ONCE(ip_vs_conn_tab_max_chain, 0);
+	rcu_assign_pointer(t->new_tab, new_tab);
+
+	for (idx = 0; idx < t->size; idx++) {
+		lock = &__ip_vs_conntbl_lock_array[idx & CT_LOCKARRAY_MASK];
+		spin_lock_bh(&lock->l);
+		write_seqcount_begin(&lock->seq);
+		if (!hlist_empty(&t->buckets[idx]))
+			percpu_counter_dec(&ip_vs_conn_tab_used);
+		hlist_for_each_entry_safe(cp, n, &t->buckets[idx], c_list) {
+			unsigned int hash = ip_vs_conn_hashkey_conn(cp);
+
+			hlist_del_rcu(&cp->c_list);
+			hlist_add_head_rcu(&cp->c_list,
+					   &new_tab->buckets[hash & new_tab->mask]);
+			ip_vs_conn_tab_add_stats(cp);
+		}
+		write_seqcount_end(&lock->seq);
+		spin_unlock_bh(&lock->l);
+		if (!(idx & 1023))
+			cond_resched();
+	}
+
+	/* Lookups that still see the old table follow its new_tab pointer */
+	rcu_assign_pointer(ip_vs_conn_tab, new_tab);
+	smp_wmb();
+	WRITE_ONCE(ip_vs_conn_tab_gen, ip_vs_conn_tab_gen + 1);
+	ip_vs_conn_tab_size = new_tab->size;
+	if (new_tab->size > t->size)
+		ip_vs_conn_tab_grows++;
+	else
+		ip_vs_conn_tab_shrinks++;
+
+	synchronize_rcu();
+	kvfree(t);
+}
+
+/* Keep the average chain length between 1/8 and 2 */
+static void ip_vs_conn_resize_handler(struct work_struct *work)
+{
+	struct ip_vs_conn_tab *t = rcu_dereference_protected(ip_vs_conn_tab, 1);
+	s64 count = percpu_counter_read_positive(&ip_vs_conn_tab_count);
+	unsigned long period = READ_ONCE(ip_vs_conn_resize_period);
+	int bits = ilog2(t->size), new_bits;
+
+	new_bits = count ? order_base_2(count) : 0;
+	new_bits = clamp(new_bits, ip_vs_conn_tab_bits, ip_vs_conn_tab_max_bits);
+
+	if ((count > 2 * (s64)t->size && new_bits > bits) ||
+	    (count < t->size / 8 && new_bits < bits)) {
+		IP_VS_DBG(2, "resizing connection table %u -> %u buckets "
+			  "(%lld connections)\n", t->size, 1U << new_bits,
+			  count);
+		ip_vs_conn_tab_resize(new_bits);
+		period = IP_VS_CONN_RESIZE_PERIOD;
+	} else {
+		period = min_t(unsigned long, 2 * period,
+			       IP_VS_CONN_RESIZE_MAX_PERIOD);
+	}
+
+	WRITE_ONCE(ip_vs_conn_resize_period, period);
+	queue_delayed_work(system_long_wq, &ip_vs_conn_resize_work, period);
+}
+
+#ifdef CONFIG_PROC_FS
+/* Connection table statistics for /proc/net/ip_vs_stats.  Only running
+ * counters are reported, reading the file never walks the table.  Used
+ * counts the non-empty buckets, MaxChain is the longest chain since the
+ * last resize.
+ */
+void ip_vs_conn_tab_stats_show(struct seq_file *seq)
+{
+	struct ip_vs_conn_tab *t;
+	unsigned int size;
+
+	rcu_read_lock();
+	t = rcu_dereference(ip_vs_conn_tab);
+	size = t->size;
+	rcu_read_unlock();
+
+/*               01234567 01234567 01234567 01234567 01234567 01234567 */
+	seq_puts(seq,
+		 "\n TabSize  Entries     Used MaxChain    Grows  Shrinks\n");
+	seq_printf(seq, "%8X %8LX %8LX %8X %8X %8X\n",
+		   size,
+		   (unsigned long long)percpu_counter_sum_positive(&ip_vs_conn_tab_count),
+		   (unsigned long long)percpu_counter_sum_positive(&ip_vs_conn_tab_used),
+		   READ_ONCE(ip_vs_conn_tab_max_chain),
+		   READ_ONCE(ip_vs_conn_tab_grows),
+		   READ_ONCE(ip_vs_conn_tab_shrinks));
+}
+#endif
+
 /*
  * per netns init and exit
  */
@@ -1465,26 +1831,40 @@ void __net_exit ip_vs_conn_net_cleanup(struct netns_ipvs *ipvs)
 
 int __init ip_vs_conn_init(void)
 {
+	struct ip_vs_conn_tab *t;
 	int idx;
 
-	/* Compute size and mask */
+	/* Buckets must not share a lock with buckets of other hash values */
+	ip_vs_conn_tab_bits = max(ip_vs_conn_tab_bits, CT_LOCKARRAY_BITS);
+	ip_vs_conn_tab_max_bits = clamp(ip_vs_conn_tab_max_bits,
+					ip_vs_conn_tab_bits, 30);
 	ip_vs_conn_tab_size = 1 << ip_vs_conn_tab_bits;
-	ip_vs_conn_tab_mask = ip_vs_conn_tab_size - 1;
 
 	/*
 	 * Allocate the connection hash table and initialize its list heads
 	 */
-	ip_vs_conn_tab = vmalloc(array_size(ip_vs_conn_tab_size,
-					    sizeof(*ip_vs_conn_tab)));
-	if (!ip_vs_conn_tab)
+	t = ip_vs_conn_tab_alloc(ip_vs_conn_tab_bits);
+	if (!t)
+		return -ENOMEM;
+
+	if (percpu_counter_init(&ip_vs_conn_tab_count, 0, GFP_KERNEL)) {
+		kvfree(t);
+		return -ENOMEM;
+	}
+	if (percpu_counter_init(&ip_vs_conn_tab_used, 0, GFP_KERNEL)) {
+		percpu_counter_destroy(&ip_vs_conn_tab_count);
+		kvfree(t);
 		return -ENOMEM;
+	}
 
 	/* Allocate ip_vs_conn slab cache */
 	ip_vs_conn_cachep = kmem_cache_create("ip_vs_conn",
 					      sizeof(struct ip_vs_conn), 0,
 					      SLAB_HWCACHE_ALIGN, NULL);
 	if (!ip_vs_conn_cachep) {
-		vfree(ip_vs_conn_tab);
+		percpu_counter_destroy(&ip_vs_conn_tab_used);
+		percpu_counter_destroy(&ip_vs_conn_tab_count);
+		kvfree(t);
 		return -ENOMEM;
 	}
 
@@ -1495,24 +1875,31 @@ int __init ip_vs_conn_init(void)
 	IP_VS_DBG(0, "Each connection entry needs %zd bytes at least\n",
 		  sizeof(struct ip_vs_conn));
 
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++)
-		INIT_HLIST_HEAD(&ip_vs_conn_tab[idx]);
-
 	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)  {
 		spin_lock_init(&__ip_vs_conntbl_lock_array[idx].l);
+		seqcount_spinlock_init(&__ip_vs_conntbl_lock_array[idx].seq,
+				       &__ip_vs_conntbl_lock_array[idx].l);
 	}
 
 	/* calculate the random value for connection hash */
 	get_random_bytes(&ip_vs_conn_rnd, sizeof(ip_vs_conn_rnd));
 
+	rcu_assign_pointer(ip_vs_conn_tab, t);
+	if (ip_vs_conn_tab_max_bits > ip_vs_conn_tab_bits)
+		queue_delayed_work(system_long_wq, &ip_vs_conn_resize_work,
+				   IP_VS_CONN_RESIZE_PERIOD);
+
 	return 0;
 }
 
 void ip_vs_conn_cleanup(void)
 {
+	cancel_delayed_work_sync(&ip_vs_conn_resize_work);
 	/* Wait all ip_vs_conn_rcu_free() callbacks to complete */
 	rcu_barrier();
 	/* Release the empty cache */
 	kmem_cache_destroy(ip_vs_conn_cachep);
-	vfree(ip_vs_conn_tab);
+	percpu_counter_destroy(&ip_vs_conn_tab_used);
+	percpu_counter_destroy(&ip_vs_conn_tab_count);
+	kvfree(rcu_dereference_protected(ip_vs_conn_tab, 1));
 }
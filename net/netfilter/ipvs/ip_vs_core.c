@@ -52,6 +52,8 @@
 #include <net/ip_vs.h>
 #include <linux/indirect_call_wrapper.h>
 
+#include "ip_vs_internals.h"
+
 
 EXPORT_SYMBOL(register_ip_vs_scheduler);
 EXPORT_SYMBOL(unregister_ip_vs_scheduler);
@@ -2523,10 +2525,14 @@ static int __init ip_vs_init(void)
 		goto cleanup_protocol;
 	}
 
-	ret = register_pernet_subsys(&ipvs_core_ops);	/* Alloc ip_vs struct */
+	ret = ip_vs_estimator_init();
 	if (ret < 0)
 		goto cleanup_conn;
 
+	ret = register_pernet_subsys(&ipvs_core_ops);	/* Alloc ip_vs struct */
+	if (ret < 0)
+		goto cleanup_est;
+
 	ret = register_pernet_device(&ipvs_core_dev_ops);
 	if (ret < 0)
 		goto cleanup_sub;
@@ -2545,6 +2551,8 @@ static int __init ip_vs_init(void)
 	unregister_pernet_device(&ipvs_core_dev_ops);
 cleanup_sub:
 	unregister_pernet_subsys(&ipvs_core_ops);
+cleanup_est:
+	ip_vs_estimator_cleanup();
 cleanup_conn:
 	ip_vs_conn_cleanup();
 cleanup_protocol:
@@ -2559,6 +2567,7 @@ static void __exit ip_vs_cleanup(void)
 	ip_vs_unregister_nl_ioctl();
 	unregister_pernet_device(&ipvs_core_dev_ops);
 	unregister_pernet_subsys(&ipvs_core_ops);	/* free ip_vs struct */
+	ip_vs_estimator_cleanup();
 	ip_vs_conn_cleanup();
 	ip_vs_protocol_cleanup();
 	ip_vs_control_cleanup();
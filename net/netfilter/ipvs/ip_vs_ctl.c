@@ -48,6 +48,8 @@
 
 #include <net/ip_vs.h>
 
+#include "ip_vs_internals.h"
+
 /* semaphore for IPVS sockopts. And, [gs]etsockopt may sleep. */
 static DEFINE_MUTEX(__ip_vs_mutex);
 
@@ -1847,6 +1849,31 @@ proc_do_sync_ports(struct ctl_table *table, int write,
 	return rc;
 }
 
+/* Writing 1 sends the whole connection table to the backups */
+static int
+proc_do_sync_full(struct ctl_table *table, int write,
+		  void *buffer, size_t *lenp, loff_t *ppos)
+{
+	struct netns_ipvs *ipvs = table->extra2;
+	int val = 0;
+	int rc;
+
+	struct ctl_table tmp = {
+		.data = &val,
+		.maxlen = sizeof(int),
+		.mode = table->mode,
+	};
+
+	rc = proc_dointvec(&tmp, write, buffer, lenp, ppos);
+	if (write && !rc && val) {
+		if (val != 1)
+			rc = -EINVAL;
+		else
+			rc = ip_vs_sync_full_table(ipvs);
+	}
+	return rc;
+}
+
 /*
  *	IPVS sysctl table (under the /proc/sys/net/ipv4/vs/)
  *	Do not change order or insert new entries without
@@ -2017,6 +2044,12 @@ static struct ctl_table vs_vars[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+	{
+		.procname	= "sync_full",
+		.maxlen		= sizeof(int),
+		.mode		= 0200,
+		.proc_handler	= proc_do_sync_full,
+	},
 #ifdef CONFIG_IP_VS_DEBUG
 	{
 		.procname	= "debug_level",
@@ -2271,6 +2304,11 @@ static int ip_vs_stats_show(struct seq_file *seq, void *v)
 		   (unsigned long long)show.inbps,
 		   (unsigned long long)show.outbps);
 
+	/* The connection table is shared by all netns */
+	if (net_eq(net, &init_net))
+		ip_vs_conn_tab_stats_show(seq);
+	ip_vs_est_stats_show(seq, net_ipvs(net));
+
 	return 0;
 }
 
@@ -4044,7 +4082,8 @@ static int __net_init ip_vs_control_net_init_sysctl(struct netns_ipvs *ipvs)
 		tbl = vs_vars;
 	/* Initialize sysctl defaults */
 	for (idx = 0; idx < ARRAY_SIZE(vs_vars); idx++) {
-		if (tbl[idx].proc_handler == proc_do_defense_mode)
+		if (tbl[idx].proc_handler == proc_do_defense_mode ||
+		    tbl[idx].proc_handler == proc_do_sync_full)
 			tbl[idx].extra2 = ipvs;
 	}
 	idx = 0;
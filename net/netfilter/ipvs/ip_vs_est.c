@@ -10,6 +10,11 @@
  *              Affected data: est_list and est_lock.
  *              estimation_timer() runs with timer per netns.
  *              get_stats()) do the per cpu summing.
+ *
+ *              Estimation moved from the per netns timer to a per netns
+ *              work that handles one time slice of the estimators per tick.
+ *              The estimators are kept in the slices of struct
+ *              ip_vs_est_ctl, est_list is no longer used.
  */
 
 #define KMSG_COMPONENT "IPVS"
@@ -21,8 +26,17 @@
 #include <linux/interrupt.h>
 #include <linux/sysctl.h>
 #include <linux/list.h>
+#include <linux/hash.h>
+#include <linux/module.h>
+#include <linux/workqueue.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
 
 #include <net/ip_vs.h>
+#include <net/netns/generic.h>
+
+#include "ip_vs_internals.h"
 
 /*
   This code is to estimate rate in a shorter interval (such as 8
@@ -47,8 +61,65 @@
     to 32-bit values for conns, packets, bps, cps and pps.
 
   * A lot of code is taken from net/core/gen_estimator.c
+
+  * The 2 second period is split into est_ticks time slices. Every
+    estimator is hashed to one slice of its netns. The per netns est_timer
+    fires once per tick and queues the estimation work on the next online
+    cpu, so each tick only touches a fraction of the estimators, the per
+    cpu summing is done in process context and the load is spread over
+    all cpus.
  */
 
+#define IP_VS_EST_PERIOD	(2 * HZ)
+#define IP_VS_EST_MAX_TICKS	100
+
+static int ip_vs_est_ticks = 50;
+module_param_named(est_ticks, ip_vs_est_ticks, int, 0444);
+MODULE_PARM_DESC(est_ticks, "Number of slices the estimation period is split into");
+
+struct ip_vs_est_slice {
+	struct list_head	list;
+	unsigned int		count;
+};
+
+/* Per netns estimation state */
+struct ip_vs_est_ctl {
+	struct netns_ipvs	*ipvs;
+	struct work_struct	work;
+	bool			stopping;
+	int			cpu;		/* cpu for the next tick */
+	unsigned int		ticks;
+	unsigned int		tick;
+	unsigned long		round_start;
+
+	/* Cost of the estimation, reported in /proc/net/ip_vs_stats */
+	u64			round_ns;	/* last full period */
+	u64			round_acc_ns;
+	u64			tick_max_ns;
+
+	struct ip_vs_est_slice	slices[];
+};
+
+/* Each netns has a pointer to its ip_vs_est_ctl in the net_generic()
+ * slot of ip_vs_est_net_id. ip_vs_estimator_init() registers it before
+ * the IPVS core, so the slot is there in ip_vs_estimator_net_init().
+ */
+static unsigned int ip_vs_est_net_id __read_mostly;
+
+static struct pernet_operations ip_vs_est_ops = {
+	.id   = &ip_vs_est_net_id,
+	.size = sizeof(struct ip_vs_est_ctl *),
+};
+
+static inline struct ip_vs_est_ctl **ip_vs_est_ctlp(struct netns_ipvs *ipvs)
+{
+	return net_generic(ipvs->net, ip_vs_est_net_id);
+}
+
+static inline struct ip_vs_est_ctl *ip_vs_est_ctl(struct netns_ipvs *ipvs)
+{
+	return *ip_vs_est_ctlp(ipvs);
+}
 
 /*
  * Make a summary from each cpu
@@ -93,64 +164,119 @@ static void ip_vs_read_cpu_stats(struct ip_vs_kstats *sum,
 }
 
 
-static void estimation_timer(struct timer_list *t)
+static struct ip_vs_est_slice *ip_vs_est_slice(struct ip_vs_est_ctl *ctl,
+					       struct ip_vs_estimator *est)
 {
-	struct ip_vs_estimator *e;
-	struct ip_vs_stats *s;
+	return &ctl->slices[hash_ptr(est, 32) % ctl->ticks];
+}
+
+static void ip_vs_estimate(struct ip_vs_estimator *e)
+{
+	struct ip_vs_stats *s = container_of(e, struct ip_vs_stats, est);
 	u64 rate;
-	struct netns_ipvs *ipvs = from_timer(ipvs, t, est_timer);
 
-	spin_lock(&ipvs->est_lock);
-	list_for_each_entry(e, &ipvs->est_list, list) {
-		s = container_of(e, struct ip_vs_stats, est);
+	spin_lock_bh(&s->lock);
+	ip_vs_read_cpu_stats(&s->kstats, s->cpustats);
 
-		spin_lock(&s->lock);
-		ip_vs_read_cpu_stats(&s->kstats, s->cpustats);
+	/* scaled by 2^10, but divided 2 seconds */
+	rate = (s->kstats.conns - e->last_conns) << 9;
+	e->last_conns = s->kstats.conns;
+	e->cps += ((s64)rate - (s64)e->cps) >> 2;
 
-		/* scaled by 2^10, but divided 2 seconds */
-		rate = (s->kstats.conns - e->last_conns) << 9;
-		e->last_conns = s->kstats.conns;
-		e->cps += ((s64)rate - (s64)e->cps) >> 2;
+	rate = (s->kstats.inpkts - e->last_inpkts) << 9;
+	e->last_inpkts = s->kstats.inpkts;
+	e->inpps += ((s64)rate - (s64)e->inpps) >> 2;
 
-		rate = (s->kstats.inpkts - e->last_inpkts) << 9;
-		e->last_inpkts = s->kstats.inpkts;
-		e->inpps += ((s64)rate - (s64)e->inpps) >> 2;
+	rate = (s->kstats.outpkts - e->last_outpkts) << 9;
+	e->last_outpkts = s->kstats.outpkts;
+	e->outpps += ((s64)rate - (s64)e->outpps) >> 2;
 
-		rate = (s->kstats.outpkts - e->last_outpkts) << 9;
-		e->last_outpkts = s->kstats.outpkts;
-		e->outpps += ((s64)rate - (s64)e->outpps) >> 2;
+	/* scaled by 2^5, but divided 2 seconds */
+	rate = (s->kstats.inbytes - e->last_inbytes) << 4;
+	e->last_inbytes = s->kstats.inbytes;
+	e->inbps += ((s64)rate - (s64)e->inbps) >> 2;
+
+	rate = (s->kstats.outbytes - e->last_outbytes) << 4;
+	e->last_outbytes = s->kstats.outbytes;
+	e->outbps += ((s64)rate - (s64)e->outbps) >> 2;
+	spin_unlock_bh(&s->lock);
+}
+
+static void estimation_timer(struct timer_list *t)
+{
+	struct netns_ipvs *ipvs = from_timer(ipvs, t, est_timer);
+	struct ip_vs_est_ctl *ctl = ip_vs_est_ctl(ipvs);
+	int cpu;
+
+	if (READ_ONCE(ctl->stopping))
+		return;
+
+	/* Move to the next online cpu on every tick */
+	cpu = cpumask_next(ctl->cpu, cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		cpu = cpumask_first(cpu_online_mask);
+	ctl->cpu = cpu;
+	queue_work_on(cpu, system_wq, &ctl->work);
+}
 
-		/* scaled by 2^5, but divided 2 seconds */
-		rate = (s->kstats.inbytes - e->last_inbytes) << 4;
-		e->last_inbytes = s->kstats.inbytes;
-		e->inbps += ((s64)rate - (s64)e->inbps) >> 2;
+static void ip_vs_est_work_handler(struct work_struct *work)
+{
+	struct ip_vs_est_ctl *ctl = container_of(work, struct ip_vs_est_ctl,
+						 work);
+	struct netns_ipvs *ipvs = ctl->ipvs;
+	struct ip_vs_est_slice *slice = &ctl->slices[ctl->tick];
+	struct ip_vs_estimator *e;
+	unsigned long next;
+	u64 start, cost;
 
-		rate = (s->kstats.outbytes - e->last_outbytes) << 4;
-		e->last_outbytes = s->kstats.outbytes;
-		e->outbps += ((s64)rate - (s64)e->outbps) >> 2;
-		spin_unlock(&s->lock);
+	start = ktime_get_ns();
+	spin_lock_bh(&ipvs->est_lock);
+	list_for_each_entry(e, &slice->list, list)
+		ip_vs_estimate(e);
+	spin_unlock_bh(&ipvs->est_lock);
+	cost = ktime_get_ns() - start;
+
+	if (cost > ctl->tick_max_ns)
+		WRITE_ONCE(ctl->tick_max_ns, cost);
+	ctl->round_acc_ns += cost;
+	if (++ctl->tick == ctl->ticks) {
+		ctl->tick = 0;
+		ctl->round_start += IP_VS_EST_PERIOD;
+		WRITE_ONCE(ctl->round_ns, ctl->round_acc_ns);
+		ctl->round_acc_ns = 0;
 	}
-	spin_unlock(&ipvs->est_lock);
-	mod_timer(&ipvs->est_timer, jiffies + 2*HZ);
+
+	if (READ_ONCE(ctl->stopping))
+		return;
+
+	/* Keep every slice on a 2 second period even if a tick was late */
+	next = ctl->round_start + IP_VS_EST_PERIOD * ctl->tick / ctl->ticks;
+	mod_timer(&ipvs->est_timer, time_after(next, jiffies) ? next : jiffies);
 }
 
 void ip_vs_start_estimator(struct netns_ipvs *ipvs, struct ip_vs_stats *stats)
 {
 	struct ip_vs_estimator *est = &stats->est;
+	struct ip_vs_est_slice *slice = ip_vs_est_slice(ip_vs_est_ctl(ipvs),
+							est);
 
 	INIT_LIST_HEAD(&est->list);
 
 	spin_lock_bh(&ipvs->est_lock);
-	list_add(&est->list, &ipvs->est_list);
+	list_add(&est->list, &slice->list);
+	slice->count++;
 	spin_unlock_bh(&ipvs->est_lock);
 }
 
 void ip_vs_stop_estimator(struct netns_ipvs *ipvs, struct ip_vs_stats *stats)
 {
 	struct ip_vs_estimator *est = &stats->est;
+	struct ip_vs_est_slice *slice = ip_vs_est_slice(ip_vs_est_ctl(ipvs),
+							est);
 
 	spin_lock_bh(&ipvs->est_lock);
 	list_del(&est->list);
+	slice->count--;
 	spin_unlock_bh(&ipvs->est_lock);
 }
 
@@ -184,16 +310,72 @@ void ip_vs_read_estimator(struct ip_vs_kstats *dst, struct ip_vs_stats *stats)
 	dst->outbps = (e->outbps + 0xF) >> 5;
 }
 
+#ifdef CONFIG_PROC_FS
+void ip_vs_est_stats_show(struct seq_file *seq, struct netns_ipvs *ipvs)
+{
+	struct ip_vs_est_ctl *ctl = ip_vs_est_ctl(ipvs);
+	unsigned int i, count, total = 0, max_count = 0;
+
+	for (i = 0; i < ctl->ticks; i++) {
+		count = READ_ONCE(ctl->slices[i].count);
+		total += count;
+		max_count = max(max_count, count);
+	}
+
+/*               01234567 01234567 01234567 01234567890 01234567890 */
+	seq_puts(seq,
+		 "\n   Ticks     Ests MaxSlice  Period(us) MaxTick(us)\n");
+	seq_printf(seq, "%8X %8X %8X %11llu %11llu\n",
+		   ctl->ticks, total, max_count,
+		   div_u64(READ_ONCE(ctl->round_ns), NSEC_PER_USEC),
+		   div_u64(READ_ONCE(ctl->tick_max_ns), NSEC_PER_USEC));
+}
+#endif
+
 int __net_init ip_vs_estimator_net_init(struct netns_ipvs *ipvs)
 {
-	INIT_LIST_HEAD(&ipvs->est_list);
+	struct ip_vs_est_ctl *ctl;
+	unsigned int i, ticks;
+
+	ticks = clamp(ip_vs_est_ticks, 1, IP_VS_EST_MAX_TICKS);
+	ctl = kzalloc(struct_size(ctl, slices, ticks), GFP_KERNEL);
+	if (!ctl)
+		return -ENOMEM;
+
+	ctl->ipvs = ipvs;
+	ctl->ticks = ticks;
+	ctl->cpu = -1;
+	for (i = 0; i < ticks; i++)
+		INIT_LIST_HEAD(&ctl->slices[i].list);
+	INIT_WORK(&ctl->work, ip_vs_est_work_handler);
+
+	*ip_vs_est_ctlp(ipvs) = ctl;
 	spin_lock_init(&ipvs->est_lock);
 	timer_setup(&ipvs->est_timer, estimation_timer, 0);
-	mod_timer(&ipvs->est_timer, jiffies + 2 * HZ);
+	ctl->round_start = jiffies + IP_VS_EST_PERIOD;
+	mod_timer(&ipvs->est_timer, ctl->round_start);
 	return 0;
 }
 
 void __net_exit ip_vs_estimator_net_cleanup(struct netns_ipvs *ipvs)
 {
+	struct ip_vs_est_ctl *ctl = ip_vs_est_ctl(ipvs);
+
+	/* The work re-arms the timer and the timer queues the work */
+	WRITE_ONCE(ctl->stopping, true);
+	del_timer_sync(&ipvs->est_timer);
+	cancel_work_sync(&ctl->work);
 	del_timer_sync(&ipvs->est_timer);
+	*ip_vs_est_ctlp(ipvs) = NULL;
+	kfree(ctl);
+}
+
+int __init ip_vs_estimator_init(void)
+{
+	return register_pernet_subsys(&ip_vs_est_ops);
+}
+
+void ip_vs_estimator_cleanup(void)
+{
+	unregister_pernet_subsys(&ip_vs_est_ops);
 }
@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _IP_VS_INTERNALS_H
+#define _IP_VS_INTERNALS_H
+
+/* Declarations shared by the IPVS core files only */
+
+struct seq_file;
+struct netns_ipvs;
+struct ip_vs_conn;
+
+/* ip_vs_conn.c */
+int ip_vs_conn_sync_all(struct netns_ipvs *ipvs);
+#ifdef CONFIG_PROC_FS
+void ip_vs_conn_tab_stats_show(struct seq_file *seq);
+#endif
+
+/* ip_vs_est.c */
+int ip_vs_estimator_init(void);
+void ip_vs_estimator_cleanup(void);
+#ifdef CONFIG_PROC_FS
+void ip_vs_est_stats_show(struct seq_file *seq, struct netns_ipvs *ipvs);
+#endif
+
+/* ip_vs_sync.c */
+int ip_vs_sync_conn_bulk(struct netns_ipvs *ipvs, struct ip_vs_conn *cp);
+int ip_vs_sync_bulk_wait(struct netns_ipvs *ipvs);
+int ip_vs_sync_full_table(struct netns_ipvs *ipvs);
+
+#endif /* _IP_VS_INTERNALS_H */
@@ -50,6 +50,8 @@
 #include <linux/wait.h>
 #include <linux/kernel.h>
 #include <linux/sched/signal.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 
 #include <asm/unaligned.h>		/* Used for ntoh_seq and hton_seq */
 
@@ -58,6 +60,8 @@
 
 #include <net/ip_vs.h>
 
+#include "ip_vs_internals.h"
+
 #define IP_VS_SYNC_GROUP 0xe0000051    /* multicast addr - 224.0.0.81 */
 #define IP_VS_SYNC_PORT  8848          /* multicast port */
 
@@ -200,6 +204,14 @@ struct ip_vs_sync_thread_data {
 	struct socket *sock;
 	char *buf;
 	int id;
+	/* master: protects ms->sync_buff of this thread */
+	spinlock_t buff_lock;
+	/* statistics for /proc/net/ip_vs_sync_stats */
+	unsigned long msgs;
+	unsigned long conns;
+	unsigned long dropped;		/* master: queue was full */
+	unsigned int lag;		/* master: ms from first conn to send */
+	unsigned int max_lag;
 };
 
 /* Version 0 definition of packet sizes */
@@ -377,8 +389,11 @@ static inline void sb_queue_tail(struct netns_ipvs *ipvs,
 
 			wake_up_process(ipvs->master_tinfo[id].task);
 		}
-	} else
+	} else {
+		if (ipvs->sync_state & IP_VS_STATE_MASTER)
+			ipvs->master_tinfo[ms - ipvs->ms].dropped++;
 		ip_vs_sync_buff_release(sb);
+	}
 	spin_unlock(&ipvs->sync_lock);
 }
 
@@ -387,19 +402,19 @@ static inline void sb_queue_tail(struct netns_ipvs *ipvs,
  *	than the specified time or the specified time is zero.
  */
 static inline struct ip_vs_sync_buff *
-get_curr_sync_buff(struct netns_ipvs *ipvs, struct ipvs_master_sync_state *ms,
-		   unsigned long time)
+get_curr_sync_buff(struct ip_vs_sync_thread_data *tinfo,
+		   struct ipvs_master_sync_state *ms, unsigned long time)
 {
 	struct ip_vs_sync_buff *sb;
 
-	spin_lock_bh(&ipvs->sync_buff_lock);
+	spin_lock_bh(&tinfo->buff_lock);
 	sb = ms->sync_buff;
 	if (sb && time_after_eq(jiffies - sb->firstuse, time)) {
 		ms->sync_buff = NULL;
 		__set_current_state(TASK_RUNNING);
 	} else
 		sb = NULL;
-	spin_unlock_bh(&ipvs->sync_buff_lock);
+	spin_unlock_bh(&tinfo->buff_lock);
 	return sb;
 }
 
@@ -544,6 +559,7 @@ static void ip_vs_sync_conn_v0(struct netns_ipvs *ipvs, struct ip_vs_conn *cp,
 	struct ip_vs_sync_conn_v0 *s;
 	struct ip_vs_sync_buff *buff;
 	struct ipvs_master_sync_state *ms;
+	struct ip_vs_sync_thread_data *tinfo;
 	int id;
 	unsigned int len;
 
@@ -556,14 +572,16 @@ static void ip_vs_sync_conn_v0(struct netns_ipvs *ipvs, struct ip_vs_conn *cp,
 	if (!ip_vs_sync_conn_needed(ipvs, cp, pkts))
 		return;
 
-	spin_lock_bh(&ipvs->sync_buff_lock);
-	if (!(ipvs->sync_state & IP_VS_STATE_MASTER)) {
-		spin_unlock_bh(&ipvs->sync_buff_lock);
+	rcu_read_lock();
+	if (!(smp_load_acquire(&ipvs->sync_state) & IP_VS_STATE_MASTER)) {
+		rcu_read_unlock();
 		return;
 	}
 
 	id = select_master_thread_id(ipvs, cp);
 	ms = &ipvs->ms[id];
+	tinfo = &ipvs->master_tinfo[id];
+	spin_lock_bh(&tinfo->buff_lock);
 	buff = ms->sync_buff;
 	len = (cp->flags & IP_VS_CONN_F_SEQ_MASK) ? FULL_CONN_SIZE :
 		SIMPLE_CONN_SIZE;
@@ -579,7 +597,8 @@ static void ip_vs_sync_conn_v0(struct netns_ipvs *ipvs, struct ip_vs_conn *cp,
 	if (!buff) {
 		buff = ip_vs_sync_buff_create_v0(ipvs, len);
 		if (!buff) {
-			spin_unlock_bh(&ipvs->sync_buff_lock);
+			spin_unlock_bh(&tinfo->buff_lock);
+			rcu_read_unlock();
 			pr_err("ip_vs_sync_buff_create failed.\n");
 			return;
 		}
@@ -609,7 +628,8 @@ static void ip_vs_sync_conn_v0(struct netns_ipvs *ipvs, struct ip_vs_conn *cp,
 	m->nr_conns++;
 	m->size = htons(ntohs(m->size) + len);
 	buff->head += len;
-	spin_unlock_bh(&ipvs->sync_buff_lock);
+	spin_unlock_bh(&tinfo->buff_lock);
+	rcu_read_unlock();
 
 	/* synchronize its controller if it has */
 	cp = cp->control;
@@ -623,50 +643,41 @@ static void ip_vs_sync_conn_v0(struct netns_ipvs *ipvs, struct ip_vs_conn *cp,
 }
 
 /*
- *      Add an ip_vs_conn information into the current sync_buff.
- *      Called by ip_vs_in.
- *      Sending Version 1 messages
+ *      Add an ip_vs_conn information into the current sync_buff of
+ *      its master thread, Version 1 format.
+ *      The master state is checked under RCU, stop_sync_thread() waits
+ *      for a grace period before it releases the thread data.
  */
-void ip_vs_sync_conn(struct netns_ipvs *ipvs, struct ip_vs_conn *cp, int pkts)
+static int __ip_vs_sync_conn(struct netns_ipvs *ipvs, struct ip_vs_conn *cp)
 {
 	struct ip_vs_sync_mesg *m;
 	union ip_vs_sync_conn *s;
 	struct ip_vs_sync_buff *buff;
 	struct ipvs_master_sync_state *ms;
+	struct ip_vs_sync_thread_data *tinfo;
 	int id;
 	__u8 *p;
 	unsigned int len, pe_name_len, pad;
 
-	/* Handle old version of the protocol */
-	if (sysctl_sync_ver(ipvs) == 0) {
-		ip_vs_sync_conn_v0(ipvs, cp, pkts);
-		return;
-	}
-	/* Do not sync ONE PACKET */
-	if (cp->flags & IP_VS_CONN_F_ONE_PACKET)
-		goto control;
-sloop:
-	if (!ip_vs_sync_conn_needed(ipvs, cp, pkts))
-		goto control;
-
 	/* Sanity checks */
 	pe_name_len = 0;
 	if (cp->pe_data_len) {
 		if (!cp->pe_data || !cp->dest) {
 			IP_VS_ERR_RL("SYNC, connection pe_data invalid\n");
-			return;
+			return -EINVAL;
 		}
 		pe_name_len = strnlen(cp->pe->name, IP_VS_PENAME_MAXLEN);
 	}
 
-	spin_lock_bh(&ipvs->sync_buff_lock);
-	if (!(ipvs->sync_state & IP_VS_STATE_MASTER)) {
-		spin_unlock_bh(&ipvs->sync_buff_lock);
-		return;
+	rcu_read_lock();
+	if (!(smp_load_acquire(&ipvs->sync_state) & IP_VS_STATE_MASTER)) {
+		rcu_read_unlock();
+		return -ESRCH;
 	}
 
 	id = select_master_thread_id(ipvs, cp);
 	ms = &ipvs->ms[id];
+	tinfo = &ipvs->master_tinfo[id];
 
 #ifdef CONFIG_IP_VS_IPV6
 	if (cp->af == AF_INET6)
@@ -684,6 +695,7 @@ void ip_vs_sync_conn(struct netns_ipvs *ipvs, struct ip_vs_conn *cp, int pkts)
 		len += pe_name_len + 2;
 
 	/* check if there is a space for this one  */
+	spin_lock_bh(&tinfo->buff_lock);
 	pad = 0;
 	buff = ms->sync_buff;
 	if (buff) {
@@ -701,9 +713,10 @@ void ip_vs_sync_conn(struct netns_ipvs *ipvs, struct ip_vs_conn *cp, int pkts)
 	if (!buff) {
 		buff = ip_vs_sync_buff_create(ipvs, len);
 		if (!buff) {
-			spin_unlock_bh(&ipvs->sync_buff_lock);
+			spin_unlock_bh(&tinfo->buff_lock);
+			rcu_read_unlock();
 			pr_err("ip_vs_sync_buff_create failed.\n");
-			return;
+			return -ENOMEM;
 		}
 		ms->sync_buff = buff;
 		m = buff->mesg;
@@ -768,7 +781,32 @@ void ip_vs_sync_conn(struct netns_ipvs *ipvs, struct ip_vs_conn *cp, int pkts)
 		}
 	}
 
-	spin_unlock_bh(&ipvs->sync_buff_lock);
+	spin_unlock_bh(&tinfo->buff_lock);
+	rcu_read_unlock();
+	return 0;
+}
+
+/*
+ *      Add an ip_vs_conn information into the current sync_buff.
+ *      Called by ip_vs_in.
+ *      Sending Version 1 messages
+ */
+void ip_vs_sync_conn(struct netns_ipvs *ipvs, struct ip_vs_conn *cp, int pkts)
+{
+	/* Handle old version of the protocol */
+	if (sysctl_sync_ver(ipvs) == 0) {
+		ip_vs_sync_conn_v0(ipvs, cp, pkts);
+		return;
+	}
+	/* Do not sync ONE PACKET */
+	if (cp->flags & IP_VS_CONN_F_ONE_PACKET)
+		goto control;
+sloop:
+	if (!ip_vs_sync_conn_needed(ipvs, cp, pkts))
+		goto control;
+
+	if (__ip_vs_sync_conn(ipvs, cp))
+		return;
 
 control:
 	/* synchronize its controller if it has */
@@ -954,10 +992,11 @@ static void ip_vs_proc_conn(struct netns_ipvs *ipvs, struct ip_vs_conn_param *pa
 }
 
 /*
- *  Process received multicast message for Version 0
+ *  Process received multicast message for Version 0,
+ *  returns the number of connections processed
  */
-static void ip_vs_process_message_v0(struct netns_ipvs *ipvs, const char *buffer,
-				     const size_t buflen)
+static int ip_vs_process_message_v0(struct netns_ipvs *ipvs, const char *buffer,
+				    const size_t buflen)
 {
 	struct ip_vs_sync_mesg_v0 *m = (struct ip_vs_sync_mesg_v0 *)buffer;
 	struct ip_vs_sync_conn_v0 *s;
@@ -973,7 +1012,7 @@ static void ip_vs_process_message_v0(struct netns_ipvs *ipvs, const char *buffer
 
 		if (p + SIMPLE_CONN_SIZE > buffer+buflen) {
 			IP_VS_ERR_RL("BACKUP v0, bogus conn\n");
-			return;
+			return i;
 		}
 		s = (struct ip_vs_sync_conn_v0 *) p;
 		flags = ntohs(s->flags) | IP_VS_CONN_F_SYNC;
@@ -983,7 +1022,7 @@ static void ip_vs_process_message_v0(struct netns_ipvs *ipvs, const char *buffer
 			p += FULL_CONN_SIZE;
 			if (p > buffer+buflen) {
 				IP_VS_ERR_RL("BACKUP v0, Dropping buffer bogus conn options\n");
-				return;
+				return i;
 			}
 		} else {
 			opt = NULL;
@@ -1020,6 +1059,7 @@ static void ip_vs_process_message_v0(struct netns_ipvs *ipvs, const char *buffer
 				(union nf_inet_addr *)&s->daddr, s->dport,
 				0, 0, opt);
 	}
+	return i;
 }
 
 /*
@@ -1199,10 +1239,10 @@ static inline int ip_vs_proc_sync_conn(struct netns_ipvs *ipvs, __u8 *p, __u8 *m
 /*
  *      Process received multicast message and create the corresponding
  *      ip_vs_conn entries.
- *      Handles Version 0 & 1
+ *      Handles Version 0 & 1, returns the number of connections processed
  */
-static void ip_vs_process_message(struct netns_ipvs *ipvs, __u8 *buffer,
-				  const size_t buflen)
+static int ip_vs_process_message(struct netns_ipvs *ipvs, __u8 *buffer,
+				 const size_t buflen)
 {
 	struct ip_vs_sync_mesg *m2 = (struct ip_vs_sync_mesg *)buffer;
 	__u8 *p, *msg_end;
@@ -1210,17 +1250,17 @@ static void ip_vs_process_message(struct netns_ipvs *ipvs, __u8 *buffer,
 
 	if (buflen < sizeof(struct ip_vs_sync_mesg_v0)) {
 		IP_VS_DBG(2, "BACKUP, message header too short\n");
-		return;
+		return 0;
 	}
 
 	if (buflen != ntohs(m2->size)) {
 		IP_VS_DBG(2, "BACKUP, bogus message size\n");
-		return;
+		return 0;
 	}
 	/* SyncID sanity check */
 	if (ipvs->bcfg.syncid != 0 && m2->syncid != ipvs->bcfg.syncid) {
 		IP_VS_DBG(7, "BACKUP, Ignoring syncid = %d\n", m2->syncid);
-		return;
+		return 0;
 	}
 	/* Handle version 1  message */
 	if ((m2->version == SYNC_PROTO_VER) && (m2->reserved == 0)
@@ -1237,7 +1277,7 @@ static void ip_vs_process_message(struct netns_ipvs *ipvs, __u8 *buffer,
 			p = msg_end;
 			if (p + sizeof(s->v4) > buffer+buflen) {
 				IP_VS_ERR_RL("BACKUP, Dropping buffer, too small\n");
-				return;
+				return i;
 			}
 			s = (union ip_vs_sync_conn *)p;
 			size = ntohs(s->v4.ver_size) & SVER_MASK;
@@ -1245,28 +1285,28 @@ static void ip_vs_process_message(struct netns_ipvs *ipvs, __u8 *buffer,
 			/* Basic sanity checks */
 			if (msg_end  > buffer+buflen) {
 				IP_VS_ERR_RL("BACKUP, Dropping buffer, msg > buffer\n");
-				return;
+				return i;
 			}
 			if (ntohs(s->v4.ver_size) >> SVER_SHIFT) {
 				IP_VS_ERR_RL("BACKUP, Dropping buffer, Unknown version %d\n",
 					      ntohs(s->v4.ver_size) >> SVER_SHIFT);
-				return;
+				return i;
 			}
 			/* Process a single sync_conn */
 			retc = ip_vs_proc_sync_conn(ipvs, p, msg_end);
 			if (retc < 0) {
 				IP_VS_ERR_RL("BACKUP, Dropping buffer, Err: %d in decoding\n",
 					     retc);
-				return;
+				return i;
 			}
 			/* Make sure we have 32 bit alignment */
 			msg_end = p + ((size + 3) & ~3);
 		}
 	} else {
 		/* Old type of message */
-		ip_vs_process_message_v0(ipvs, buffer, buflen);
-		return;
+		return ip_vs_process_message_v0(ipvs, buffer, buflen);
 	}
+	return nr_conns;
 }
 
 
@@ -1647,15 +1687,31 @@ static void master_wakeup_work_handler(struct work_struct *work)
 
 /* Get next buffer to send */
 static inline struct ip_vs_sync_buff *
-next_sync_buff(struct netns_ipvs *ipvs, struct ipvs_master_sync_state *ms)
+next_sync_buff(struct ip_vs_sync_thread_data *tinfo,
+	       struct ipvs_master_sync_state *ms)
 {
 	struct ip_vs_sync_buff *sb;
 
-	sb = sb_dequeue(ipvs, ms);
+	sb = sb_dequeue(tinfo->ipvs, ms);
 	if (sb)
 		return sb;
 	/* Do not delay entries in buffer for more than 2 seconds */
-	return get_curr_sync_buff(ipvs, ms, IPVS_SYNC_FLUSH_TIME);
+	return get_curr_sync_buff(tinfo, ms, IPVS_SYNC_FLUSH_TIME);
+}
+
+/* Account a buffer the master thread has sent */
+static void ip_vs_sync_sent(struct ip_vs_sync_thread_data *tinfo,
+			    struct ip_vs_sync_buff *sb)
+{
+	/* nr_conns of Version 0 is where Version 1 has the zero byte */
+	unsigned int conns = sb->mesg->reserved ? : sb->mesg->nr_conns;
+	unsigned int lag = jiffies_to_msecs(jiffies - sb->firstuse);
+
+	tinfo->msgs++;
+	tinfo->conns += conns;
+	WRITE_ONCE(tinfo->lag, lag);
+	if (lag > tinfo->max_lag)
+		WRITE_ONCE(tinfo->max_lag, lag);
 }
 
 static int sync_thread_master(void *data)
@@ -1671,7 +1727,7 @@ static int sync_thread_master(void *data)
 		ipvs->mcfg.mcast_ifn, ipvs->mcfg.syncid, tinfo->id);
 
 	for (;;) {
-		sb = next_sync_buff(ipvs, ms);
+		sb = next_sync_buff(tinfo, ms);
 		if (unlikely(kthread_should_stop()))
 			break;
 		if (!sb) {
@@ -1688,6 +1744,7 @@ static int sync_thread_master(void *data)
 			if (unlikely(kthread_should_stop()))
 				goto done;
 		}
+		ip_vs_sync_sent(tinfo, sb);
 		ip_vs_sync_buff_release(sb);
 	}
 
@@ -1702,7 +1759,7 @@ static int sync_thread_master(void *data)
 	__set_current_state(TASK_RUNNING);
 
 	/* clean up the current sync_buff */
-	sb = get_curr_sync_buff(ipvs, ms, 0);
+	sb = get_curr_sync_buff(tinfo, ms, 0);
 	if (sb)
 		ip_vs_sync_buff_release(sb);
 
@@ -1739,7 +1796,9 @@ static int sync_thread_backup(void *data)
 				break;
 			}
 
-			ip_vs_process_message(ipvs, tinfo->buf, len);
+			tinfo->msgs++;
+			tinfo->conns += ip_vs_process_message(ipvs, tinfo->buf,
+							      len);
 		}
 	}
 
@@ -1861,6 +1920,7 @@ int start_sync_thread(struct netns_ipvs *ipvs, struct ipvs_sync_daemon_cfg *c,
 	for (id = 0; id < count; id++) {
 		tinfo = &ti[id];
 		tinfo->ipvs = ipvs;
+		spin_lock_init(&tinfo->buff_lock);
 		if (state == IP_VS_STATE_BACKUP) {
 			result = -ENOMEM;
 			tinfo->buf = kmalloc(ipvs->bcfg.sync_maxlen,
@@ -1891,7 +1951,8 @@ int start_sync_thread(struct netns_ipvs *ipvs, struct ipvs_sync_daemon_cfg *c,
 	else
 		ipvs->backup_tinfo = ti;
 	spin_lock_bh(&ipvs->sync_buff_lock);
-	ipvs->sync_state |= state;
+	/* ip_vs_sync_conn() needs master_tinfo once it sees the state */
+	smp_store_release(&ipvs->sync_state, ipvs->sync_state | state);
 	spin_unlock_bh(&ipvs->sync_buff_lock);
 
 	mutex_unlock(&ipvs->sync_mutex);
@@ -1957,9 +2018,11 @@ int stop_sync_thread(struct netns_ipvs *ipvs, int state)
 		ti = ipvs->master_tinfo;
 
 		/*
-		 * The lock synchronizes with sb_queue_tail(), so that we don't
-		 * add sync buffers to the queue, when we are already in
-		 * progress of stopping the master sync daemon.
+		 * sb_queue_tail() checks the state under sync_lock, so once
+		 * it is cleared no more sync buffers are added to the queues.
+		 * Buffers are filled under the per-thread buff_lock by
+		 * ip_vs_sync_conn() callers that read the state under RCU,
+		 * synchronize_rcu() below waits for those to finish.
 		 */
 
 		spin_lock_bh(&ipvs->sync_buff_lock);
@@ -1967,6 +2030,8 @@ int stop_sync_thread(struct netns_ipvs *ipvs, int state)
 		ipvs->sync_state &= ~IP_VS_STATE_MASTER;
 		spin_unlock(&ipvs->sync_lock);
 		spin_unlock_bh(&ipvs->sync_buff_lock);
+		/* Wait for ip_vs_sync_conn() callers that saw the old state */
+		synchronize_rcu();
 
 		retc = 0;
 		for (id = ipvs->threads_mask; id >= 0; id--) {
@@ -2026,6 +2091,88 @@ int stop_sync_thread(struct netns_ipvs *ipvs, int state)
 	return retc;
 }
 
+/*
+ *      Full-table sync: ip_vs_conn_sync_all() walks the connection table
+ *      and feeds every connection of the netns to the master threads,
+ *      e.g. after a new backup joined.
+ */
+int ip_vs_sync_conn_bulk(struct netns_ipvs *ipvs, struct ip_vs_conn *cp)
+{
+	if (cp->flags & IP_VS_CONN_F_ONE_PACKET)
+		return 0;
+	return __ip_vs_sync_conn(ipvs, cp) == -ESRCH ? -ESRCH : 0;
+}
+
+/* Pace the full-table sync, sleep while a master queue is half full */
+int ip_vs_sync_bulk_wait(struct netns_ipvs *ipvs)
+{
+	unsigned long qlen = sysctl_sync_qlen_max(ipvs) / 2;
+	bool full;
+	int id;
+
+	for (;;) {
+		full = false;
+		rcu_read_lock();
+		if (!(smp_load_acquire(&ipvs->sync_state) & IP_VS_STATE_MASTER)) {
+			rcu_read_unlock();
+			return -ESRCH;
+		}
+		for (id = 0; id <= ipvs->threads_mask; id++) {
+			if (READ_ONCE(ipvs->ms[id].sync_queue_len) >= qlen)
+				full = true;
+		}
+		rcu_read_unlock();
+		if (!full)
+			return 0;
+		if (fatal_signal_pending(current))
+			return -EINTR;
+		schedule_timeout_interruptible(IPVS_SYNC_SEND_DELAY);
+	}
+}
+
+int ip_vs_sync_full_table(struct netns_ipvs *ipvs)
+{
+	/* Version 0 can not carry all connection types */
+	if (!sysctl_sync_ver(ipvs))
+		return -EOPNOTSUPP;
+	if (!(READ_ONCE(ipvs->sync_state) & IP_VS_STATE_MASTER))
+		return -ESRCH;
+	return ip_vs_conn_sync_all(ipvs);
+}
+
+#ifdef CONFIG_PROC_FS
+static int ip_vs_sync_stats_show(struct seq_file *seq, void *v)
+{
+	struct netns_ipvs *ipvs = net_ipvs(seq_file_single_net(seq));
+	struct ip_vs_sync_thread_data *tinfo;
+	int id;
+
+	mutex_lock(&ipvs->sync_mutex);
+	if (ipvs->master_tinfo) {
+		seq_puts(seq, "Master  Queue       Msgs      Conns   Dropped"
+			      "  Lag(ms) MaxLag(ms)\n");
+		for (id = 0; id <= ipvs->threads_mask; id++) {
+			tinfo = &ipvs->master_tinfo[id];
+			seq_printf(seq, "%6d %6d %10lu %10lu %9lu %8u %10u\n",
+				   id, READ_ONCE(ipvs->ms[id].sync_queue_len),
+				   tinfo->msgs, tinfo->conns, tinfo->dropped,
+				   READ_ONCE(tinfo->lag),
+				   READ_ONCE(tinfo->max_lag));
+		}
+	}
+	if (ipvs->backup_tinfo) {
+		seq_puts(seq, "Backup        Msgs      Conns\n");
+		for (id = 0; id <= ipvs->threads_mask; id++) {
+			tinfo = &ipvs->backup_tinfo[id];
+			seq_printf(seq, "%6d %10lu %10lu\n",
+				   id, tinfo->msgs, tinfo->conns);
+		}
+	}
+	mutex_unlock(&ipvs->sync_mutex);
+	return 0;
+}
+#endif
+
 /*
  * Initialize data struct for each netns
  */
@@ -2034,6 +2181,11 @@ int __net_init ip_vs_sync_net_init(struct netns_ipvs *ipvs)
 	__mutex_init(&ipvs->sync_mutex, "ipvs->sync_mutex", &__ipvs_sync_key);
 	spin_lock_init(&ipvs->sync_lock);
 	spin_lock_init(&ipvs->sync_buff_lock);
+#ifdef CONFIG_PROC_FS
+	if (!proc_create_net_single("ip_vs_sync_stats", 0, ipvs->net->proc_net,
+				    ip_vs_sync_stats_show, NULL))
+		return -ENOMEM;
+#endif
 	return 0;
 }
 
@@ -2048,4 +2200,6 @@ void ip_vs_sync_net_cleanup(struct netns_ipvs *ipvs)
 	retc = stop_sync_thread(ipvs, IP_VS_STATE_BACKUP);
 	if (retc && retc != -ESRCH)
 		pr_err("Failed to stop Backup Daemon\n");
+
+	remove_proc_entry("ip_vs_sync_stats", ipvs->net->proc_net);
 }
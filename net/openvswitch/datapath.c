@@ -131,6 +131,7 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *,
 				  uint32_t cutlen);
 
 static void ovs_dp_masks_rebalance(struct work_struct *work);
+static void upcall_batch_purge(struct datapath *dp);
 
 /* Must be called with rcu_read_lock or ovs_mutex. */
 const char *ovs_dp_name(const struct datapath *dp)
@@ -161,6 +162,8 @@ static void destroy_dp_rcu(struct rcu_head *rcu)
 {
 	struct datapath *dp = container_of(rcu, struct datapath, rcu);
 
+	/* No upcall can be queued for dp after the grace period. */
+	upcall_batch_purge(dp);
 	ovs_flow_tbl_destroy(&dp->table);
 	free_percpu(dp->stats_percpu);
 	kfree(dp->ports);
@@ -376,7 +379,11 @@ static size_t upcall_msg_size(const struct dp_upcall_info *upcall_info,
 
 static void pad_packet(struct datapath *dp, struct sk_buff *skb)
 {
-	if (!(dp->user_features & OVS_DP_F_UNALIGNED)) {
+	/* Batched messages are packed back to back, so they are always
+	 * padded for the next one to start aligned.
+	 */
+	if (!(dp->user_features & OVS_DP_F_UNALIGNED) ||
+	    (dp->user_features & OVS_DP_F_UPCALL_BATCH)) {
 		size_t plen = NLA_ALIGN(skb->len) - skb->len;
 
 		if (plen > 0)
@@ -384,74 +391,28 @@ static void pad_packet(struct datapath *dp, struct sk_buff *skb)
 	}
 }
 
-static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
-				  const struct sw_flow_key *key,
-				  const struct dp_upcall_info *upcall_info,
-				  uint32_t cutlen)
+/* Appends one upcall message for 'skb' to 'user_skb'. */
+static int upcall_msg_fill(struct datapath *dp, struct sk_buff *user_skb,
+			   struct sk_buff *skb,
+			   const struct sw_flow_key *key,
+			   const struct dp_upcall_info *upcall_info,
+			   uint32_t cutlen, int dp_ifindex, unsigned int hlen)
 {
+	unsigned int start = user_skb->len;
 	struct ovs_header *upcall;
-	struct sk_buff *nskb = NULL;
-	struct sk_buff *user_skb = NULL; /* to be queued to userspace */
 	struct nlattr *nla;
-	size_t len;
-	unsigned int hlen;
-	int err, dp_ifindex;
+	int err;
 	u64 hash;
 
-	dp_ifindex = get_dpifindex(dp);
-	if (!dp_ifindex)
-		return -ENODEV;
-
-	if (skb_vlan_tag_present(skb)) {
-		nskb = skb_clone(skb, GFP_ATOMIC);
-		if (!nskb)
-			return -ENOMEM;
-
-		nskb = __vlan_hwaccel_push_inside(nskb);
-		if (!nskb)
-			return -ENOMEM;
-
-		skb = nskb;
-	}
-
-	if (nla_attr_size(skb->len) > USHRT_MAX) {
-		err = -EFBIG;
-		goto out;
-	}
-
-	/* Complete checksum if needed */
-	if (skb->ip_summed == CHECKSUM_PARTIAL &&
-	    (err = skb_csum_hwoffload_help(skb, 0)))
-		goto out;
-
-	/* Older versions of OVS user space enforce alignment of the last
-	 * Netlink attribute to NLA_ALIGNTO which would require extensive
-	 * padding logic. Only perform zerocopy if padding is not required.
-	 */
-	if (dp->user_features & OVS_DP_F_UNALIGNED)
-		hlen = skb_zerocopy_headlen(skb);
-	else
-		hlen = skb->len;
-
-	len = upcall_msg_size(upcall_info, hlen - cutlen,
-			      OVS_CB(skb)->acts_origlen);
-	user_skb = genlmsg_new(len, GFP_ATOMIC);
-	if (!user_skb) {
-		err = -ENOMEM;
-		goto out;
-	}
-
 	upcall = genlmsg_put(user_skb, 0, 0, &dp_packet_genl_family,
 			     0, upcall_info->cmd);
-	if (!upcall) {
-		err = -EINVAL;
-		goto out;
-	}
+	if (!upcall)
+		return -EINVAL;
 	upcall->dp_ifindex = dp_ifindex;
 
 	err = ovs_nla_put_key(key, key, OVS_PACKET_ATTR_KEY, false, user_skb);
 	if (err)
-		goto out;
+		return err;
 
 	if (upcall_info->userdata)
 		__nla_put(user_skb, OVS_PACKET_ATTR_USERDATA,
@@ -461,24 +422,20 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
 	if (upcall_info->egress_tun_info) {
 		nla = nla_nest_start_noflag(user_skb,
 					    OVS_PACKET_ATTR_EGRESS_TUN_KEY);
-		if (!nla) {
-			err = -EMSGSIZE;
-			goto out;
-		}
+		if (!nla)
+			return -EMSGSIZE;
 		err = ovs_nla_put_tunnel_info(user_skb,
 					      upcall_info->egress_tun_info);
 		if (err)
-			goto out;
+			return err;
 
 		nla_nest_end(user_skb, nla);
 	}
 
 	if (upcall_info->actions_len) {
 		nla = nla_nest_start_noflag(user_skb, OVS_PACKET_ATTR_ACTIONS);
-		if (!nla) {
-			err = -EMSGSIZE;
-			goto out;
-		}
+		if (!nla)
+			return -EMSGSIZE;
 		err = ovs_nla_put_actions(upcall_info->actions,
 					  upcall_info->actions_len,
 					  user_skb);
@@ -490,17 +447,13 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
 
 	/* Add OVS_PACKET_ATTR_MRU */
 	if (upcall_info->mru &&
-	    nla_put_u16(user_skb, OVS_PACKET_ATTR_MRU, upcall_info->mru)) {
-		err = -ENOBUFS;
-		goto out;
-	}
+	    nla_put_u16(user_skb, OVS_PACKET_ATTR_MRU, upcall_info->mru))
+		return -ENOBUFS;
 
 	/* Add OVS_PACKET_ATTR_LEN when packet is truncated */
 	if (cutlen > 0 &&
-	    nla_put_u32(user_skb, OVS_PACKET_ATTR_LEN, skb->len)) {
-		err = -ENOBUFS;
-		goto out;
-	}
+	    nla_put_u32(user_skb, OVS_PACKET_ATTR_LEN, skb->len))
+		return -ENOBUFS;
 
 	/* Add OVS_PACKET_ATTR_HASH */
 	hash = skb_get_hash_raw(skb);
@@ -510,27 +463,262 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
 	if (skb->l4_hash)
 		hash |= OVS_PACKET_HASH_L4_BIT;
 
-	if (nla_put(user_skb, OVS_PACKET_ATTR_HASH, sizeof (u64), &hash)) {
-		err = -ENOBUFS;
-		goto out;
-	}
+	if (nla_put(user_skb, OVS_PACKET_ATTR_HASH, sizeof (u64), &hash))
+		return -ENOBUFS;
 
 	/* Only reserve room for attribute header, packet data is added
 	 * in skb_zerocopy() */
-	if (!(nla = nla_reserve(user_skb, OVS_PACKET_ATTR_PACKET, 0))) {
-		err = -ENOBUFS;
-		goto out;
-	}
+	if (!(nla = nla_reserve(user_skb, OVS_PACKET_ATTR_PACKET, 0)))
+		return -ENOBUFS;
 	nla->nla_len = nla_attr_size(skb->len - cutlen);
 
 	err = skb_zerocopy(user_skb, skb, skb->len - cutlen, hlen);
 	if (err)
-		goto out;
+		return err;
 
 	/* Pad OVS_PACKET_ATTR_PACKET if linear copy was performed */
 	pad_packet(dp, user_skb);
 
-	((struct nlmsghdr *) user_skb->data)->nlmsg_len = user_skb->len;
+	((struct nlmsghdr *)(user_skb->data + start))->nlmsg_len =
+		user_skb->len - start;
+
+	return 0;
+}
+
+/* Upcall batching.
+ *
+ * With OVS_DP_F_UPCALL_BATCH, upcalls are not unicast one by one but
+ * appended to a per-CPU datagram.  The datagram is sent when it is full,
+ * when an upcall for another datapath or Netlink PID comes in, or from a
+ * tasklet, which runs once the current NET_RX softirq round, i.e. the
+ * NAPI polls it made, is over.  A burst of misses then costs userspace
+ * one wakeup and one recvmsg() per handler rather than one per packet.
+ */
+#define UPCALL_BATCH_MAX	64
+#define UPCALL_BATCH_BYTES	(32 * 1024)
+
+struct upcall_batch {
+	spinlock_t lock;
+	struct sk_buff *skb;		/* Messages so far, or NULL. */
+	struct datapath *dp;
+	u32 portid;
+	unsigned int count;
+	struct tasklet_struct tasklet;
+};
+
+static DEFINE_PER_CPU(struct upcall_batch, upcall_batches);
+
+/* Called with b->lock held. */
+static void upcall_batch_flush(struct upcall_batch *b)
+{
+	struct dp_stats_percpu *stats;
+	int err;
+
+	if (!b->skb)
+		return;
+
+	err = genlmsg_unicast(ovs_dp_get_net(b->dp), b->skb, b->portid);
+
+	stats = this_cpu_ptr(b->dp->stats_percpu);
+	u64_stats_update_begin(&stats->syncp);
+	if (err) {
+		stats->n_lost += b->count;
+	} else {
+		stats->n_upcall_batches++;
+		stats->n_upcall_batched += b->count;
+	}
+	u64_stats_update_end(&stats->syncp);
+
+	b->skb = NULL;
+	b->dp = NULL;
+	b->count = 0;
+}
+
+static void upcall_batch_tasklet(struct tasklet_struct *t)
+{
+	struct upcall_batch *b = from_tasklet(b, t, tasklet);
+
+	spin_lock(&b->lock);
+	upcall_batch_flush(b);
+	spin_unlock(&b->lock);
+}
+
+static int upcall_batch_add(struct datapath *dp, struct sk_buff *skb,
+			    const struct sw_flow_key *key,
+			    const struct dp_upcall_info *upcall_info,
+			    uint32_t cutlen, int dp_ifindex,
+			    unsigned int hlen, size_t len)
+{
+	struct upcall_batch *b;
+	unsigned int start;
+	int err;
+
+	local_bh_disable();
+	b = this_cpu_ptr(&upcall_batches);
+	spin_lock(&b->lock);
+
+	if (b->skb && (b->dp != dp || b->portid != upcall_info->portid ||
+		       skb_tailroom(b->skb) < len))
+		upcall_batch_flush(b);
+
+	if (!b->skb) {
+		b->skb = genlmsg_new(max_t(size_t, len, UPCALL_BATCH_BYTES),
+				     GFP_ATOMIC);
+		if (!b->skb) {
+			err = -ENOMEM;
+			goto out;
+		}
+		b->dp = dp;
+		b->portid = upcall_info->portid;
+		tasklet_schedule(&b->tasklet);
+	}
+
+	start = b->skb->len;
+	err = upcall_msg_fill(dp, b->skb, skb, key, upcall_info, cutlen,
+			      dp_ifindex, hlen);
+	if (err) {
+		skb_trim(b->skb, start);
+		if (!b->count) {
+			kfree_skb(b->skb);
+			b->skb = NULL;
+			b->dp = NULL;
+		}
+		goto out;
+	}
+
+	if (++b->count >= UPCALL_BATCH_MAX)
+		upcall_batch_flush(b);
+out:
+	spin_unlock(&b->lock);
+	local_bh_enable();
+	return err;
+}
+
+/* Drops the upcalls still batched for 'dp', which is going away. */
+static void upcall_batch_purge(struct datapath *dp)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct upcall_batch *b = per_cpu_ptr(&upcall_batches, cpu);
+
+		spin_lock_bh(&b->lock);
+		if (b->dp == dp) {
+			kfree_skb(b->skb);
+			b->skb = NULL;
+			b->dp = NULL;
+			b->count = 0;
+		}
+		spin_unlock_bh(&b->lock);
+	}
+}
+
+static unsigned int upcall_batch_pending(const struct datapath *dp)
+{
+	unsigned int pending = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct upcall_batch *b = per_cpu_ptr(&upcall_batches, cpu);
+
+		spin_lock_bh(&b->lock);
+		if (b->dp == dp)
+			pending += b->count;
+		spin_unlock_bh(&b->lock);
+	}
+
+	return pending;
+}
+
+static void upcall_batch_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct upcall_batch *b = per_cpu_ptr(&upcall_batches, cpu);
+
+		spin_lock_init(&b->lock);
+		tasklet_setup(&b->tasklet, upcall_batch_tasklet);
+	}
+}
+
+static void upcall_batch_exit(void)
+{
+	int cpu;
+
+	/* All datapaths, and so all batches, are gone by now. */
+	for_each_possible_cpu(cpu)
+		tasklet_kill(&per_cpu_ptr(&upcall_batches, cpu)->tasklet);
+}
+
+static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
+				  const struct sw_flow_key *key,
+				  const struct dp_upcall_info *upcall_info,
+				  uint32_t cutlen)
+{
+	struct sk_buff *nskb = NULL;
+	struct sk_buff *user_skb = NULL; /* to be queued to userspace */
+	size_t len;
+	unsigned int hlen;
+	int err, dp_ifindex;
+
+	dp_ifindex = get_dpifindex(dp);
+	if (!dp_ifindex)
+		return -ENODEV;
+
+	if (skb_vlan_tag_present(skb)) {
+		nskb = skb_clone(skb, GFP_ATOMIC);
+		if (!nskb)
+			return -ENOMEM;
+
+		nskb = __vlan_hwaccel_push_inside(nskb);
+		if (!nskb)
+			return -ENOMEM;
+
+		skb = nskb;
+	}
+
+	if (nla_attr_size(skb->len) > USHRT_MAX) {
+		err = -EFBIG;
+		goto out;
+	}
+
+	/* Complete checksum if needed */
+	if (skb->ip_summed == CHECKSUM_PARTIAL &&
+	    (err = skb_csum_hwoffload_help(skb, 0)))
+		goto out;
+
+	/* Older versions of OVS user space enforce alignment of the last
+	 * Netlink attribute to NLA_ALIGNTO which would require extensive
+	 * padding logic. Only perform zerocopy if padding is not required.
+	 * Batched messages are always padded, so they are copied too.
+	 */
+	if ((dp->user_features & OVS_DP_F_UNALIGNED) &&
+	    !(dp->user_features & OVS_DP_F_UPCALL_BATCH))
+		hlen = skb_zerocopy_headlen(skb);
+	else
+		hlen = skb->len;
+
+	len = upcall_msg_size(upcall_info, hlen - cutlen,
+			      OVS_CB(skb)->acts_origlen);
+
+	if (dp->user_features & OVS_DP_F_UPCALL_BATCH) {
+		err = upcall_batch_add(dp, skb, key, upcall_info, cutlen,
+				       dp_ifindex, hlen,
+				       nlmsg_total_size(genlmsg_total_size(len)));
+		goto out;
+	}
+
+	user_skb = genlmsg_new(len, GFP_ATOMIC);
+	if (!user_skb) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	err = upcall_msg_fill(dp, user_skb, skb, key, upcall_info, cutlen,
+			      dp_ifindex, hlen);
+	if (err)
+		goto out;
 
 	err = genlmsg_unicast(ovs_dp_get_net(dp), user_skb, upcall_info->portid);
 	user_skb = NULL;
@@ -705,6 +893,33 @@ static void get_dp_stats(const struct datapath *dp, struct ovs_dp_stats *stats,
 	}
 }
 
+static void get_dp_upcall_stats(const struct datapath *dp,
+				struct ovs_dp_upcall_stats *stats)
+{
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+
+	for_each_possible_cpu(i) {
+		const struct dp_stats_percpu *percpu_stats;
+		u64 n_batches, n_batched;
+		unsigned int start;
+
+		percpu_stats = per_cpu_ptr(dp->stats_percpu, i);
+
+		do {
+			start = u64_stats_fetch_begin_irq(&percpu_stats->syncp);
+			n_batches = percpu_stats->n_upcall_batches;
+			n_batched = percpu_stats->n_upcall_batched;
+		} while (u64_stats_fetch_retry_irq(&percpu_stats->syncp, start));
+
+		stats->n_batches += n_batches;
+		stats->n_batched += n_batched;
+	}
+
+	stats->n_pending = upcall_batch_pending(dp);
+}
+
 static bool should_fill_key(const struct sw_flow_id *sfid, uint32_t ufid_flags)
 {
 	return ovs_identifier_is_ufid(sfid) &&
@@ -1501,6 +1716,8 @@ static size_t ovs_dp_cmd_msg_size(void)
 	msgsize += nla_total_size_64bit(sizeof(struct ovs_dp_megaflow_stats));
 	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_USER_FEATURES */
 	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_MASKS_CACHE_SIZE */
+	msgsize += nla_total_size_64bit(sizeof(u64) * OVS_DP_MAX_MASKS_STATS);
+	msgsize += nla_total_size_64bit(sizeof(struct ovs_dp_upcall_stats));
 
 	return msgsize;
 }
@@ -1512,7 +1729,9 @@ static int ovs_dp_cmd_fill_info(struct datapath *dp, struct sk_buff *skb,
 	struct ovs_header *ovs_header;
 	struct ovs_dp_stats dp_stats;
 	struct ovs_dp_megaflow_stats dp_megaflow_stats;
-	int err;
+	struct ovs_dp_upcall_stats dp_upcall_stats;
+	struct nlattr *nla;
+	int err, n_masks;
 
 	ovs_header = genlmsg_put(skb, portid, seq, &dp_datapath_genl_family,
 				 flags, cmd);
@@ -1542,6 +1761,19 @@ static int ovs_dp_cmd_fill_info(struct datapath *dp, struct sk_buff *skb,
 			ovs_flow_tbl_masks_cache_size(&dp->table)))
 		goto nla_put_failure;
 
+	n_masks = min(dp_megaflow_stats.n_masks, (u32)OVS_DP_MAX_MASKS_STATS);
+	nla = nla_reserve_64bit(skb, OVS_DP_ATTR_MASKS_STATS,
+				sizeof(u64) * n_masks, OVS_DP_ATTR_PAD);
+	if (!nla)
+		goto nla_put_failure;
+	ovs_flow_tbl_masks_stats(&dp->table, nla_data(nla), n_masks);
+
+	get_dp_upcall_stats(dp, &dp_upcall_stats);
+	if (nla_put_64bit(skb, OVS_DP_ATTR_UPCALL_STATS,
+			  sizeof(struct ovs_dp_upcall_stats),
+			  &dp_upcall_stats, OVS_DP_ATTR_PAD))
+		goto nla_put_failure;
+
 	genlmsg_end(skb, ovs_header);
 	return 0;
 
@@ -1599,7 +1831,8 @@ static int ovs_dp_change(struct datapath *dp, struct nlattr *a[])
 
 		if (user_features & ~(OVS_DP_F_VPORT_PIDS |
 				      OVS_DP_F_UNALIGNED |
-				      OVS_DP_F_TC_RECIRC_SHARING))
+				      OVS_DP_F_TC_RECIRC_SHARING |
+				      OVS_DP_F_UPCALL_BATCH))
 			return -EOPNOTSUPP;
 
 #if !IS_ENABLED(CONFIG_NET_TC_SKB_EXT)
@@ -1915,7 +2148,7 @@ static const struct nla_policy datapath_policy[OVS_DP_ATTR_MAX + 1] = {
 	[OVS_DP_ATTR_UPCALL_PID] = { .type = NLA_U32 },
 	[OVS_DP_ATTR_USER_FEATURES] = { .type = NLA_U32 },
 	[OVS_DP_ATTR_MASKS_CACHE_SIZE] =  NLA_POLICY_RANGE(NLA_U32, 0,
-		PCPU_MIN_UNIT_SIZE / sizeof(struct mask_cache_entry)),
+		MC_MAX_HASH_ENTRIES),
 };
 
 static const struct genl_small_ops dp_datapath_genl_ops[] = {
@@ -2567,6 +2800,8 @@ static int __init dp_init(void)
 
 	pr_info("Open vSwitch switching datapath\n");
 
+	upcall_batch_init();
+
 	err = action_fifos_init();
 	if (err)
 		goto error;
@@ -2626,6 +2861,7 @@ static void dp_cleanup(void)
 	unregister_netdevice_notifier(&ovs_dp_device_notifier);
 	unregister_pernet_device(&ovs_net_ops);
 	rcu_barrier();
+	upcall_batch_exit();
 	ovs_vport_exit();
 	ovs_flow_exit();
 	ovs_internal_dev_rtnl_link_unregister();
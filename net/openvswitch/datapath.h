@@ -40,6 +40,9 @@
  *   up per packet.
  * @n_cache_hit: The number of received packets that had their mask found using
  * the mask cache.
+ * @n_upcall_batches: Number of batched upcall datagrams sent to userspace.
+ * @n_upcall_batched: Number of upcalls sent in those datagrams.  Batched
+ * upcalls that could not be delivered are counted in @n_lost.
  */
 struct dp_stats_percpu {
 	u64 n_hit;
@@ -47,6 +50,8 @@ struct dp_stats_percpu {
 	u64 n_lost;
 	u64 n_mask_hit;
 	u64 n_cache_hit;
+	u64 n_upcall_batches;
+	u64 n_upcall_batched;
 	struct u64_stats_sync syncp;
 };
 
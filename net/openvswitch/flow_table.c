@@ -214,6 +214,29 @@ static void tbl_mask_array_reset_counters(struct mask_array *ma)
 	}
 }
 
+/* Returns the hits of mask 'index' since its counters were last reset. */
+static u64 tbl_mask_array_hits(const struct mask_array *ma, int index)
+{
+	u64 hits = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct mask_array_stats *stats;
+		unsigned int start;
+		u64 counter;
+
+		stats = per_cpu_ptr(ma->masks_usage_stats, cpu);
+		do {
+			start = u64_stats_fetch_begin_irq(&stats->syncp);
+			counter = stats->usage_cntrs[index];
+		} while (u64_stats_fetch_retry_irq(&stats->syncp, start));
+
+		hits += counter;
+	}
+
+	return hits - ma->masks_usage_zero_cntr[index];
+}
+
 static struct mask_array *tbl_mask_array_alloc(int size)
 {
 	struct mask_array *new;
@@ -347,7 +370,13 @@ static void flow_mask_remove(struct flow_table *tbl, struct sw_flow_mask *mask)
 
 static void __mask_cache_destroy(struct mask_cache *mc)
 {
-	free_percpu(mc->mask_cache);
+	int cpu;
+
+	if (mc->mask_cache) {
+		for_each_possible_cpu(cpu)
+			kvfree(*per_cpu_ptr(mc->mask_cache, cpu));
+		free_percpu(mc->mask_cache);
+	}
 	kfree(mc);
 }
 
@@ -360,14 +389,14 @@ static void mask_cache_rcu_cb(struct rcu_head *rcu)
 
 static struct mask_cache *tbl_mask_cache_alloc(u32 size)
 {
-	struct mask_cache_entry __percpu *cache = NULL;
+	struct mask_cache_entry *entries;
 	struct mask_cache *new;
+	int cpu;
 
 	/* Only allow size to be 0, or a power of 2, and does not exceed
-	 * percpu allocation size.
+	 * MC_MAX_HASH_ENTRIES.
 	 */
-	if ((!is_power_of_2(size) && size != 0) ||
-	    (size * sizeof(struct mask_cache_entry)) > PCPU_MIN_UNIT_SIZE)
+	if ((!is_power_of_2(size) && size != 0) || size > MC_MAX_HASH_ENTRIES)
 		return NULL;
 
 	new = kzalloc(sizeof(*new), GFP_KERNEL);
@@ -375,17 +404,28 @@ static struct mask_cache *tbl_mask_cache_alloc(u32 size)
 		return NULL;
 
 	new->cache_size = size;
-	if (new->cache_size > 0) {
-		cache = __alloc_percpu(array_size(sizeof(struct mask_cache_entry),
-						  new->cache_size),
-				       __alignof__(struct mask_cache_entry));
-		if (!cache) {
-			kfree(new);
+	if (new->cache_size == 0)
+		return new;
+
+	/* The entries do not come from the percpu allocator, so the cache
+	 * is not limited to PCPU_MIN_UNIT_SIZE.
+	 */
+	new->mask_cache = alloc_percpu(struct mask_cache_entry *);
+	if (!new->mask_cache) {
+		kfree(new);
+		return NULL;
+	}
+
+	for_each_possible_cpu(cpu) {
+		entries = kvzalloc_node(array_size(sizeof(*entries), size),
+					GFP_KERNEL, cpu_to_node(cpu));
+		if (!entries) {
+			__mask_cache_destroy(new);
 			return NULL;
 		}
+		*per_cpu_ptr(new->mask_cache, cpu) = entries;
 	}
 
-	new->mask_cache = cache;
 	return new;
 }
 int ovs_flow_tbl_masks_cache_resize(struct flow_table *table, u32 size)
@@ -396,8 +436,7 @@ int ovs_flow_tbl_masks_cache_resize(struct flow_table *table, u32 size)
 	if (size == mc->cache_size)
 		return 0;
 
-	if ((!is_power_of_2(size) && size != 0) ||
-	    (size * sizeof(struct mask_cache_entry)) > PCPU_MIN_UNIT_SIZE)
+	if ((!is_power_of_2(size) && size != 0) || size > MC_MAX_HASH_ENTRIES)
 		return -EINVAL;
 
 	new = tbl_mask_cache_alloc(size);
@@ -775,12 +814,49 @@ static struct sw_flow *flow_lookup(struct flow_table *tbl,
 	return NULL;
 }
 
+/* Finds the mask cache entry of 'skb_hash'.  Returns true if it is
+ * cached, otherwise '*cep' is set to the entry to replace.
+ */
+static bool mask_cache_find(struct mask_cache *mc, u32 skb_hash,
+			    struct mask_cache_entry **cep)
+{
+	struct mask_cache_entry *entries, *ce = NULL;
+	u32 hash = skb_hash;
+	int seg;
+
+	entries = *this_cpu_ptr(mc->mask_cache);
+
+	for (seg = 0; seg < MC_HASH_SEGS; seg++) {
+		int index = hash & (mc->cache_size - 1);
+		struct mask_cache_entry *e;
+
+		e = &entries[index];
+		if (e->skb_hash == skb_hash) {
+			*cep = e;
+			return true;
+		}
+
+		if (!ce || e->skb_hash < ce->skb_hash)
+			ce = e;  /* A better replacement cache candidate. */
+
+		hash >>= MC_HASH_SHIFT;
+	}
+
+	*cep = ce;
+	return false;
+}
+
 /*
  * mask_cache maps flow to probable mask. This cache is not tightly
  * coupled cache, It means updates to  mask list can result in inconsistent
  * cache entry in mask cache.
  * This is per cpu cache and is divided in MC_HASH_SEGS segments.
  * In case of a hash collision the entry is hashed in next segment.
+ *
+ * Packets are looked up one at a time: the netdev rx_handler hands each
+ * skb to ovs_dp_process_packet() on its own, so there is no burst to
+ * walk the masks for at once. Repeat lookups within a burst hit the
+ * mask cache instead.
  * */
 struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 					  const struct sw_flow_key *key,
@@ -791,10 +867,8 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	struct mask_cache *mc = rcu_dereference(tbl->mask_cache);
 	struct mask_array *ma = rcu_dereference(tbl->mask_array);
 	struct table_instance *ti = rcu_dereference(tbl->ti);
-	struct mask_cache_entry *entries, *ce;
+	struct mask_cache_entry *ce;
 	struct sw_flow *flow;
-	u32 hash;
-	int seg;
 
 	*n_mask_hit = 0;
 	*n_cache_hit = 0;
@@ -812,28 +886,13 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	if (key->recirc_id)
 		skb_hash = jhash_1word(skb_hash, key->recirc_id);
 
-	ce = NULL;
-	hash = skb_hash;
-	entries = this_cpu_ptr(mc->mask_cache);
-
 	/* Find the cache entry 'ce' to operate on. */
-	for (seg = 0; seg < MC_HASH_SEGS; seg++) {
-		int index = hash & (mc->cache_size - 1);
-		struct mask_cache_entry *e;
-
-		e = &entries[index];
-		if (e->skb_hash == skb_hash) {
-			flow = flow_lookup(tbl, ti, ma, key, n_mask_hit,
-					   n_cache_hit, &e->mask_index);
-			if (!flow)
-				e->skb_hash = 0;
-			return flow;
-		}
-
-		if (!ce || e->skb_hash < ce->skb_hash)
-			ce = e;  /* A better replacement cache candidate. */
-
-		hash >>= MC_HASH_SHIFT;
+	if (mask_cache_find(mc, skb_hash, &ce)) {
+		flow = flow_lookup(tbl, ti, ma, key, n_mask_hit, n_cache_hit,
+				   &ce->mask_index);
+		if (!flow)
+			ce->skb_hash = 0;
+		return flow;
 	}
 
 	/* Cache miss, do full lookup. */
@@ -941,6 +1000,28 @@ int ovs_flow_tbl_num_masks(const struct flow_table *table)
 	return READ_ONCE(ma->count);
 }
 
+/* Fills 'hits' with the hits of up to 'max' masks, in lookup order, since
+ * the last rebalance.  Entries past the last mask are zeroed.  Returns the
+ * number of masks filled in.
+ */
+int ovs_flow_tbl_masks_stats(const struct flow_table *table, u64 *hits,
+			     int max)
+{
+	struct mask_array *ma = rcu_dereference_ovsl(table->mask_array);
+	int i;
+
+	for (i = 0; i < ma->max && i < max; i++) {
+		if (!rcu_dereference_ovsl(ma->masks[i]))
+			break;
+		hits[i] = tbl_mask_array_hits(ma, i);
+	}
+
+	if (i < max)
+		memset(hits + i, 0, (max - i) * sizeof(*hits));
+
+	return i;
+}
+
 u32 ovs_flow_tbl_masks_cache_size(const struct flow_table *table)
 {
 	struct mask_cache *mc = rcu_dereference_ovsl(table->mask_cache);
@@ -1120,32 +1201,13 @@ void ovs_flow_masks_rebalance(struct flow_table *table)
 
 	for (i = 0; i < ma->max; i++) {
 		struct sw_flow_mask *mask;
-		int cpu;
 
 		mask = rcu_dereference_ovsl(ma->masks[i]);
 		if (unlikely(!mask))
 			break;
 
 		masks_and_count[i].index = i;
-		masks_and_count[i].counter = 0;
-
-		for_each_possible_cpu(cpu) {
-			struct mask_array_stats *stats;
-			unsigned int start;
-			u64 counter;
-
-			stats = per_cpu_ptr(ma->masks_usage_stats, cpu);
-			do {
-				start = u64_stats_fetch_begin_irq(&stats->syncp);
-				counter = stats->usage_cntrs[i];
-			} while (u64_stats_fetch_retry_irq(&stats->syncp,
-							   start));
-
-			masks_and_count[i].counter += counter;
-		}
-
-		/* Subtract the zero count value. */
-		masks_and_count[i].counter -= ma->masks_usage_zero_cntr[i];
+		masks_and_count[i].counter = tbl_mask_array_hits(ma, i);
 
 		/* Rather than calling tbl_mask_array_reset_counters()
 		 * below when no change is needed, do it inline here.
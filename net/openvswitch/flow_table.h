@@ -27,10 +27,14 @@ struct mask_cache_entry {
 	u32 mask_index;
 };
 
+/* Largest mask cache, in entries per CPU. */
+#define MC_MAX_HASH_ENTRIES	(1 << 16)
+
 struct mask_cache {
 	struct rcu_head rcu;
 	u32 cache_size;  /* Must be ^2 value. */
-	struct mask_cache_entry __percpu *mask_cache;
+	/* Per CPU, node local array of 'cache_size' entries. */
+	struct mask_cache_entry * __percpu *mask_cache;
 };
 
 struct mask_count {
@@ -88,6 +92,8 @@ void ovs_flow_tbl_remove(struct flow_table *table, struct sw_flow *flow);
 int  ovs_flow_tbl_num_masks(const struct flow_table *table);
 u32  ovs_flow_tbl_masks_cache_size(const struct flow_table *table);
 int  ovs_flow_tbl_masks_cache_resize(struct flow_table *table, u32 size);
+int  ovs_flow_tbl_masks_stats(const struct flow_table *table, u64 *hits,
+			      int max);
 struct sw_flow *ovs_flow_tbl_dump_next(struct table_instance *table,
 				       u32 *bucket, u32 *idx);
 struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *,
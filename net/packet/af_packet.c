@@ -595,6 +595,7 @@ static void init_prb_bdqc(struct packet_sock *po,
 		p1->retire_blk_tov = prb_calc_retire_blk_tmo(po,
 						req_u->req3.tp_block_size);
 	p1->tov_in_jiffies = msecs_to_jiffies(p1->retire_blk_tov);
+	p1->wake_batch = 1;
 	p1->blk_sizeof_priv = req_u->req3.tp_sizeof_priv;
 	rwlock_init(&p1->blk_fill_in_prog_lock);
 
@@ -653,6 +654,12 @@ static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 	if (unlikely(pkc->delete_blk_timer))
 		goto out;
 
+	/* Blocks retired in a batch that the link went idle on. */
+	if (pkc->wake_pending) {
+		pkc->wake_pending = 0;
+		po->sk.sk_data_ready(&po->sk);
+	}
+
 	/* We only need to plug the race when the block is partially filled.
 	 * tpacket_rcv:
 	 *		lock(); increment BLOCK_NUM_PKTS; unlock()
@@ -744,6 +751,40 @@ static void prb_flush_block(struct tpacket_kbdq_core *pkc1,
 #endif
 }
 
+/* Decide whether closing a block wakes the reader. With
+ * TP_FT_REQ_BATCH_WAKEUP the wakeup for a block that filled up is held
+ * back until wake_batch of them are pending, the next block is still
+ * owned by user space, or the retire timer fires. The batch doubles
+ * after every wakeup for full blocks, up to a quarter of the ring, and
+ * goes back to one as soon as a block is retired by the timer.
+ */
+#define PRB_MAX_WAKE_BATCH	256
+
+static bool prb_wake_now(struct tpacket_kbdq_core *pkc, unsigned int stat)
+{
+	struct tpacket_block_desc *next;
+
+	if (!(pkc->feature_req_word & TP_FT_REQ_BATCH_WAKEUP))
+		return true;
+
+	if (stat & TP_STATUS_BLK_TMO) {
+		pkc->wake_batch = 1;
+		goto wake;
+	}
+
+	next = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
+	if (++pkc->wake_pending < pkc->wake_batch &&
+	    !(BLOCK_STATUS(next) & TP_STATUS_USER))
+		return false;
+
+	if (pkc->wake_batch < min_t(unsigned int, pkc->knum_blocks / 4,
+				    PRB_MAX_WAKE_BATCH))
+		pkc->wake_batch <<= 1;
+wake:
+	pkc->wake_pending = 0;
+	return true;
+}
+
 /*
  * Side effect:
  *
@@ -790,9 +831,15 @@ static void prb_close_block(struct tpacket_kbdq_core *pkc1,
 	/* Flush the block */
 	prb_flush_block(pkc1, pbd1, status);
 
-	sk->sk_data_ready(sk);
+	if (stat & TP_STATUS_BLK_TMO)
+		po->stats.stats3.tp_blk_tmo_cnt++;
+	else
+		po->stats.stats3.tp_blk_full_cnt++;
 
 	pkc1->kactive_blk_num = GET_NEXT_PRB_BLK_NUM(pkc1);
+
+	if (prb_wake_now(pkc1, stat))
+		sk->sk_data_ready(sk);
 }
 
 static void prb_thaw_queue(struct tpacket_kbdq_core *pkc)
@@ -1389,6 +1436,117 @@ static unsigned int fanout_demux_rollover(struct packet_fanout *f,
 	return idx;
 }
 
+/* Where the next packet for po goes: its ring frame or block, or the
+ * number of packets queued to it so far when there is no ring.
+ */
+static u32 fanout_flow_tail(const struct packet_sock *po)
+{
+	if (po->prot_hook.func != tpacket_rcv)
+		return READ_ONCE(po->fanout_stats->queued);
+	if (po->tp_version == TPACKET_V3)
+		return READ_ONCE(po->rx_ring.prb_bdqc.kactive_blk_num);
+	return READ_ONCE(po->rx_ring.head);
+}
+
+/* Whether the reader of po has consumed everything up to tail, as in
+ * RFS. A frame or block is only known to be done once the kernel has
+ * moved past it and user space has handed it back; when it has been
+ * reused since, this errs on the side of keeping the flow where it is.
+ */
+static bool fanout_flow_consumed(const struct packet_sock *po, u32 tail)
+{
+	if (po->prot_hook.func != tpacket_rcv)
+		return (s32)(atomic_read(&po->fanout_stats->read) - tail) > 0;
+	if (po->tp_version == TPACKET_V3) {
+		/* the ring may have been set up again since */
+		if (tail >= READ_ONCE(po->rx_ring.prb_bdqc.knum_blocks) ||
+		    tail == READ_ONCE(po->rx_ring.prb_bdqc.kactive_blk_num))
+			return false;
+		return prb_lookup_block(po, &po->rx_ring, tail,
+					TP_STATUS_KERNEL);
+	}
+	if (tail > READ_ONCE(po->rx_ring.frame_max) ||
+	    tail == READ_ONCE(po->rx_ring.head))
+		return false;
+	return packet_lookup_frame(po, &po->rx_ring, tail, TP_STATUS_KERNEL);
+}
+
+static void fanout_flow_set_tail(struct packet_fanout_flow *flow,
+				 const struct packet_sock *po)
+{
+	u32 tail = fanout_flow_tail(po);
+
+	if (READ_ONCE(flow->tail) != tail)
+		WRITE_ONCE(flow->tail, tail);
+}
+
+/* Keep each flow on the member it was first hashed to, and only move
+ * it when that member is short of room, the flow has been idle for
+ * flow_idle jiffies and the member's reader is past the flow's last
+ * packet. The new member then cannot hand later packets of the flow to
+ * user space before the old one has handed out the earlier ones.
+ */
+static unsigned int fanout_demux_flow(struct packet_fanout *f,
+				      struct sk_buff *skb,
+				      unsigned int num)
+{
+	u32 hash = __skb_get_hash_symmetric(skb);
+	struct packet_fanout_flow *flow;
+	struct packet_sock *po, *po_next;
+	u32 now = jiffies, last, idx, old;
+	unsigned int i, j;
+
+	flow = &f->flows[hash & (PACKET_FANOUT_FLOW_BUCKETS - 1)];
+	idx = READ_ONCE(flow->idx);
+	last = READ_ONCE(flow->last);
+
+	/* Avoid dirtying the cache line if possible */
+	if (last != now)
+		WRITE_ONCE(flow->last, now);
+
+	if (unlikely(idx >= num)) {
+		idx = reciprocal_scale(hash, num);
+		WRITE_ONCE(flow->idx, idx);
+		po = pkt_sk(rcu_dereference(f->arr[idx]));
+		fanout_flow_set_tail(flow, po);
+		return idx;
+	}
+
+	po = pkt_sk(rcu_dereference(f->arr[idx]));
+	if (packet_rcv_has_room(po, skb) == ROOM_NORMAL)
+		goto out;
+
+	if (now - last < READ_ONCE(f->flow_idle) ||
+	    !fanout_flow_consumed(po, READ_ONCE(flow->tail))) {
+		atomic_long_inc(&po->fanout_stats->held);
+		goto out;
+	}
+
+	i = j = reciprocal_scale(hash, num);
+	do {
+		po_next = pkt_sk(rcu_dereference(f->arr[i]));
+		if (i != idx && !READ_ONCE(po_next->pressure) &&
+		    packet_rcv_has_room(po_next, skb) == ROOM_NORMAL) {
+			/* Another cpu may have moved the flow already */
+			old = cmpxchg(&flow->idx, idx, i);
+			if (old != idx)
+				return old < num ? old : idx;
+
+			atomic_long_inc(&po->fanout_stats->flows_out);
+			atomic_long_inc(&po_next->fanout_stats->flows_in);
+			fanout_flow_set_tail(flow, po_next);
+			return i;
+		}
+
+		if (++i == num)
+			i = 0;
+	} while (i != j);
+
+out:
+	fanout_flow_set_tail(flow, po);
+	return idx;
+}
+
 static unsigned int fanout_demux_qm(struct packet_fanout *f,
 				    struct sk_buff *skb,
 				    unsigned int num)
@@ -1460,6 +1618,9 @@ static int packet_rcv_fanout(struct sk_buff *skb, struct net_device *dev,
 	case PACKET_FANOUT_EBPF:
 		idx = fanout_demux_bpf(f, skb, num);
 		break;
+	case PACKET_FANOUT_FLOW:
+		idx = fanout_demux_flow(f, skb, num);
+		break;
 	}
 
 	if (fanout_has_flag(f, PACKET_FANOUT_FLAG_ROLLOVER))
@@ -1526,9 +1687,29 @@ static void fanout_init_data(struct packet_fanout *f)
 	case PACKET_FANOUT_EBPF:
 		RCU_INIT_POINTER(f->bpf_prog, NULL);
 		break;
+	case PACKET_FANOUT_FLOW:
+		f->flow_idle = msecs_to_jiffies(PACKET_FANOUT_FLOW_IDLE_MS);
+		break;
 	}
 }
 
+static struct packet_fanout_flow *fanout_alloc_flows(void)
+{
+	struct packet_fanout_flow *flows;
+	int i;
+
+	flows = kvmalloc_array(PACKET_FANOUT_FLOW_BUCKETS, sizeof(*flows),
+			       GFP_KERNEL);
+	if (!flows)
+		return NULL;
+
+	for (i = 0; i < PACKET_FANOUT_FLOW_BUCKETS; i++) {
+		flows[i].idx = U32_MAX;
+		flows[i].last = 0;
+	}
+	return flows;
+}
+
 static void __fanout_set_data_bpf(struct packet_fanout *f, struct bpf_prog *new)
 {
 	struct bpf_prog *old;
@@ -1587,6 +1768,21 @@ static int fanout_set_data_ebpf(struct packet_sock *po, sockptr_t data,
 	return 0;
 }
 
+/* How long, in msecs, a flow must be idle before it may move */
+static int fanout_set_data_flow(struct packet_sock *po, sockptr_t data,
+				unsigned int len)
+{
+	u32 idle;
+
+	if (len != sizeof(idle))
+		return -EINVAL;
+	if (copy_from_sockptr(&idle, data, len))
+		return -EFAULT;
+
+	WRITE_ONCE(po->fanout->flow_idle, msecs_to_jiffies(idle));
+	return 0;
+}
+
 static int fanout_set_data(struct packet_sock *po, sockptr_t data,
 			   unsigned int len)
 {
@@ -1595,6 +1791,8 @@ static int fanout_set_data(struct packet_sock *po, sockptr_t data,
 		return fanout_set_data_cbpf(po, data, len);
 	case PACKET_FANOUT_EBPF:
 		return fanout_set_data_ebpf(po, data, len);
+	case PACKET_FANOUT_FLOW:
+		return fanout_set_data_flow(po, data, len);
 	default:
 		return -EINVAL;
 	}
@@ -1606,6 +1804,10 @@ static void fanout_release_data(struct packet_fanout *f)
 	case PACKET_FANOUT_CBPF:
 	case PACKET_FANOUT_EBPF:
 		__fanout_set_data_bpf(f, NULL);
+		break;
+	case PACKET_FANOUT_FLOW:
+		kvfree(f->flows);
+		break;
 	}
 }
 
@@ -1641,6 +1843,7 @@ static bool fanout_find_new_id(struct sock *sk, u16 *new_id)
 
 static int fanout_add(struct sock *sk, struct fanout_args *args)
 {
+	struct packet_fanout_stats *fanout_stats = NULL;
 	struct packet_rollover *rollover = NULL;
 	struct packet_sock *po = pkt_sk(sk);
 	u16 type_flags = args->type_flags;
@@ -1661,6 +1864,7 @@ static int fanout_add(struct sock *sk, struct fanout_args *args)
 	case PACKET_FANOUT_QM:
 	case PACKET_FANOUT_CBPF:
 	case PACKET_FANOUT_EBPF:
+	case PACKET_FANOUT_FLOW:
 		break;
 	default:
 		return -EINVAL;
@@ -1683,6 +1887,13 @@ static int fanout_add(struct sock *sk, struct fanout_args *args)
 		atomic_long_set(&rollover->num_failed, 0);
 	}
 
+	if (type == PACKET_FANOUT_FLOW) {
+		err = -ENOMEM;
+		fanout_stats = kzalloc(sizeof(*fanout_stats), GFP_KERNEL);
+		if (!fanout_stats)
+			goto out;
+	}
+
 	if (type_flags & PACKET_FANOUT_FLAG_UNIQUEID) {
 		if (id != 0) {
 			err = -EINVAL;
@@ -1730,6 +1941,13 @@ static int fanout_add(struct sock *sk, struct fanout_args *args)
 		spin_lock_init(&match->lock);
 		refcount_set(&match->sk_ref, 0);
 		fanout_init_data(match);
+		if (type == PACKET_FANOUT_FLOW) {
+			match->flows = fanout_alloc_flows();
+			if (!match->flows) {
+				kvfree(match);
+				goto out;
+			}
+		}
 		match->prot_hook.type = po->prot_hook.type;
 		match->prot_hook.dev = po->prot_hook.dev;
 		match->prot_hook.func = packet_rcv_fanout;
@@ -1751,6 +1969,8 @@ static int fanout_add(struct sock *sk, struct fanout_args *args)
 			po->fanout = match;
 			po->rollover = rollover;
 			rollover = NULL;
+			po->fanout_stats = fanout_stats;
+			fanout_stats = NULL;
 			refcount_set(&match->sk_ref, refcount_read(&match->sk_ref) + 1);
 			__fanout_link(sk, po);
 			err = 0;
@@ -1760,10 +1980,12 @@ static int fanout_add(struct sock *sk, struct fanout_args *args)
 
 	if (err && !refcount_read(&match->sk_ref)) {
 		list_del(&match->list);
+		fanout_release_data(match);
 		kvfree(match);
 	}
 
 out:
+	kfree(fanout_stats);
 	kfree(rollover);
 	mutex_unlock(&fanout_mutex);
 	return err;
@@ -2156,6 +2378,9 @@ static int packet_rcv(struct sk_buff *skb, struct net_device *dev,
 	po->stats.stats1.tp_packets++;
 	sock_skb_set_dropcount(sk, skb);
 	__skb_queue_tail(&sk->sk_receive_queue, skb);
+	if (po->fanout_stats)
+		WRITE_ONCE(po->fanout_stats->queued,
+			   po->fanout_stats->queued + 1);
 	spin_unlock(&sk->sk_receive_queue.lock);
 	sk->sk_data_ready(sk);
 	return 0;
@@ -2196,6 +2421,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	__u32 ts_status;
 	bool is_drop_n_account = false;
 	unsigned int slot_id = 0;
+	bool truncated = false;
 	bool do_vnet = false;
 
 	/* struct tpacket{2,3}_hdr is aligned to a multiple of TPACKET_ALIGNMENT.
@@ -2290,6 +2516,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		pr_err_once("tpacket_rcv: packet too big, clamped from %u to %u. macoff=%u\n",
 			    snaplen, nval, macoff);
 		snaplen = nval;
+		truncated = true;
 		if (unlikely((int)snaplen < 0)) {
 			snaplen = 0;
 			macoff = GET_PBDQC_FROM_RB(&po->rx_ring)->max_frame_len;
@@ -2331,6 +2558,8 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	}
 
 	po->stats.stats1.tp_packets++;
+	if (truncated)
+		po->stats.stats3.tp_snap_trunc_cnt++;
 	if (copy_skb) {
 		status |= TP_STATUS_COPY;
 		__skb_queue_tail(&sk->sk_receive_queue, copy_skb);
@@ -3089,6 +3318,7 @@ static int packet_release(struct socket *sock)
 	synchronize_net();
 
 	kfree(po->rollover);
+	kfree(po->fanout_stats);
 	if (f) {
 		fanout_release_data(f);
 		kvfree(f);
@@ -3308,6 +3538,7 @@ static int packet_create(struct net *net, struct socket *sock, int protocol,
 	spin_lock_init(&po->bind_lock);
 	mutex_init(&po->pg_vec_lock);
 	po->rollover = NULL;
+	po->fanout_stats = NULL;
 	po->prot_hook.func = packet_rcv;
 
 	if (sock->type == SOCK_PACKET)
@@ -3385,6 +3616,9 @@ static int packet_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 	if (skb == NULL)
 		goto out;
 
+	if (pkt_sk(sk)->fanout_stats && !(flags & MSG_PEEK))
+		atomic_inc(&pkt_sk(sk)->fanout_stats->read);
+
 	packet_rcv_try_clear_pressure(pkt_sk(sk));
 
 	if (pkt_sk(sk)->has_vnet_hdr) {
@@ -3958,6 +4192,7 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 	void *data = &val;
 	union tpacket_stats_u st;
 	struct tpacket_rollover_stats rstats;
+	struct tpacket_fanout_stats fstats;
 	int drops;
 
 	if (level != SOL_PACKET)
@@ -4051,6 +4286,17 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 		data = &rstats;
 		lv = sizeof(rstats);
 		break;
+	case PACKET_FANOUT_STATS:
+		if (!po->fanout_stats)
+			return -EINVAL;
+		fstats.tp_flows_in =
+			atomic_long_read(&po->fanout_stats->flows_in);
+		fstats.tp_flows_out =
+			atomic_long_read(&po->fanout_stats->flows_out);
+		fstats.tp_held = atomic_long_read(&po->fanout_stats->held);
+		data = &fstats;
+		lv = sizeof(fstats);
+		break;
 	case PACKET_TX_HAS_OFF:
 		val = po->tp_tx_has_off;
 		break;
@@ -48,6 +48,12 @@ struct tpacket_kbdq_core {
 	unsigned short  version;
 	unsigned long	tov_in_jiffies;
 
+	/* TP_FT_REQ_BATCH_WAKEUP: full blocks retired since the reader
+	 * was last woken, and how many to retire before waking it.
+	 */
+	unsigned short	wake_pending;
+	unsigned short	wake_batch;
+
 	/* timer to retire an outstanding block */
 	struct timer_list retire_blk_timer;
 };
@@ -79,6 +85,16 @@ struct packet_ring_buffer {
 extern struct mutex fanout_mutex;
 #define PACKET_FANOUT_MAX	(1 << 16)
 
+/* PACKET_FANOUT_FLOW indirection table, indexed by flow hash */
+#define PACKET_FANOUT_FLOW_BUCKETS	4096
+#define PACKET_FANOUT_FLOW_IDLE_MS	10
+
+struct packet_fanout_flow {
+	u32			idx;	/* member, or U32_MAX if unassigned */
+	u32			last;	/* jiffies of the last packet */
+	u32			tail;	/* where idx queued the last packet */
+};
+
 struct packet_fanout {
 	possible_net_t		net;
 	unsigned int		num_members;
@@ -89,6 +105,10 @@ struct packet_fanout {
 	union {
 		atomic_t		rr_cur;
 		struct bpf_prog __rcu	*bpf_prog;
+		struct {
+			struct packet_fanout_flow *flows;
+			u32			flow_idle;
+		};
 	};
 	struct list_head	list;
 	spinlock_t		lock;
@@ -106,6 +126,15 @@ struct packet_rollover {
 	u32			history[ROLLOVER_HLEN] ____cacheline_aligned;
 } ____cacheline_aligned_in_smp;
 
+struct packet_fanout_stats {
+	atomic_long_t		flows_in;
+	atomic_long_t		flows_out;
+	atomic_long_t		held;
+	/* receive queue position, when there is no ring */
+	u32			queued;	/* under sk_receive_queue.lock */
+	atomic_t		read;
+};
+
 struct packet_sock {
 	/* struct sock has to be the first member of packet_sock */
 	struct sock		sk;
@@ -126,6 +155,7 @@ struct packet_sock {
 	int			ifindex;	/* bound device		*/
 	__be16			num;
 	struct packet_rollover	*rollover;
+	struct packet_fanout_stats	*fanout_stats;
 	struct packet_mclist	*mclist;
 	atomic_t		mapped;
 	enum tpacket_versions	tp_version;
@@ -685,6 +685,7 @@ static int __rds_create(struct socket *sock, struct sock *sk, int protocol)
 	rs->rs_rdma_keys = RB_ROOT;
 	rs->rs_rx_traces = 0;
 	rs->rs_tos = 0;
+	rs->rs_mprds_path = -1;
 	rs->rs_conn = NULL;
 
 	spin_lock_bh(&rds_sock_lock);
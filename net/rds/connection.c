@@ -33,6 +33,7 @@
 #include <linux/kernel.h>
 #include <linux/list.h>
 #include <linux/slab.h>
+#include <linux/cpumask.h>
 #include <linux/export.h>
 #include <net/ipv6.h>
 #include <net/inet6_hashtables.h>
@@ -130,8 +131,13 @@ static void rds_conn_path_reset(struct rds_conn_path *cp)
 static void __rds_conn_path_init(struct rds_connection *conn,
 				 struct rds_conn_path *cp, bool is_outgoing)
 {
+	static atomic_t rds_path_cpu = ATOMIC_INIT(0);
+	unsigned int idx = atomic_inc_return(&rds_path_cpu);
+
 	spin_lock_init(&cp->cp_lock);
 	cp->cp_next_tx_seq = 1;
+	cp->cp_xmit_seq = 1;
+	cp->cp_wq_cpu = cpumask_local_spread(idx, NUMA_NO_NODE);
 	init_waitqueue_head(&cp->cp_waitq);
 	INIT_LIST_HEAD(&cp->cp_send_queue);
 	INIT_LIST_HEAD(&cp->cp_retrans);
@@ -383,6 +389,14 @@ void rds_conn_shutdown(struct rds_conn_path *cp)
 		wait_event(cp->cp_waitq,
 			   !test_bit(RDS_RECV_REFILL, &cp->cp_flags));
 
+		/* Send and recv work run on rds_xmit_wq, not behind us on
+		 * rds_wq. They do nothing once the path is not up, but one
+		 * that started before must be done before the transport
+		 * goes away.
+		 */
+		cancel_delayed_work_sync(&cp->cp_send_w);
+		cancel_delayed_work_sync(&cp->cp_recv_w);
+
 		conn->c_trans->conn_path_shutdown(cp);
 		rds_conn_path_reset(cp);
 
@@ -111,6 +111,7 @@ struct rds_conn_path {
 
 	spinlock_t		cp_lock;		/* protect msg queues */
 	u64			cp_next_tx_seq;
+	u64			cp_xmit_seq;	/* first seq not yet sent */
 	struct list_head	cp_send_queue;
 	struct list_head	cp_retrans;
 
@@ -132,6 +133,7 @@ struct rds_conn_path {
 	unsigned int		cp_unacked_packets;
 	unsigned int		cp_unacked_bytes;
 	unsigned int		cp_index;
+	int			cp_wq_cpu;	/* cpu running send/recv work */
 };
 
 /* One rds_connection per RDS address pair */
@@ -650,6 +652,7 @@ struct rds_sock {
 	unsigned char		rs_recverr,
 				rs_cong_monitor;
 	u32			rs_hash_initval;
+	int			rs_mprds_path;	/* -1 until the first mprds send */
 
 	/* Socket receive path trace points*/
 	u8			rs_rx_traces;
@@ -810,6 +813,18 @@ rds_conn_path_state(struct rds_conn_path *cp)
 	return atomic_read(&cp->cp_state);
 }
 
+/* Number of messages queued on the path but not yet handed to the
+ * transport.  Read without cp_lock, so it is only a hint.
+ */
+static inline u64
+rds_conn_path_depth(struct rds_conn_path *cp)
+{
+	u64 next = READ_ONCE(cp->cp_next_tx_seq);
+	u64 xmit = READ_ONCE(cp->cp_xmit_seq);
+
+	return next > xmit ? next - xmit : 0;
+}
+
 static inline int
 rds_conn_state(struct rds_connection *conn)
 {
@@ -994,6 +1009,7 @@ extern unsigned int  rds_sysctl_trace_level;
 int rds_threads_init(void);
 void rds_threads_exit(void);
 extern struct workqueue_struct *rds_wq;
+extern struct workqueue_struct *rds_xmit_wq;
 void rds_queue_reconnect(struct rds_conn_path *cp);
 void rds_connect_worker(struct work_struct *);
 void rds_shutdown_worker(struct work_struct *);
@@ -1003,6 +1019,32 @@ void rds_connect_path_complete(struct rds_conn_path *conn, int curr);
 void rds_connect_complete(struct rds_connection *conn);
 int rds_addr_cmp(const struct in6_addr *a1, const struct in6_addr *a2);
 
+/* The cpu is picked when the path is set up and may be offline by now.
+ * A delayed work's timer armed there would not fire until it is back.
+ */
+static inline int rds_path_wq_cpu(struct rds_conn_path *cp)
+{
+	int cpu = cp->cp_wq_cpu;
+
+	if (unlikely(!cpu_online(cpu)))
+		return WORK_CPU_UNBOUND;
+	return cpu;
+}
+
+static inline void rds_queue_send_work(struct rds_conn_path *cp,
+				       unsigned long delay)
+{
+	queue_delayed_work_on(rds_path_wq_cpu(cp), rds_xmit_wq,
+			      &cp->cp_send_w, delay);
+}
+
+static inline void rds_queue_recv_work(struct rds_conn_path *cp,
+				       unsigned long delay)
+{
+	queue_delayed_work_on(rds_path_wq_cpu(cp), rds_xmit_wq,
+			      &cp->cp_recv_w, delay);
+}
+
 /* transport.c */
 void rds_trans_register(struct rds_transport *trans);
 void rds_trans_unregister(struct rds_transport *trans);
@@ -146,6 +146,7 @@ static void rds_conn_peer_gen_update(struct rds_connection *conn,
 				cp = &conn->c_path[i];
 				spin_lock_irqsave(&cp->cp_lock, flags);
 				cp->cp_next_tx_seq = 1;
+				cp->cp_xmit_seq = 1;
 				cp->cp_next_rx_seq = 0;
 				list_for_each_entry_safe(rm, tmp,
 							 &cp->cp_retrans,
@@ -146,6 +146,7 @@ int rds_send_xmit(struct rds_conn_path *cp)
 	int batch_count;
 	unsigned long send_gen = 0;
 	int same_rm = 0;
+	u64 seq;
 
 restart:
 	batch_count = 0;
@@ -263,6 +264,13 @@ int rds_send_xmit(struct rds_conn_path *cp)
 				 */
 				list_move_tail(&rm->m_conn_item,
 					       &cp->cp_retrans);
+
+				/* Retransmissions go out below cp_xmit_seq and
+				 * must not make the path look deeper than it is.
+				 */
+				seq = be64_to_cpu(rm->m_inc.i_hdr.h_sequence);
+				if (seq >= cp->cp_xmit_seq)
+					WRITE_ONCE(cp->cp_xmit_seq, seq + 1);
 			}
 
 			spin_unlock_irqrestore(&cp->cp_lock, flags);
@@ -459,7 +467,7 @@ int rds_send_xmit(struct rds_conn_path *cp)
 			if (rds_destroy_pending(cp->cp_conn))
 				ret = -ENETUNREACH;
 			else
-				queue_delayed_work(rds_wq, &cp->cp_send_w, 1);
+				rds_queue_send_work(cp, 1);
 			rcu_read_unlock();
 		} else if (raced) {
 			rds_stats_inc(s_send_lock_queue_raced);
@@ -1042,6 +1050,46 @@ static int rds_cmsg_send(struct rds_sock *rs, struct rds_message *rm,
 	return ret;
 }
 
+/* The first time a socket sends over a connection with several paths it
+ * takes the up path with the fewest messages waiting to be sent, keeping
+ * the hashed one unless another is strictly shallower.  Like the hash,
+ * that index is then used for every later send, so a socket's messages
+ * to a peer always share one path and are delivered in order.
+ */
+static int rds_send_mprds_pick(struct rds_sock *rs,
+			       struct rds_connection *conn, int hash)
+{
+	int path = READ_ONCE(rs->rs_mprds_path);
+	struct rds_conn_path *cp;
+	u64 depth, best_depth;
+	int i, best;
+
+	if (path >= 0)
+		return path % conn->c_npaths;
+
+	best = hash;
+	best_depth = rds_conn_path_depth(&conn->c_path[hash]);
+	if (!rds_conn_path_up(&conn->c_path[hash]))
+		best_depth = U64_MAX;
+
+	for (i = 0; i < conn->c_npaths; i++) {
+		cp = &conn->c_path[i];
+		if (i == hash || !rds_conn_path_up(cp))
+			continue;
+		depth = rds_conn_path_depth(cp);
+		if (depth < best_depth) {
+			best = i;
+			best_depth = depth;
+		}
+	}
+
+	/* Racing first sends all end up on the same path */
+	path = cmpxchg(&rs->rs_mprds_path, -1, best);
+	if (path >= 0)
+		best = path % conn->c_npaths;
+	return best;
+}
+
 static int rds_send_mprds_hash(struct rds_sock *rs,
 			       struct rds_connection *conn, int nonblock)
 {
@@ -1072,6 +1120,8 @@ static int rds_send_mprds_hash(struct rds_sock *rs,
 		if (conn->c_npaths == 1)
 			hash = 0;
 	}
+	if (conn->c_npaths > 1)
+		hash = rds_send_mprds_pick(rs, conn, hash);
 	return hash;
 }
 
@@ -1386,7 +1436,7 @@ int rds_sendmsg(struct socket *sock, struct msghdr *msg, size_t payload_len)
 		if (rds_destroy_pending(cpath->cp_conn))
 			ret = -ENETUNREACH;
 		else
-			queue_delayed_work(rds_wq, &cpath->cp_send_w, 1);
+			rds_queue_send_work(cpath, 1);
 		rcu_read_unlock();
 	}
 	if (ret)
@@ -1476,10 +1526,10 @@ rds_send_probe(struct rds_conn_path *cp, __be16 sport,
 	rds_stats_inc(s_send_queued);
 	rds_stats_inc(s_send_pong);
 
-	/* schedule the send work on rds_wq */
+	/* schedule the send work on the path cpu */
 	rcu_read_lock();
 	if (!rds_destroy_pending(cp->cp_conn))
-		queue_delayed_work(rds_wq, &cp->cp_send_w, 1);
+		rds_queue_send_work(cp, 1);
 	rcu_read_unlock();
 
 	rds_message_put(rm);
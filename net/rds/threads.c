@@ -71,6 +71,13 @@
 struct workqueue_struct *rds_wq;
 EXPORT_SYMBOL_GPL(rds_wq);
 
+/* Send and receive work runs on a per-cpu workqueue instead, each path
+ * bound to the cpu picked for it in __rds_conn_path_init(), so that
+ * busy paths do not serialize behind one another in krdsd.
+ */
+struct workqueue_struct *rds_xmit_wq;
+EXPORT_SYMBOL_GPL(rds_xmit_wq);
+
 void rds_connect_path_complete(struct rds_conn_path *cp, int curr)
 {
 	if (!rds_conn_path_transition(cp, curr, RDS_CONN_UP)) {
@@ -89,8 +96,8 @@ void rds_connect_path_complete(struct rds_conn_path *cp, int curr)
 	set_bit(0, &cp->cp_conn->c_map_queued);
 	rcu_read_lock();
 	if (!rds_destroy_pending(cp->cp_conn)) {
-		queue_delayed_work(rds_wq, &cp->cp_send_w, 0);
-		queue_delayed_work(rds_wq, &cp->cp_recv_w, 0);
+		rds_queue_send_work(cp, 0);
+		rds_queue_recv_work(cp, 0);
 	}
 	rcu_read_unlock();
 	cp->cp_conn->c_proposed_version = RDS_PROTOCOL_VERSION;
@@ -203,11 +210,11 @@ void rds_send_worker(struct work_struct *work)
 		switch (ret) {
 		case -EAGAIN:
 			rds_stats_inc(s_send_immediate_retry);
-			queue_delayed_work(rds_wq, &cp->cp_send_w, 0);
+			rds_queue_send_work(cp, 0);
 			break;
 		case -ENOMEM:
 			rds_stats_inc(s_send_delayed_retry);
-			queue_delayed_work(rds_wq, &cp->cp_send_w, 2);
+			rds_queue_send_work(cp, 2);
 		default:
 			break;
 		}
@@ -227,11 +234,11 @@ void rds_recv_worker(struct work_struct *work)
 		switch (ret) {
 		case -EAGAIN:
 			rds_stats_inc(s_recv_immediate_retry);
-			queue_delayed_work(rds_wq, &cp->cp_recv_w, 0);
+			rds_queue_recv_work(cp, 0);
 			break;
 		case -ENOMEM:
 			rds_stats_inc(s_recv_delayed_retry);
-			queue_delayed_work(rds_wq, &cp->cp_recv_w, 2);
+			rds_queue_recv_work(cp, 2);
 		default:
 			break;
 		}
@@ -249,6 +256,7 @@ void rds_shutdown_worker(struct work_struct *work)
 
 void rds_threads_exit(void)
 {
+	destroy_workqueue(rds_xmit_wq);
 	destroy_workqueue(rds_wq);
 }
 
@@ -258,6 +266,12 @@ int rds_threads_init(void)
 	if (!rds_wq)
 		return -ENOMEM;
 
+	rds_xmit_wq = alloc_workqueue("krdsd_xmit", WQ_MEM_RECLAIM, 0);
+	if (!rds_xmit_wq) {
+		destroy_workqueue(rds_wq);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
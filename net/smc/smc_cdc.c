@@ -51,6 +51,13 @@ static void smc_cdc_tx_handler(struct smc_wr_tx_pend_priv *pnd_snd,
 			      conn);
 		conn->tx_cdc_seq_fin = cdcpend->ctrl_seq;
 	}
+	/* fully ordered, pairs with the barrier after the sndbuf_space
+	 * update in smc_tx_sendmsg(): the last CDC msg in flight pushes
+	 * what was autocorked behind it
+	 */
+	if (atomic_dec_and_test(&conn->cdc_pend_tx_wr) && !wc_status &&
+	    smc_tx_prepared_sends(conn))
+		smc_tx_sndbuf_nonempty(conn);
 	smc_tx_sndbuf_nonfull(smc);
 	bh_unlock_sock(&smc->sk);
 }
@@ -107,6 +114,7 @@ int smc_cdc_msg_send(struct smc_connection *conn,
 	conn->tx_cdc_seq++;
 	conn->local_tx_ctrl.seqno = conn->tx_cdc_seq;
 	smc_host_msg_to_cdc((struct smc_cdc_msg *)wr_buf, conn, &cfed);
+	atomic_inc(&conn->cdc_pend_tx_wr);
 	rc = smc_wr_tx_send(link, (struct smc_wr_tx_pend_priv *)pend);
 	if (!rc) {
 		smc_curs_copy(&conn->rx_curs_confirmed, &cfed, conn);
@@ -114,6 +122,7 @@ int smc_cdc_msg_send(struct smc_connection *conn,
 	} else {
 		conn->tx_cdc_seq--;
 		conn->local_tx_ctrl.seqno = conn->tx_cdc_seq;
+		atomic_dec(&conn->cdc_pend_tx_wr);
 	}
 
 	return rc;
@@ -203,6 +212,9 @@ static void smc_cdc_tx_dismisser(struct smc_wr_tx_pend_priv *tx_pend)
 	struct smc_cdc_tx_pend *cdc_pend =
 		(struct smc_cdc_tx_pend *)tx_pend;
 
+	/* the completion handler will not see this one any more */
+	if (cdc_pend->conn)
+		atomic_dec(&cdc_pend->conn->cdc_pend_tx_wr);
 	cdc_pend->conn = NULL;
 }
 
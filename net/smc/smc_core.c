@@ -104,14 +104,37 @@ static void smc_lgr_add_alert_token(struct smc_connection *conn)
 	rb_insert_color(&conn->alert_node, &conn->lgr->conns_all);
 }
 
+/* count the connections of the link group currently using each link
+ * Requires @conns_lock
+ */
+static void smcr_lgr_count_link_conns(struct smc_link_group *lgr,
+				      int conns[SMC_LINKS_PER_LGR_MAX])
+{
+	struct smc_connection *conn;
+	struct rb_node *node;
+
+	memset(conns, 0, sizeof(int) * SMC_LINKS_PER_LGR_MAX);
+	for (node = rb_first(&lgr->conns_all); node; node = rb_next(node)) {
+		conn = rb_entry(node, struct smc_connection, alert_node);
+		if (conn->lnk)
+			conns[conn->lnk->link_idx]++;
+	}
+}
+
 /* assign an SMC-R link to the connection */
 static int smcr_lgr_conn_assign_link(struct smc_connection *conn, bool first)
 {
 	enum smc_link_state expected = first ? SMC_LNK_ACTIVATING :
 				       SMC_LNK_ACTIVE;
-	int i, j;
+	int conns[SMC_LINKS_PER_LGR_MAX];
+	int i;
+
+	if (conn->lgr->role == SMC_SERV)
+		smcr_lgr_count_link_conns(conn->lgr, conns);
 
-	/* do link balancing */
+	/* do link balancing: the server puts the connection on the usable
+	 * link that currently carries the fewest connections
+	 */
 	for (i = 0; i < SMC_LINKS_PER_LGR_MAX; i++) {
 		struct smc_link *lnk = &conn->lgr->lnk[i];
 
@@ -121,21 +144,8 @@ static int smcr_lgr_conn_assign_link(struct smc_connection *conn, bool first)
 			conn->lnk = lnk; /* temporary, SMC server assigns link*/
 			break;
 		}
-		if (conn->lgr->conns_num % 2) {
-			for (j = i + 1; j < SMC_LINKS_PER_LGR_MAX; j++) {
-				struct smc_link *lnk2;
-
-				lnk2 = &conn->lgr->lnk[j];
-				if (lnk2->state == expected &&
-				    !lnk2->link_is_asym) {
-					conn->lnk = lnk2;
-					break;
-				}
-			}
-		}
-		if (!conn->lnk)
+		if (!conn->lnk || conns[i] < conns[conn->lnk->link_idx])
 			conn->lnk = lnk;
-		break;
 	}
 	if (!conn->lnk)
 		return SMC_CLC_DECL_NOACTLINK;
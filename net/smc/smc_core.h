@@ -94,6 +94,9 @@ struct smc_link {
 	unsigned long		*wr_tx_mask;	/* bit mask of used indexes */
 	u32			wr_tx_cnt;	/* number of WR send buffers */
 	wait_queue_head_t	wr_tx_wait;	/* wait for free WR send buf */
+	atomic_long_t		wr_tx_msgs;	/* # of ib_post_send of slots */
+	atomic_long_t		wr_tx_wrs;	/* # of WRs posted with them */
+	atomic_long_t		tx_autocorks;	/* # of sends left in sndbuf */
 
 	struct smc_wr_buf	*wr_rx_bufs;	/* WR recv payload buffers */
 	struct ib_recv_wr	*wr_rx_ibs;	/* WR recv meta data */
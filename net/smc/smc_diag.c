@@ -175,6 +175,21 @@ static int __smc_diag_dump(struct sock *sk, struct sk_buff *skb,
 		if (nla_put(skb, SMC_DIAG_LGRINFO, sizeof(linfo), &linfo) < 0)
 			goto errout;
 	}
+	if (smc->conn.lgr && !smc->conn.lgr->is_smcd && smc->conn.lnk &&
+	    (req->diag_ext & (1 << (SMC_DIAG_LINKSTATS - 1))) &&
+	    !list_empty(&smc->conn.lgr->list)) {
+		struct smc_link *lnk = smc->conn.lnk;
+		struct smc_diag_linkstats lstats = {
+			.link_id = lnk->link_id,
+			.tx_msgs = atomic_long_read(&lnk->wr_tx_msgs),
+			.tx_wrs = atomic_long_read(&lnk->wr_tx_wrs),
+			.tx_autocorks = atomic_long_read(&lnk->tx_autocorks),
+		};
+
+		if (nla_put(skb, SMC_DIAG_LINKSTATS, sizeof(lstats),
+			    &lstats) < 0)
+			goto errout;
+	}
 	if (smc->conn.lgr && smc->conn.lgr->is_smcd &&
 	    (req->diag_ext & (1 << (SMC_DIAG_DMBINFO - 1))) &&
 	    !list_empty(&smc->conn.lgr->list)) {
@@ -30,6 +30,7 @@
 
 #define SMC_TX_WORK_DELAY	0
 #define SMC_TX_CORK_DELAY	(HZ >> 2)	/* 250 ms */
+#define SMC_TX_AUTOCORK_SIZE	(64 * 1024)
 
 /***************************** sndbuf producer *******************************/
 
@@ -128,6 +129,32 @@ static bool smc_tx_is_corked(struct smc_sock *smc)
 	return (tp->nonagle & TCP_NAGLE_CORK) ? true : false;
 }
 
+/* Small sends while a CDC msg of the connection is still in flight stay
+ * in the sndbuf, its send completion pushes them out together in one RDMA
+ * write and CDC msg, see smc_cdc_tx_handler().
+ */
+static bool smc_tx_should_autocork(struct smc_connection *conn)
+{
+	int corking_size;
+
+	if (conn->lgr->is_smcd || conn->urg_tx_pend)
+		return false;
+	if (!atomic_read(&conn->cdc_pend_tx_wr))
+		return false;
+	corking_size = min_t(int, conn->sndbuf_desc->len >> 1,
+			     SMC_TX_AUTOCORK_SIZE);
+	return smc_tx_prepared_sends(conn) <= corking_size;
+}
+
+/* The send completion normally pushes the data, tx_work only covers a
+ * completion that raced with the tx_curs_prep update in smc_tx_sendmsg()
+ */
+static void smc_tx_autocork(struct smc_connection *conn)
+{
+	atomic_long_inc(&conn->lnk->tx_autocorks);
+	queue_delayed_work(conn->lgr->tx_wq, &conn->tx_work, 1);
+}
+
 /* sndbuf producer: main API called by socket layer.
  * called under sock lock.
  */
@@ -230,6 +257,8 @@ int smc_tx_sendmsg(struct smc_sock *smc, struct msghdr *msg, size_t len)
 			 */
 			queue_delayed_work(conn->lgr->tx_wq, &conn->tx_work,
 					   SMC_TX_CORK_DELAY);
+		else if (smc_tx_should_autocork(conn))
+			smc_tx_autocork(conn);
 		else
 			smc_tx_sndbuf_nonempty(conn);
 	} /* while (msg_data_left(msg)) */
@@ -264,13 +293,14 @@ int smcd_tx_ism_write(struct smc_connection *conn, void *data, size_t len,
 	return rc;
 }
 
-/* sndbuf consumer: actual data transfer of one target chunk with RDMA write */
-static int smc_tx_rdma_write(struct smc_connection *conn, int peer_rmbe_offset,
-			     int num_sges, struct ib_rdma_wr *rdma_wr)
+/* sndbuf consumer: prepare the RDMA write of one target chunk, it is posted
+ * together with the CDC msg
+ */
+static void smc_tx_rdma_write(struct smc_connection *conn, int peer_rmbe_offset,
+			      int num_sges, struct ib_rdma_wr *rdma_wr)
 {
 	struct smc_link_group *lgr = conn->lgr;
 	struct smc_link *link = conn->lnk;
-	int rc;
 
 	rdma_wr->wr.wr_id = smc_wr_tx_get_next_wr_id(link);
 	rdma_wr->wr.num_sge = num_sges;
@@ -281,10 +311,6 @@ static int smc_tx_rdma_write(struct smc_connection *conn, int peer_rmbe_offset,
 		/* offset within RMBE */
 		peer_rmbe_offset;
 	rdma_wr->rkey = lgr->rtokens[conn->rtoken_idx][link->link_idx].rkey;
-	rc = ib_post_send(link->roce_qp, &rdma_wr->wr, NULL);
-	if (rc)
-		smcr_link_down_cond_sched(link);
-	return rc;
 }
 
 /* sndbuf consumer */
@@ -317,7 +343,6 @@ static int smcr_tx_rdma_writes(struct smc_connection *conn, size_t len,
 	int sent_count = src_off;
 	int srcchunk, dstchunk;
 	int num_sges;
-	int rc;
 
 	for (dstchunk = 0; dstchunk < 2; dstchunk++) {
 		struct ib_sge *sge =
@@ -339,10 +364,8 @@ static int smcr_tx_rdma_writes(struct smc_connection *conn, size_t len,
 			src_len = dst_len - src_len; /* remainder */
 			src_len_sum += src_len;
 		}
-		rc = smc_tx_rdma_write(conn, dst_off, num_sges,
-				       &wr_rdma_buf->wr_tx_rdma[dstchunk]);
-		if (rc)
-			return rc;
+		smc_tx_rdma_write(conn, dst_off, num_sges,
+				  &wr_rdma_buf->wr_tx_rdma[dstchunk]);
 		if (dst_len_sum == len)
 			break; /* either on 1st or 2nd iteration */
 		/* prepare next (== 2nd) iteration */
@@ -353,6 +376,7 @@ static int smcr_tx_rdma_writes(struct smc_connection *conn, size_t len,
 				sent_count);
 		src_len_sum = src_len;
 	}
+	smc_wr_tx_chain_rdma(link, wr_rdma_buf, dstchunk + 1);
 	return 0;
 }
 
@@ -45,6 +45,7 @@ struct smc_wr_tx_pend {	/* control data for a pending send request */
 	u32			idx;
 	struct smc_wr_tx_pend_priv priv;
 	u8			compl_requested;
+	u8			rdma_cnt;	/* RDMA writes chained in front */
 };
 
 /******************************** send queue *********************************/
@@ -116,12 +117,23 @@ static inline void smc_wr_tx_process_cqe(struct ib_wc *wc)
 		return;
 	if (wc->status) {
 		for_each_set_bit(i, link->wr_tx_mask, link->wr_tx_cnt) {
+			struct smc_wr_tx_pend pnd_flush;
+
+			memcpy(&pnd_flush, &link->wr_tx_pends[i],
+			       sizeof(pnd_flush));
 			/* clear full struct smc_wr_tx_pend including .priv */
 			memset(&link->wr_tx_pends[i], 0,
 			       sizeof(link->wr_tx_pends[i]));
 			memset(&link->wr_tx_bufs[i], 0,
 			       sizeof(link->wr_tx_bufs[i]));
 			clear_bit(i, link->wr_tx_mask);
+			/* its flushed CQE will not find the slot any more,
+			 * run the handler now so that e.g. cdc_pend_tx_wr
+			 * drops back to zero
+			 */
+			if (pnd_flush.handler)
+				pnd_flush.handler(&pnd_flush.priv, link,
+						  IB_WC_WR_FLUSH_ERR);
 		}
 		/* terminate link */
 		smcr_link_down_cond_sched(link);
@@ -261,18 +273,43 @@ int smc_wr_tx_put_slot(struct smc_link *link,
 	return 0;
 }
 
-/* Send prepared WR slot via ib_post_send.
+/* Chain the first @num RDMA writes prepared in the slot's @wr_rdma_buf in
+ * front of the slot's send WR, so that smc_wr_tx_send() posts them all with
+ * a single doorbell. The QP executes them in order, so the peer sees the
+ * data before the message announcing it.
+ */
+void smc_wr_tx_chain_rdma(struct smc_link *link,
+			  struct smc_rdma_wr *wr_rdma_buf, int num)
+{
+	u32 idx = wr_rdma_buf - link->wr_tx_rdmas;
+	int i;
+
+	for (i = 0; i < num - 1; i++)
+		wr_rdma_buf->wr_tx_rdma[i].wr.next =
+			&wr_rdma_buf->wr_tx_rdma[i + 1].wr;
+	wr_rdma_buf->wr_tx_rdma[num - 1].wr.next = &link->wr_tx_ibs[idx];
+	link->wr_tx_pends[idx].rdma_cnt = num;
+}
+
+/* Send prepared WR slot via ib_post_send, together with the RDMA writes
+ * chained in front of it, if any.
  * @priv: pointer to smc_wr_tx_pend_priv identifying prepared message buffer
  */
 int smc_wr_tx_send(struct smc_link *link, struct smc_wr_tx_pend_priv *priv)
 {
 	struct smc_wr_tx_pend *pend;
+	struct ib_send_wr *wr;
 	int rc;
 
 	ib_req_notify_cq(link->smcibdev->roce_cq_send,
 			 IB_CQ_NEXT_COMP | IB_CQ_REPORT_MISSED_EVENTS);
 	pend = container_of(priv, struct smc_wr_tx_pend, priv);
-	rc = ib_post_send(link->roce_qp, &link->wr_tx_ibs[pend->idx], NULL);
+	wr = &link->wr_tx_ibs[pend->idx];
+	if (pend->rdma_cnt)
+		wr = &link->wr_tx_rdmas[pend->idx].wr_tx_rdma[0].wr;
+	atomic_long_inc(&link->wr_tx_msgs);
+	atomic_long_add(pend->rdma_cnt + 1, &link->wr_tx_wrs);
+	rc = ib_post_send(link->roce_qp, wr, NULL);
 	if (rc) {
 		smc_wr_tx_put_slot(link, priv);
 		smcr_link_down_cond_sched(link);
@@ -710,6 +747,9 @@ int smc_wr_create_link(struct smc_link *lnk)
 	int rc = 0;
 
 	smc_wr_tx_set_wr_id(&lnk->wr_tx_id, 0);
+	atomic_long_set(&lnk->wr_tx_msgs, 0);
+	atomic_long_set(&lnk->wr_tx_wrs, 0);
+	atomic_long_set(&lnk->tx_autocorks, 0);
 	lnk->wr_rx_id = 0;
 	lnk->wr_rx_dma_addr = ib_dma_map_single(
 		ibdev, lnk->wr_rx_bufs,	SMC_WR_BUF_SIZE * lnk->wr_rx_cnt,
@@ -36,6 +36,7 @@
 
 #include "core.h"
 #include "link.h"
+#include "bcast.h"
 #include "name_distr.h"
 
 int sysctl_tipc_named_timeout __read_mostly = 2000;
@@ -136,6 +137,73 @@ struct sk_buff *tipc_named_withdraw(struct net *net, struct publication *publ)
 	return skb;
 }
 
+/**
+ * tipc_named_withdraw_bulk - tell other nodes about several withdrawn publications
+ * @publs: publications by this node, already removed from the name table and
+ *         linked through their 'list' member
+ * @xmitq: queue for the resulting messages, to be broadcast by the caller
+ *
+ * Items are packed into as few messages as tipc_node_broadcast() can carry
+ * to every destination, which for replicast is the smallest MTU of the
+ * peer links.  Each message takes one sequence number, and the items it
+ * carries are applied in order by the receiving nodes, so this is
+ * equivalent to sending one withdrawal per publication.
+ *
+ * tipc_nametbl_lock must be held.
+ */
+void tipc_named_withdraw_bulk(struct net *net, struct list_head *publs,
+			      struct sk_buff_head *xmitq)
+{
+	struct name_table *nt = tipc_name_table(net);
+	u32 mtu = tipc_node_broadcast_mtu(net, nt->rc_dests);
+	u32 msg_dsz = ((mtu - INT_H_SIZE) / ITEM_SIZE) * ITEM_SIZE;
+	struct distr_item *item = NULL;
+	struct publication *publ;
+	struct sk_buff *skb = NULL;
+	u32 msg_rem = msg_dsz;
+	struct tipc_msg *hdr;
+
+	write_lock_bh(&nt->cluster_scope_lock);
+	list_for_each_entry(publ, publs, list)
+		list_del(&publ->binding_node);
+	write_unlock_bh(&nt->cluster_scope_lock);
+
+	list_for_each_entry(publ, publs, list) {
+		if (publ->scope == TIPC_NODE_SCOPE)
+			continue;
+
+		/* Prepare next buffer: */
+		if (!skb) {
+			skb = named_prepare_buf(net, WITHDRAWAL, msg_rem, 0);
+			if (!skb) {
+				pr_warn("Withdrawal distribution failure\n");
+				return;
+			}
+			hdr = buf_msg(skb);
+			msg_set_named_seqno(hdr, nt->snd_nxt++);
+			msg_set_non_legacy(hdr);
+			item = (struct distr_item *)msg_data(hdr);
+		}
+
+		publ_to_item(item, publ);
+		item++;
+		msg_rem -= ITEM_SIZE;
+
+		/* Append full buffer to list: */
+		if (!msg_rem) {
+			__skb_queue_tail(xmitq, skb);
+			skb = NULL;
+			msg_rem = msg_dsz;
+		}
+	}
+	if (skb) {
+		hdr = buf_msg(skb);
+		msg_set_size(hdr, INT_H_SIZE + (msg_dsz - msg_rem));
+		skb_trim(skb, INT_H_SIZE + (msg_dsz - msg_rem));
+		__skb_queue_tail(xmitq, skb);
+	}
+}
+
 /**
  * named_distribute - prepare name info for bulk distribution to another node
  * @list: list of messages (buffers) to be returned from this function
@@ -145,6 +213,7 @@ struct sk_buff *tipc_named_withdraw(struct net *net, struct publication *publ)
 static void named_distribute(struct net *net, struct sk_buff_head *list,
 			     u32 dnode, struct list_head *pls, u16 seqno)
 {
+	struct name_table_stats *stats = &tipc_name_table(net)->stats;
 	struct publication *publ;
 	struct sk_buff *skb = NULL;
 	struct distr_item *item = NULL;
@@ -152,6 +221,7 @@ static void named_distribute(struct net *net, struct sk_buff_head *list,
 			ITEM_SIZE) * ITEM_SIZE;
 	u32 msg_rem = msg_dsz;
 	struct tipc_msg *hdr;
+	u32 cnt = 0;
 
 	list_for_each_entry(publ, pls, binding_node) {
 		/* Prepare next buffer: */
@@ -173,6 +243,7 @@ static void named_distribute(struct net *net, struct sk_buff_head *list,
 		publ_to_item(item, publ);
 		item++;
 		msg_rem -= ITEM_SIZE;
+		cnt++;
 
 		/* Append full buffer to list: */
 		if (!msg_rem) {
@@ -190,6 +261,9 @@ static void named_distribute(struct net *net, struct sk_buff_head *list,
 	hdr = buf_msg(skb_peek_tail(list));
 	msg_set_last_bulk(hdr);
 	msg_set_named_seqno(hdr, seqno);
+
+	atomic_add(skb_queue_len(list), &stats->bulk_sent);
+	atomic64_add(cnt, &stats->bulk_items_sent);
 }
 
 /**
@@ -283,7 +357,7 @@ void tipc_publ_notify(struct net *net, struct list_head *nsub_list,
  * tipc_update_nametbl - try to process a nametable update and notify
  *			 subscribers
  *
- * tipc_nametbl_lock must be held.
+ * The lock of the originating peer must be held.
  * Returns the publication item if successful, otherwise NULL.
  */
 static bool tipc_update_nametbl(struct net *net, struct distr_item *i,
@@ -366,29 +440,52 @@ static struct sk_buff *tipc_named_dequeue(struct sk_buff_head *namedq,
 
 /**
  * tipc_named_rcv - process name table update messages sent by another node
+ *
+ * Updates from one peer are applied in order under that peer's lock, while
+ * the name table itself is only locked per service type.  Updates from
+ * different peers, and local binding changes, can thus proceed in parallel.
  */
 void tipc_named_rcv(struct net *net, struct sk_buff_head *namedq,
-		    u16 *rcv_nxt, bool *open)
+		    struct tipc_named_peer *peer)
 {
-	struct tipc_net *tn = tipc_net(net);
+	struct name_table_stats *stats = &tipc_name_table(net)->stats;
 	struct distr_item *item;
 	struct tipc_msg *hdr;
 	struct sk_buff *skb;
-	u32 count, node;
+	u32 count, node, ms;
 
-	spin_lock_bh(&tn->nametbl_lock);
-	while ((skb = tipc_named_dequeue(namedq, rcv_nxt, open))) {
+	spin_lock_bh(&peer->lock);
+	while ((skb = tipc_named_dequeue(namedq, &peer->rcv_nxt,
+					 &peer->open))) {
 		hdr = buf_msg(skb);
 		node = msg_orignode(hdr);
 		item = (struct distr_item *)msg_data(hdr);
 		count = msg_data_sz(hdr) / ITEM_SIZE;
+
+		if (msg_is_bulk(hdr)) {
+			if (!peer->sync_start)
+				peer->sync_start = jiffies ?: 1;
+			atomic64_add(count, &stats->bulk_items);
+		} else {
+			atomic64_add(count, &stats->updates);
+		}
+
 		while (count--) {
 			tipc_update_nametbl(net, item, node, msg_type(hdr));
 			item++;
 		}
+
+		if (msg_is_last_bulk(hdr) && peer->sync_start) {
+			ms = jiffies_to_msecs(jiffies - peer->sync_start);
+			peer->sync_start = 0;
+			WRITE_ONCE(stats->sync_last, ms);
+			if (ms > READ_ONCE(stats->sync_max))
+				WRITE_ONCE(stats->sync_max, ms);
+			atomic_inc(&stats->bulk_syncs);
+		}
 		kfree_skb(skb);
 	}
-	spin_unlock_bh(&tn->nametbl_lock);
+	spin_unlock_bh(&peer->lock);
 }
 
 /**
@@ -67,12 +67,28 @@ struct distr_item {
 	__be32 key;
 };
 
+/**
+ * struct tipc_named_peer - name table update receive state for a peer node
+ * @lock: serializes processing of the peer's name table updates
+ * @rcv_nxt: sequence number of the next expected update
+ * @open: bulk synchronization with the peer has completed
+ * @sync_start: when the first bulk message from the peer was processed
+ */
+struct tipc_named_peer {
+	spinlock_t lock;
+	u16 rcv_nxt;
+	bool open;
+	unsigned long sync_start;
+};
+
 void tipc_named_bcast(struct net *net, struct sk_buff *skb);
 struct sk_buff *tipc_named_publish(struct net *net, struct publication *publ);
 struct sk_buff *tipc_named_withdraw(struct net *net, struct publication *publ);
+void tipc_named_withdraw_bulk(struct net *net, struct list_head *publs,
+			      struct sk_buff_head *xmitq);
 void tipc_named_node_up(struct net *net, u32 dnode, u16 capabilities);
 void tipc_named_rcv(struct net *net, struct sk_buff_head *namedq,
-		    u16 *rcv_nxt, bool *open);
+		    struct tipc_named_peer *peer);
 void tipc_named_reinit(struct net *net);
 void tipc_publ_notify(struct net *net, struct list_head *nsub_list,
 		      u32 addr, u16 capabilities);
@@ -216,6 +216,17 @@ static int hash(int x)
 	return x & (TIPC_NAMETBL_SIZE - 1);
 }
 
+/**
+ * tipc_service_lock - lock covering the hash list of a service type
+ *
+ * Held when a service is added to or removed from its hash list, so that
+ * updates to different service types do not serialize on nametbl_lock.
+ */
+static spinlock_t *tipc_service_lock(struct name_table *nt, u32 type)
+{
+	return &nt->services_lock[hash(type) & (TIPC_NAMETBL_LOCKS - 1)];
+}
+
 /**
  * tipc_publ_create - create a publication structure
  */
@@ -461,24 +472,28 @@ struct publication *tipc_nametbl_insert_publ(struct net *net, u32 type,
 					     u32 port, u32 key)
 {
 	struct name_table *nt = tipc_name_table(net);
+	spinlock_t *lock = tipc_service_lock(nt, type);
+	struct publication *p = NULL;
 	struct tipc_service *sc;
-	struct publication *p;
 
 	if (scope > TIPC_NODE_SCOPE || lower > upper) {
 		pr_debug("Failed to bind illegal {%u,%u,%u} with scope %u\n",
 			 type, lower, upper, scope);
 		return NULL;
 	}
+	spin_lock_bh(lock);
 	sc = tipc_service_find(net, type);
 	if (!sc)
 		sc = tipc_service_create(type, &nt->services[hash(type)]);
 	if (!sc)
-		return NULL;
+		goto exit;
 
 	spin_lock_bh(&sc->lock);
 	p = tipc_service_insert_publ(net, sc, type, lower, upper,
 				     scope, node, port, key);
 	spin_unlock_bh(&sc->lock);
+exit:
+	spin_unlock_bh(lock);
 	return p;
 }
 
@@ -486,14 +501,17 @@ struct publication *tipc_nametbl_remove_publ(struct net *net, u32 type,
 					     u32 lower, u32 upper,
 					     u32 node, u32 key)
 {
-	struct tipc_service *sc = tipc_service_find(net, type);
+	spinlock_t *lock = tipc_service_lock(tipc_name_table(net), type);
 	struct tipc_subscription *sub, *tmp;
 	struct service_range *sr = NULL;
 	struct publication *p = NULL;
+	struct tipc_service *sc;
 	bool last;
 
+	spin_lock_bh(lock);
+	sc = tipc_service_find(net, type);
 	if (!sc)
-		return NULL;
+		goto unlock;
 
 	spin_lock_bh(&sc->lock);
 	sr = tipc_service_find_range(sc, lower, upper);
@@ -523,6 +541,8 @@ struct publication *tipc_nametbl_remove_publ(struct net *net, u32 type,
 	}
 exit:
 	spin_unlock_bh(&sc->lock);
+unlock:
+	spin_unlock_bh(lock);
 	return p;
 }
 
@@ -789,19 +809,69 @@ int tipc_nametbl_withdraw(struct net *net, u32 type, u32 lower,
 	return 0;
 }
 
+/**
+ * tipc_nametbl_withdraw_all - withdraw all service bindings of a socket
+ * @publs: the socket's list of publications
+ *
+ * Unlike withdrawing the bindings one by one, the withdrawals are
+ * distributed to the other nodes in as few messages as possible.
+ * Returns the number of bindings withdrawn.
+ */
+int tipc_nametbl_withdraw_all(struct net *net, struct list_head *publs)
+{
+	struct name_table *nt = tipc_name_table(net);
+	struct tipc_net *tn = tipc_net(net);
+	u32 self = tipc_own_addr(net);
+	struct publication *publ, *p, *tmp;
+	struct sk_buff_head xmitq;
+	struct sk_buff *skb;
+	LIST_HEAD(withdrawn);
+	u32 rc_dests;
+	int cnt = 0;
+
+	__skb_queue_head_init(&xmitq);
+	spin_lock_bh(&tn->nametbl_lock);
+
+	list_for_each_entry_safe(publ, tmp, publs, binding_sock) {
+		p = tipc_nametbl_remove_publ(net, publ->type, publ->lower,
+					     publ->upper, self, publ->key);
+		if (!p) {
+			pr_err("Failed to remove local publication {%u,%u,%u}/%u\n",
+			       publ->type, publ->lower, publ->upper,
+			       publ->key);
+			continue;
+		}
+		nt->local_publ_count--;
+		list_del_init(&p->binding_sock);
+		list_add_tail(&p->list, &withdrawn);
+		cnt++;
+	}
+	tipc_named_withdraw_bulk(net, &withdrawn, &xmitq);
+	rc_dests = nt->rc_dests;
+	spin_unlock_bh(&tn->nametbl_lock);
+
+	list_for_each_entry_safe(p, tmp, &withdrawn, list) {
+		list_del(&p->list);
+		kfree_rcu(p, rcu);
+	}
+	while ((skb = __skb_dequeue(&xmitq)))
+		tipc_node_broadcast(net, skb, rc_dests);
+	return cnt;
+}
+
 /**
  * tipc_nametbl_subscribe - add a subscription object to the name table
  */
 bool tipc_nametbl_subscribe(struct tipc_subscription *sub)
 {
 	struct name_table *nt = tipc_name_table(sub->net);
-	struct tipc_net *tn = tipc_net(sub->net);
 	struct tipc_subscr *s = &sub->evt.s;
 	u32 type = tipc_sub_read(s, seq.type);
+	spinlock_t *lock = tipc_service_lock(nt, type);
 	struct tipc_service *sc;
 	bool res = true;
 
-	spin_lock_bh(&tn->nametbl_lock);
+	spin_lock_bh(lock);
 	sc = tipc_service_find(sub->net, type);
 	if (!sc)
 		sc = tipc_service_create(type, &nt->services[hash(type)]);
@@ -815,7 +885,7 @@ bool tipc_nametbl_subscribe(struct tipc_subscription *sub)
 			tipc_sub_read(s, seq.upper));
 		res = false;
 	}
-	spin_unlock_bh(&tn->nametbl_lock);
+	spin_unlock_bh(lock);
 	return res;
 }
 
@@ -824,12 +894,13 @@ bool tipc_nametbl_subscribe(struct tipc_subscription *sub)
  */
 void tipc_nametbl_unsubscribe(struct tipc_subscription *sub)
 {
-	struct tipc_net *tn = tipc_net(sub->net);
+	struct name_table *nt = tipc_name_table(sub->net);
 	struct tipc_subscr *s = &sub->evt.s;
 	u32 type = tipc_sub_read(s, seq.type);
+	spinlock_t *lock = tipc_service_lock(nt, type);
 	struct tipc_service *sc;
 
-	spin_lock_bh(&tn->nametbl_lock);
+	spin_lock_bh(lock);
 	sc = tipc_service_find(sub->net, type);
 	if (!sc)
 		goto exit;
@@ -845,7 +916,7 @@ void tipc_nametbl_unsubscribe(struct tipc_subscription *sub)
 	}
 	spin_unlock_bh(&sc->lock);
 exit:
-	spin_unlock_bh(&tn->nametbl_lock);
+	spin_unlock_bh(lock);
 }
 
 int tipc_nametbl_init(struct net *net)
@@ -860,6 +931,8 @@ int tipc_nametbl_init(struct net *net)
 
 	for (i = 0; i < TIPC_NAMETBL_SIZE; i++)
 		INIT_HLIST_HEAD(&nt->services[i]);
+	for (i = 0; i < TIPC_NAMETBL_LOCKS; i++)
+		spin_lock_init(&nt->services_lock[i]);
 
 	INIT_LIST_HEAD(&nt->node_scope);
 	INIT_LIST_HEAD(&nt->cluster_scope);
@@ -897,6 +970,7 @@ void tipc_nametbl_stop(struct net *net)
 	struct tipc_net *tn = tipc_net(net);
 	struct hlist_head *service_head;
 	struct tipc_service *service;
+	spinlock_t *lock;
 	u32 i;
 
 	/* Verify name table is empty and purge any lingering
@@ -907,9 +981,12 @@ void tipc_nametbl_stop(struct net *net)
 		if (hlist_empty(&nt->services[i]))
 			continue;
 		service_head = &nt->services[i];
+		lock = &nt->services_lock[i & (TIPC_NAMETBL_LOCKS - 1)];
+		spin_lock_bh(lock);
 		hlist_for_each_entry_rcu(service, service_head, service_list) {
 			tipc_service_delete(net, service);
 		}
+		spin_unlock_bh(lock);
 	}
 	spin_unlock_bh(&tn->nametbl_lock);
 
@@ -48,6 +48,7 @@ struct tipc_group;
 #define TIPC_ZM_SRV		3	/* zone master service name type */
 #define TIPC_PUBL_SCOPE_NUM	(TIPC_NODE_SCOPE + 1)
 #define TIPC_NAMETBL_SIZE	1024	/* must be a power of 2 */
+#define TIPC_NAMETBL_LOCKS	64	/* must be a power of 2 */
 
 /**
  * struct publication - info about a published (name or) name sequence
@@ -90,24 +91,49 @@ struct publication {
 	struct rcu_head rcu;
 };
 
+/**
+ * struct name_table_stats - name distribution counters
+ * @bulk_sent: bulk messages sent to nodes coming up
+ * @bulk_items_sent: publications carried by those messages
+ * @bulk_syncs: bulk synchronizations completed by peer nodes
+ * @bulk_items: publications received in bulk messages
+ * @updates: publications and withdrawals received outside bulk messages
+ * @sync_last: duration of the last completed bulk synchronization (ms)
+ * @sync_max: longest bulk synchronization seen (ms)
+ */
+struct name_table_stats {
+	atomic_t bulk_sent;
+	atomic64_t bulk_items_sent;
+	atomic_t bulk_syncs;
+	atomic64_t bulk_items;
+	atomic64_t updates;
+	u32 sync_last;
+	u32 sync_max;
+};
+
 /**
  * struct name_table - table containing all existing port name publications
- * @seq_hlist: name sequence hash lists
+ * @services: service hash lists
+ * @services_lock: locks protecting insertion into and removal from the
+ *                 service hash lists, each covering a stripe of the lists
  * @node_scope: all local publications with node scope
  *               - used by name_distr during re-init of name table
  * @cluster_scope: all local publications with cluster scope
  *               - used by name_distr to send bulk updates to new nodes
  *               - used by name_distr during re-init of name table
  * @local_publ_count: number of publications issued by this node
+ * @stats: name distribution counters
  */
 struct name_table {
 	struct hlist_head services[TIPC_NAMETBL_SIZE];
+	spinlock_t services_lock[TIPC_NAMETBL_LOCKS];
 	struct list_head node_scope;
 	struct list_head cluster_scope;
 	rwlock_t cluster_scope_lock;
 	u32 local_publ_count;
 	u32 rc_dests;
 	u32 snd_nxt;
+	struct name_table_stats stats;
 };
 
 int tipc_nl_name_table_dump(struct sk_buff *skb, struct netlink_callback *cb);
@@ -127,6 +153,7 @@ struct publication *tipc_nametbl_publish(struct net *net, u32 type, u32 lower,
 					 u32 key);
 int tipc_nametbl_withdraw(struct net *net, u32 type, u32 lower, u32 upper,
 			  u32 key);
+int tipc_nametbl_withdraw_all(struct net *net, struct list_head *publs);
 struct publication *tipc_nametbl_insert_publ(struct net *net, u32 type,
 					     u32 lower, u32 upper, u32 scope,
 					     u32 node, u32 ref, u32 key);
@@ -166,6 +166,34 @@ void tipc_net_stop(struct net *net)
 	pr_info("Left network mode\n");
 }
 
+static int __tipc_nl_add_named_stats(struct net *net, struct tipc_nl_msg *msg)
+{
+	struct name_table_stats *stats = &tipc_name_table(net)->stats;
+
+	if (nla_put_u32(msg->skb, TIPC_NLA_NET_NAMED_BULK_SENT,
+			atomic_read(&stats->bulk_sent)))
+		return -EMSGSIZE;
+	if (nla_put_u64_64bit(msg->skb, TIPC_NLA_NET_NAMED_BULK_ITEMS_SENT,
+			      atomic64_read(&stats->bulk_items_sent), 0))
+		return -EMSGSIZE;
+	if (nla_put_u32(msg->skb, TIPC_NLA_NET_NAMED_BULK_SYNCS,
+			atomic_read(&stats->bulk_syncs)))
+		return -EMSGSIZE;
+	if (nla_put_u64_64bit(msg->skb, TIPC_NLA_NET_NAMED_BULK_ITEMS,
+			      atomic64_read(&stats->bulk_items), 0))
+		return -EMSGSIZE;
+	if (nla_put_u64_64bit(msg->skb, TIPC_NLA_NET_NAMED_UPDATES,
+			      atomic64_read(&stats->updates), 0))
+		return -EMSGSIZE;
+	if (nla_put_u32(msg->skb, TIPC_NLA_NET_NAMED_SYNC_LAST,
+			READ_ONCE(stats->sync_last)))
+		return -EMSGSIZE;
+	if (nla_put_u32(msg->skb, TIPC_NLA_NET_NAMED_SYNC_MAX,
+			READ_ONCE(stats->sync_max)))
+		return -EMSGSIZE;
+	return 0;
+}
+
 static int __tipc_nl_add_net(struct net *net, struct tipc_nl_msg *msg)
 {
 	struct tipc_net *tn = net_generic(net, tipc_net_id);
@@ -189,6 +217,8 @@ static int __tipc_nl_add_net(struct net *net, struct tipc_nl_msg *msg)
 		goto attr_msg_full;
 	if (nla_put_u64_64bit(msg->skb, TIPC_NLA_NET_NODEID_W1, *w1, 0))
 		goto attr_msg_full;
+	if (__tipc_nl_add_named_stats(net, msg))
+		goto attr_msg_full;
 	nla_nest_end(msg->skb, attrs);
 	genlmsg_end(msg->skb, hdr);
 
@@ -83,7 +83,14 @@ const struct nla_policy tipc_nl_net_policy[TIPC_NLA_NET_MAX + 1] = {
 	[TIPC_NLA_NET_ADDR]		= { .type = NLA_U32 },
 	[TIPC_NLA_NET_NODEID]		= { .type = NLA_U64 },
 	[TIPC_NLA_NET_NODEID_W1]	= { .type = NLA_U64 },
-	[TIPC_NLA_NET_ADDR_LEGACY]	= { .type = NLA_FLAG }
+	[TIPC_NLA_NET_ADDR_LEGACY]	= { .type = NLA_FLAG },
+	[TIPC_NLA_NET_NAMED_BULK_SENT]	= { .type = NLA_U32 },
+	[TIPC_NLA_NET_NAMED_BULK_ITEMS_SENT] = { .type = NLA_U64 },
+	[TIPC_NLA_NET_NAMED_BULK_SYNCS]	= { .type = NLA_U32 },
+	[TIPC_NLA_NET_NAMED_BULK_ITEMS]	= { .type = NLA_U64 },
+	[TIPC_NLA_NET_NAMED_UPDATES]	= { .type = NLA_U64 },
+	[TIPC_NLA_NET_NAMED_SYNC_LAST]	= { .type = NLA_U32 },
+	[TIPC_NLA_NET_NAMED_SYNC_MAX]	= { .type = NLA_U32 }
 };
 
 const struct nla_policy tipc_nl_link_policy[TIPC_NLA_LINK_MAX + 1] = {
@@ -75,8 +75,7 @@ struct tipc_bclink_entry {
 	struct sk_buff_head arrvq;
 	struct sk_buff_head inputq2;
 	struct sk_buff_head namedq;
-	u16 named_rcv_nxt;
-	bool named_open;
+	struct tipc_named_peer named;
 };
 
 /**
@@ -541,6 +540,7 @@ struct tipc_node *tipc_node_create(struct net *net, u32 addr, u8 *peer_id,
 	INIT_LIST_HEAD(&n->publ_list);
 	INIT_LIST_HEAD(&n->conn_sks);
 	skb_queue_head_init(&n->bc_entry.namedq);
+	spin_lock_init(&n->bc_entry.named.lock);
 	skb_queue_head_init(&n->bc_entry.inputq1);
 	__skb_queue_head_init(&n->bc_entry.arrvq);
 	skb_queue_head_init(&n->bc_entry.inputq2);
@@ -1497,6 +1497,7 @@ static void node_lost_contact(struct tipc_node *n,
 	/* Clean up broadcast state */
 	tipc_bcast_remove_peer(n->net, n->bc_entry.link);
 	skb_queue_purge(&n->bc_entry.namedq);
+	n->bc_entry.named.sync_start = 0;
 
 	/* Abort any ongoing link failover */
 	for (i = 0; i < MAX_BEARERS; i++) {
@@ -1777,6 +1778,34 @@ void tipc_node_broadcast(struct net *net, struct sk_buff *skb, int rc_dests)
 	kfree_skb(skb);
 }
 
+/**
+ * tipc_node_broadcast_mtu - largest message tipc_node_broadcast() can send
+ * @rc_dests: as passed to tipc_node_broadcast()
+ *
+ * Replicast goes over each peer's unicast link, whose MTU may be below the
+ * one of the broadcast link.
+ */
+u32 tipc_node_broadcast_mtu(struct net *net, int rc_dests)
+{
+	u32 mtu = tipc_bcast_get_mtu(net);
+	struct tipc_node *n;
+
+	if (!rc_dests && tipc_bcast_get_mode(net) != BCLINK_MODE_RCAST)
+		return mtu;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(n, tipc_nodes(net), list) {
+		if (in_own_node(net, n->addr))
+			continue;
+		if (!node_is_up(n))
+			continue;
+		mtu = min_t(u32, mtu,
+			    tipc_node_get_mtu(net, n->addr, 0, false));
+	}
+	rcu_read_unlock();
+	return mtu;
+}
+
 static void tipc_node_mcast_rcv(struct tipc_node *n)
 {
 	struct tipc_bclink_entry *be = &n->bc_entry;
@@ -1868,9 +1897,7 @@ static void tipc_node_bc_rcv(struct net *net, struct sk_buff *skb, int bearer_id
 
 	/* Handle NAME_DISTRIBUTOR messages sent from 1.7 nodes */
 	if (!skb_queue_empty(&n->bc_entry.namedq))
-		tipc_named_rcv(net, &n->bc_entry.namedq,
-			       &n->bc_entry.named_rcv_nxt,
-			       &n->bc_entry.named_open);
+		tipc_named_rcv(net, &n->bc_entry.namedq, &n->bc_entry.named);
 
 	/* If reassembly or retransmission failure => reset all links to peer */
 	if (rc & TIPC_LINK_DOWN_EVT)
@@ -2140,9 +2167,7 @@ void tipc_rcv(struct net *net, struct sk_buff *skb, struct tipc_bearer *b)
 		tipc_node_link_down(n, bearer_id, false);
 
 	if (unlikely(!skb_queue_empty(&n->bc_entry.namedq)))
-		tipc_named_rcv(net, &n->bc_entry.namedq,
-			       &n->bc_entry.named_rcv_nxt,
-			       &n->bc_entry.named_open);
+		tipc_named_rcv(net, &n->bc_entry.namedq, &n->bc_entry.named);
 
 	if (unlikely(!skb_queue_empty(&n->bc_entry.inputq1)))
 		tipc_node_mcast_rcv(n);
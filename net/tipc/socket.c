@@ -2902,25 +2902,29 @@ static int tipc_sk_withdraw(struct tipc_sock *tsk, uint scope,
 	if (scope != TIPC_NODE_SCOPE)
 		scope = TIPC_CLUSTER_SCOPE;
 
-	list_for_each_entry_safe(publ, safe, &tsk->publications, binding_sock) {
-		if (seq) {
-			if (publ->scope != scope)
-				continue;
-			if (publ->type != seq->type)
-				continue;
-			if (publ->lower != seq->lower)
-				continue;
-			if (publ->upper != seq->upper)
-				break;
-			tipc_nametbl_withdraw(net, publ->type, publ->lower,
-					      publ->upper, publ->key);
+	/* Withdraw all bindings in bulk */
+	if (!seq) {
+		if (!list_empty(&tsk->publications))
 			rc = 0;
+		tipc_nametbl_withdraw_all(net, &tsk->publications);
+		goto exit;
+	}
+
+	list_for_each_entry_safe(publ, safe, &tsk->publications, binding_sock) {
+		if (publ->scope != scope)
+			continue;
+		if (publ->type != seq->type)
+			continue;
+		if (publ->lower != seq->lower)
+			continue;
+		if (publ->upper != seq->upper)
 			break;
-		}
 		tipc_nametbl_withdraw(net, publ->type, publ->lower,
 				      publ->upper, publ->key);
 		rc = 0;
+		break;
 	}
+exit:
 	if (list_empty(&tsk->publications))
 		tsk->published = 0;
 	return rc;
@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-2.0 OR Linux-OpenIB */
+#ifndef _TLS_INT_H
+#define _TLS_INT_H
+
+/* Declarations shared by the files of the TLS ULP only */
+
+/* Per socket options of the software path, kept in tls_context->flags
+ * above the bits of enum tls_context_flags.
+ */
+#define TLS_SW_TX_PARALLEL	16	/* TLS_TX_PARALLEL */
+#define TLS_SW_RX_EXPECT_NO_PAD	17	/* TLS_RX_EXPECT_NO_PAD */
+
+#endif /* _TLS_INT_H */
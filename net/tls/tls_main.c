@@ -45,6 +45,8 @@
 #include <net/tls.h>
 #include <net/tls_toe.h>
 
+#include "tls.h"
+
 MODULE_AUTHOR("Mellanox Technologies");
 MODULE_DESCRIPTION("Transport Layer Security Support");
 MODULE_LICENSE("Dual BSD/GPL");
@@ -429,6 +431,78 @@ static int do_tls_getsockopt_conf(struct sock *sk, char __user *optval,
 	return rc;
 }
 
+static int do_tls_getsockopt_tx_inflight(struct sock *sk, char __user *optval,
+					 int __user *optlen)
+{
+	struct tls_context *ctx = tls_get_ctx(sk);
+	struct tls_tx_inflight info = {};
+	struct tls_sw_context_tx *sw_ctx;
+	struct tls_rec *rec;
+	int len;
+
+	if (get_user(len, optlen))
+		return -EFAULT;
+
+	if (!optval || len < sizeof(info))
+		return -EINVAL;
+
+	lock_sock(sk);
+	if (!ctx || ctx->tx_conf != TLS_SW) {
+		release_sock(sk);
+		return -EINVAL;
+	}
+
+	sw_ctx = tls_sw_ctx_tx(ctx);
+	list_for_each_entry(rec, &sw_ctx->tx_list, list)
+		info.records++;
+	info.encrypting = atomic_read(&sw_ctx->encrypt_pending);
+	release_sock(sk);
+
+	if (put_user(sizeof(info), optlen) ||
+	    copy_to_user(optval, &info, sizeof(info)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/* Boolean per socket option kept as bit 'nr' of tls_context->flags */
+static int do_tls_getsockopt_flag(struct sock *sk, int nr,
+				  char __user *optval, int __user *optlen)
+{
+	struct tls_context *ctx = tls_get_ctx(sk);
+	int len, val;
+
+	if (get_user(len, optlen))
+		return -EFAULT;
+
+	if (!optval || len < sizeof(val))
+		return -EINVAL;
+
+	val = test_bit(nr, &ctx->flags);
+
+	if (put_user(sizeof(val), optlen) ||
+	    copy_to_user(optval, &val, sizeof(val)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/* Only the software path encrypts the records itself */
+static int do_tls_getsockopt_tx_parallel(struct sock *sk, char __user *optval,
+					 int __user *optlen)
+{
+	struct tls_context *ctx = tls_get_ctx(sk);
+	bool sw;
+
+	lock_sock(sk);
+	sw = ctx->tx_conf == TLS_SW;
+	release_sock(sk);
+	if (!sw)
+		return -EINVAL;
+
+	return do_tls_getsockopt_flag(sk, TLS_SW_TX_PARALLEL, optval, optlen);
+}
+
 static int do_tls_getsockopt(struct sock *sk, int optname,
 			     char __user *optval, int __user *optlen)
 {
@@ -440,6 +514,16 @@ static int do_tls_getsockopt(struct sock *sk, int optname,
 		rc = do_tls_getsockopt_conf(sk, optval, optlen,
 					    optname == TLS_TX);
 		break;
+	case TLS_TX_INFLIGHT:
+		rc = do_tls_getsockopt_tx_inflight(sk, optval, optlen);
+		break;
+	case TLS_TX_PARALLEL:
+		rc = do_tls_getsockopt_tx_parallel(sk, optval, optlen);
+		break;
+	case TLS_RX_EXPECT_NO_PAD:
+		rc = do_tls_getsockopt_flag(sk, TLS_SW_RX_EXPECT_NO_PAD, optval,
+					    optlen);
+		break;
 	default:
 		rc = -ENOPROTOOPT;
 		break;
@@ -589,6 +673,29 @@ static int do_tls_setsockopt_conf(struct sock *sk, sockptr_t optval,
 	return rc;
 }
 
+static int do_tls_setsockopt_flag(struct sock *sk, int nr, sockptr_t optval,
+				  unsigned int optlen)
+{
+	struct tls_context *ctx = tls_get_ctx(sk);
+	int val;
+
+	if (sockptr_is_null(optval) || optlen < sizeof(val))
+		return -EINVAL;
+
+	if (copy_from_sockptr(&val, optval, sizeof(val)))
+		return -EFAULT;
+
+	if (val != 0 && val != 1)
+		return -EINVAL;
+
+	if (val)
+		set_bit(nr, &ctx->flags);
+	else
+		clear_bit(nr, &ctx->flags);
+
+	return 0;
+}
+
 static int do_tls_setsockopt(struct sock *sk, int optname, sockptr_t optval,
 			     unsigned int optlen)
 {
@@ -602,6 +709,21 @@ static int do_tls_setsockopt(struct sock *sk, int optname, sockptr_t optval,
 					    optname == TLS_TX);
 		release_sock(sk);
 		break;
+	case TLS_TX_PARALLEL:
+		lock_sock(sk);
+		if (tls_get_ctx(sk)->tx_conf != TLS_SW)
+			rc = -EINVAL;
+		else
+			rc = do_tls_setsockopt_flag(sk, TLS_SW_TX_PARALLEL,
+						    optval, optlen);
+		release_sock(sk);
+		break;
+	case TLS_RX_EXPECT_NO_PAD:
+		lock_sock(sk);
+		rc = do_tls_setsockopt_flag(sk, TLS_SW_RX_EXPECT_NO_PAD, optval,
+					    optlen);
+		release_sock(sk);
+		break;
 	default:
 		rc = -ENOPROTOOPT;
 		break;
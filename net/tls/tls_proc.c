@@ -18,6 +18,9 @@ static const struct snmp_mib tls_mib_list[] = {
 	SNMP_MIB_ITEM("TlsRxDevice", LINUX_MIB_TLSRXDEVICE),
 	SNMP_MIB_ITEM("TlsDecryptError", LINUX_MIB_TLSDECRYPTERROR),
 	SNMP_MIB_ITEM("TlsRxDeviceResync", LINUX_MIB_TLSRXDEVICERESYNC),
+	SNMP_MIB_ITEM("TlsRxZeroCopy", LINUX_MIB_TLSRXZEROCOPY),
+	SNMP_MIB_ITEM("TlsRxCopy", LINUX_MIB_TLSRXCOPY),
+	SNMP_MIB_ITEM("TlsRxRedecrypt", LINUX_MIB_TLSRXREDECRYPT),
 	SNMP_MIB_SENTINEL
 };
 
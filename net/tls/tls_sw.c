@@ -42,6 +42,8 @@
 #include <net/strparser.h>
 #include <net/tls.h>
 
+#include "tls.h"
+
 static int __skb_nsg(struct sk_buff *skb, int offset, int len,
                      unsigned int recursion_level)
 {
@@ -313,6 +315,21 @@ static int tls_clone_plaintext_msg(struct sock *sk, int required)
 	return sk_msg_clone(sk, msg_pl, msg_en, skip, len);
 }
 
+/* Encryption of a record on a worker, see tls_encrypt_queue().  It is
+ * allocated with the record, behind the crypto request context.
+ */
+struct tls_encrypt_work {
+	struct work_struct work;
+	struct aead_request *aead_req;
+};
+
+static unsigned int tls_rec_work_offset(struct tls_sw_context_tx *ctx)
+{
+	return ALIGN(sizeof(struct tls_rec) +
+		     crypto_aead_reqsize(ctx->aead_send),
+		     __alignof__(struct tls_encrypt_work));
+}
+
 static struct tls_rec *tls_get_rec(struct sock *sk)
 {
 	struct tls_context *tls_ctx = tls_get_ctx(sk);
@@ -322,7 +339,7 @@ static struct tls_rec *tls_get_rec(struct sock *sk)
 	struct tls_rec *rec;
 	int mem_size;
 
-	mem_size = sizeof(struct tls_rec) + crypto_aead_reqsize(ctx->aead_send);
+	mem_size = tls_rec_work_offset(ctx) + sizeof(struct tls_encrypt_work);
 
 	rec = kzalloc(mem_size, sk->sk_allocation);
 	if (!rec)
@@ -436,6 +453,12 @@ static void tls_encrypt_done(struct crypto_async_request *req, int err)
 	bool ready = false;
 	int pending;
 
+	/* A backlogged request is first completed with -EINPROGRESS once
+	 * it leaves the backlog; the final completion follows.
+	 */
+	if (err == -EINPROGRESS)
+		return;
+
 	rec = container_of(aead_req, struct tls_rec, aead_req);
 	msg_en = &rec->msg_encrypted;
 
@@ -479,9 +502,48 @@ static void tls_encrypt_done(struct crypto_async_request *req, int err)
 	if (!ready)
 		return;
 
-	/* Schedule the transmission */
+	/* Schedule the transmission. A crypto engine completes records in
+	 * batches, give the next ones a jiffy to join. Records encrypted in
+	 * parallel are pushed right away, the waiting would only add
+	 * latency to each send.
+	 */
 	if (!test_and_set_bit(BIT_TX_SCHEDULED, &ctx->tx_bitmask))
-		schedule_delayed_work(&ctx->tx_work.work, 1);
+		schedule_delayed_work(&ctx->tx_work.work,
+				      test_bit(TLS_SW_TX_PARALLEL,
+					       &tls_ctx->flags) ? 0 : 1);
+}
+
+static void tls_encrypt_work_handler(struct work_struct *work)
+{
+	struct tls_encrypt_work *ew = container_of(work, struct tls_encrypt_work,
+						   work);
+	struct aead_request *aead_req = ew->aead_req;
+	int rc;
+
+	rc = crypto_aead_encrypt(aead_req);
+	if (rc == -EINPROGRESS || rc == -EBUSY)
+		return;
+
+	/* The record, and with it 'ew', may be freed and the socket may go
+	 * away as soon as the completion is signalled.
+	 */
+	tls_encrypt_done(&aead_req->base, rc);
+}
+
+/* Hand the encryption of a record to an unbound worker, so that the
+ * records of one large send are encrypted on several CPUs at once.  The
+ * records stay on tx_list in sequence order and are transmitted from its
+ * head as they become ready, exactly as with an asynchronous crypto
+ * engine.
+ */
+static void tls_encrypt_queue(struct tls_sw_context_tx *ctx,
+			      struct tls_rec *rec)
+{
+	struct tls_encrypt_work *ew = (void *)rec + tls_rec_work_offset(ctx);
+
+	INIT_WORK(&ew->work, tls_encrypt_work_handler);
+	ew->aead_req = &rec->aead_req;
+	queue_work(system_unbound_wq, &ew->work);
 }
 
 static int tls_do_encryption(struct sock *sk,
@@ -525,7 +587,12 @@ static int tls_do_encryption(struct sock *sk,
 	list_add_tail((struct list_head *)&rec->list, &ctx->tx_list);
 	atomic_inc(&ctx->encrypt_pending);
 
-	rc = crypto_aead_encrypt(aead_req);
+	if (test_bit(TLS_SW_TX_PARALLEL, &tls_ctx->flags)) {
+		tls_encrypt_queue(ctx, rec);
+		rc = -EINPROGRESS;
+	} else {
+		rc = crypto_aead_encrypt(aead_req);
+	}
 	if (!rc || rc != -EINPROGRESS) {
 		atomic_dec(&ctx->encrypt_pending);
 		sge->offset -= prot->prepend_size;
@@ -761,17 +828,20 @@ static int tls_push_record(struct sock *sk, int flags,
 
 	rc = tls_do_encryption(sk, tls_ctx, ctx, req,
 			       msg_pl->sg.size + prot->tail_size, i);
-	if (rc < 0) {
-		if (rc != -EINPROGRESS) {
-			tls_err_abort(sk, EBADMSG);
-			if (split) {
-				tls_ctx->pending_open_record_frags = true;
-				tls_merge_open_record(sk, rec, tmp, orig_end);
-			}
+	if (rc < 0 && rc != -EINPROGRESS) {
+		tls_err_abort(sk, EBADMSG);
+		if (split) {
+			tls_ctx->pending_open_record_frags = true;
+			tls_merge_open_record(sk, rec, tmp, orig_end);
 		}
 		ctx->async_capable = 1;
 		return rc;
-	} else if (split) {
+	}
+
+	/* The remainder of a split record becomes the new open record,
+	 * also when the first part is still being encrypted.
+	 */
+	if (split) {
 		msg_pl = &tmp->msg_plaintext;
 		msg_en = &tmp->msg_encrypted;
 		sk_msg_trim(sk, msg_en, msg_pl->sg.size + prot->overhead_size);
@@ -779,6 +849,11 @@ static int tls_push_record(struct sock *sk, int flags,
 		ctx->open_rec = tmp;
 	}
 
+	if (rc == -EINPROGRESS) {
+		ctx->async_capable = 1;
+		return rc;
+	}
+
 	return tls_tx_records(sk, flags);
 }
 
@@ -1409,16 +1484,24 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	int n_sgin, n_sgout, nsg, mem_size, aead_size, err, pages = 0;
 	struct aead_request *aead_req;
 	struct sk_buff *unused;
-	u8 *aad, *iv, *mem = NULL;
+	u8 *aad, *iv, *tail, *mem = NULL;
 	struct scatterlist *sgin = NULL;
 	struct scatterlist *sgout = NULL;
 	const int data_len = rxm->full_len - prot->overhead_size +
 			     prot->tail_size;
 	int iv_offset = 0;
+	bool split_tail;
+
+	/* When decrypting a TLS 1.3 record into the user buffer, the inner
+	 * content type goes to a kernel buffer so that it can be checked
+	 * before the record is handed out as data.
+	 */
+	split_tail = *zc && out_iov && prot->tail_size;
 
 	if (*zc && (out_iov || out_sg)) {
 		if (out_iov)
-			n_sgout = iov_iter_npages(out_iov, INT_MAX) + 1;
+			n_sgout = iov_iter_npages(out_iov, INT_MAX) + 1 +
+				  split_tail;
 		else
 			n_sgout = sg_nents(out_sg);
 		n_sgin = skb_nsg(skb, rxm->offset + prot->prepend_size,
@@ -1441,9 +1524,10 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	mem_size = aead_size + (nsg * sizeof(struct scatterlist));
 	mem_size = mem_size + prot->aad_size;
 	mem_size = mem_size + crypto_aead_ivsize(ctx->aead_recv);
+	mem_size = mem_size + prot->tail_size;
 
 	/* Allocate a single block of memory which contains
-	 * aead_req || sgin[] || sgout[] || aad || iv.
+	 * aead_req || sgin[] || sgout[] || aad || iv || tail.
 	 * This order achieves correct alignment for aead_req, sgin, sgout.
 	 */
 	mem = kmalloc(mem_size, sk->sk_allocation);
@@ -1456,6 +1540,7 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	sgout = sgin + n_sgin;
 	aad = (u8 *)(sgout + n_sgout);
 	iv = aad + prot->aad_size;
+	tail = iv + crypto_aead_ivsize(ctx->aead_recv);
 
 	/* For CCM based ciphers, first byte of nonce+iv is always '2' */
 	if (prot->cipher_type == TLS_CIPHER_AES_CCM_128) {
@@ -1502,11 +1587,19 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 			sg_set_buf(&sgout[0], aad, prot->aad_size);
 
 			*chunk = 0;
-			err = tls_setup_from_iter(sk, out_iov, data_len,
+			err = tls_setup_from_iter(sk, out_iov,
+						  data_len - prot->tail_size,
 						  &pages, chunk, &sgout[1],
-						  (n_sgout - 1));
+						  (n_sgout - 1 - split_tail));
 			if (err < 0)
 				goto fallback_to_reg_recv;
+
+			if (split_tail) {
+				sg_unmark_end(&sgout[pages]);
+				sg_set_buf(&sgout[pages + 1], tail,
+					   prot->tail_size);
+				sg_mark_end(&sgout[pages + 1]);
+			}
 		} else if (out_sg) {
 			memcpy(sgout, out_sg, n_sgout * sizeof(*sgout));
 		} else {
@@ -1530,6 +1623,24 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	for (; pages > 0; pages--)
 		put_page(sg_page(&sgout[pages]));
 
+	/* A record that is not plain unpadded data has to go through the
+	 * regular path.  The ciphertext is still intact in the skb, so
+	 * take back what was written to the user buffer and decrypt again
+	 * in place.
+	 */
+	if (!err && *zc && split_tail) {
+		if (*tail == TLS_RECORD_TYPE_DATA) {
+			ctx->control = *tail;
+		} else {
+			kfree(mem);
+			iov_iter_revert(out_iov, *chunk);
+			TLS_INC_STATS(sock_net(sk), LINUX_MIB_TLSRXREDECRYPT);
+			*zc = false;
+			return decrypt_internal(sk, skb, NULL, NULL, chunk, zc,
+						async);
+		}
+	}
+
 	kfree(mem);
 	return err;
 }
@@ -1556,10 +1667,13 @@ static int decrypt_skb_update(struct sock *sk, struct sk_buff *skb,
 			err = decrypt_internal(sk, skb, dest, NULL, chunk, zc,
 					       async);
 			if (err < 0) {
-				if (err == -EINPROGRESS)
+				if (err == -EINPROGRESS) {
+					TLS_INC_STATS(sock_net(sk), *zc ?
+						      LINUX_MIB_TLSRXZEROCOPY :
+						      LINUX_MIB_TLSRXCOPY);
 					tls_advance_record_sn(sk, prot,
 							      &tls_ctx->rx);
-				else if (err == -EBADMSG)
+				} else if (err == -EBADMSG)
 					TLS_INC_STATS(sock_net(sk),
 						      LINUX_MIB_TLSDECRYPTERROR);
 				return err;
@@ -1568,10 +1682,19 @@ static int decrypt_skb_update(struct sock *sk, struct sk_buff *skb,
 			*zc = false;
 		}
 
-		pad = padding_length(ctx, prot, skb);
+		/* A TLS 1.3 record decrypted into the user buffer had its
+		 * content type checked already and carries no padding.
+		 */
+		if (*zc && prot->tail_size)
+			pad = 0;
+		else
+			pad = padding_length(ctx, prot, skb);
 		if (pad < 0)
 			return pad;
 
+		TLS_INC_STATS(sock_net(sk), *zc ? LINUX_MIB_TLSRXZEROCOPY :
+						  LINUX_MIB_TLSRXCOPY);
+
 		rxm->full_len -= pad;
 		rxm->offset += prot->prepend_size;
 		rxm->full_len -= prot->overhead_size;
@@ -1812,9 +1935,15 @@ int tls_sw_recvmsg(struct sock *sk,
 
 		to_decrypt = rxm->full_len - prot->overhead_size;
 
+		/* TLS 1.3 records only go to the user buffer when the
+		 * application asked for it with TLS_RX_EXPECT_NO_PAD, as a
+		 * control or padded record is written there before it is
+		 * decrypted again.
+		 */
 		if (to_decrypt <= len && !is_kvec && !is_peek &&
 		    ctx->control == TLS_RECORD_TYPE_DATA &&
-		    prot->version != TLS_1_3_VERSION &&
+		    (prot->version != TLS_1_3_VERSION ||
+		     test_bit(TLS_SW_RX_EXPECT_NO_PAD, &tls_ctx->flags)) &&
 		    !bpf_strp_enabled)
 			zc = true;
 
@@ -494,6 +494,8 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge(&sk->sk_receive_queue);
+	/* Zero-copy completions nobody read */
+	skb_queue_purge(&sk->sk_error_queue);
 
 	WARN_ON(refcount_read(&sk->sk_wmem_alloc));
 	WARN_ON(!sk_unhashed(sk));
@@ -690,6 +692,8 @@ static void unix_show_fdinfo(struct seq_file *m, struct socket *sock)
 		u = unix_sk(sock->sk);
 		seq_printf(m, "scm_fds: %u\n",
 			   atomic_read(&u->scm_stat.nr_fds));
+		if (sock_flag(sk, SOCK_ZEROCOPY))
+			seq_puts(m, "zerocopy: 1\n");
 	}
 }
 #else
@@ -1819,6 +1823,87 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
  */
 #define UNIX_SKB_FRAGS_SZ (PAGE_SIZE << get_order(32768))
 
+/* Zero-copy sends below this size are copied anyway: pinning pages
+ * costs more than copying a few of them.
+ */
+#define UNIX_ZEROCOPY_MIN	(16 * PAGE_SIZE)
+#define UNIX_ZEROCOPY_MAX	((MAX_SKB_FRAGS - 1) * PAGE_SIZE)
+
+static atomic_long_t unix_zerocopy_bytes;
+static atomic_long_t unix_zerocopy_skbs;
+static atomic_long_t unix_zerocopy_copied;
+
+/* A MSG_ZEROCOPY send on a socket with zero-copy enabled gets a
+ * completion on the error queue, as with MSG_ZEROCOPY on TCP.  It carries
+ * SO_EE_CODE_ZEROCOPY_COPIED when the send took the copy path, in which
+ * case it is queued before sendmsg() returns.
+ */
+static int unix_zerocopy_prepare(struct sock *sk, struct msghdr *msg,
+				 size_t len, struct ubuf_info **uargp)
+{
+	struct ubuf_info *uarg;
+
+	/* Without SOCK_ZEROCOPY the flag is ignored, as it always was */
+	if (!(msg->msg_flags & MSG_ZEROCOPY) || !len ||
+	    !sock_flag(sk, SOCK_ZEROCOPY))
+		return 0;
+
+	uarg = sock_zerocopy_alloc(sk, len);
+	if (!uarg)
+		return -ENOBUFS;
+
+	if (len < UNIX_ZEROCOPY_MIN || !iter_is_iovec(&msg->msg_iter)) {
+		atomic_long_add(len, &unix_zerocopy_copied);
+		uarg->zerocopy = 0;
+	}
+	*uargp = uarg;
+	return 0;
+}
+
+/* Attach up to size bytes of the sender's pages to skb's frags. This is
+ * zerocopy_sg_from_iter() except that the pages are charged to
+ * sk_wmem_alloc, which sock_wfree() releases, rather than to the TCP
+ * style sk_wmem_queued that a SOCK_STREAM owner would get there.
+ * Running out of frags early is fine, the caller sends what made it in.
+ */
+static int unix_zerocopy_from_iter(struct sk_buff *skb, struct iov_iter *from,
+				   size_t size)
+{
+	int frag = skb_shinfo(skb)->nr_frags;
+
+	while (size && iov_iter_count(from) && frag < MAX_SKB_FRAGS) {
+		struct page *pages[MAX_SKB_FRAGS];
+		unsigned long truesize;
+		ssize_t copied;
+		size_t start;
+		int n = 0;
+
+		copied = iov_iter_get_pages(from, pages, size,
+					    MAX_SKB_FRAGS - frag, &start);
+		if (copied < 0)
+			return skb->len ? 0 : -EFAULT;
+
+		iov_iter_advance(from, copied);
+		size -= copied;
+
+		truesize = PAGE_ALIGN(copied + start);
+		skb->data_len += copied;
+		skb->len += copied;
+		skb->truesize += truesize;
+		refcount_add(truesize, &skb->sk->sk_wmem_alloc);
+
+		while (copied) {
+			int len = min_t(int, copied, PAGE_SIZE - start);
+
+			skb_fill_page_desc(skb, frag++, pages[n], start, len);
+			start = 0;
+			copied -= len;
+			n++;
+		}
+	}
+	return 0;
+}
+
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			       size_t len)
 {
@@ -1830,6 +1915,8 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	struct scm_cookie scm;
 	bool fds_sent = false;
 	int data_len;
+	struct ubuf_info *uarg = NULL;
+	bool zc;
 
 	wait_for_unix_gc();
 	err = scm_send(sock, msg, &scm, false);
@@ -1853,20 +1940,32 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (sk->sk_shutdown & SEND_SHUTDOWN)
 		goto pipe_err;
 
+	err = unix_zerocopy_prepare(sk, msg, len, &uarg);
+	if (err)
+		goto out_err;
+	zc = uarg && uarg->zerocopy;
+
 	while (sent < len) {
 		size = len - sent;
 
 		/* Keep two messages in the pipe so it schedules better */
 		size = min_t(int, size, (sk->sk_sndbuf >> 1) - 64);
 
-		/* allow fallback to order-0 allocations */
-		size = min_t(int, size, SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ);
+		if (zc) {
+			size = min_t(int, size, UNIX_ZEROCOPY_MAX);
+			data_len = 0;
+		} else {
+			/* allow fallback to order-0 allocations */
+			size = min_t(int, size,
+				     SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ);
 
-		data_len = max_t(int, 0, size - SKB_MAX_HEAD(0));
+			data_len = max_t(int, 0, size - SKB_MAX_HEAD(0));
 
-		data_len = min_t(size_t, size, PAGE_ALIGN(data_len));
+			data_len = min_t(size_t, size, PAGE_ALIGN(data_len));
+		}
 
-		skb = sock_alloc_send_pskb(sk, size - data_len, data_len,
+		skb = sock_alloc_send_pskb(sk, zc ? 0 : size - data_len,
+					   data_len,
 					   msg->msg_flags & MSG_DONTWAIT, &err,
 					   get_order(UNIX_SKB_FRAGS_SZ));
 		if (!skb)
@@ -1880,10 +1979,21 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 		}
 		fds_sent = true;
 
-		skb_put(skb, size - data_len);
-		skb->data_len = data_len;
-		skb->len = size;
-		err = skb_copy_datagram_from_iter(skb, 0, &msg->msg_iter, size);
+		if (zc) {
+			err = unix_zerocopy_from_iter(skb, &msg->msg_iter,
+						      size);
+			size = skb->len;
+			/* The completion fires when the peer frees the skb */
+			if (!err)
+				skb_zcopy_set(skb, uarg, NULL);
+		} else {
+			skb_put(skb, size - data_len);
+			skb->data_len = data_len;
+			skb->len = size;
+			err = skb_copy_datagram_from_iter(skb, 0,
+							  &msg->msg_iter,
+							  size);
+		}
 		if (err) {
 			kfree_skb(skb);
 			goto out_err;
@@ -1901,8 +2011,14 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 		unix_state_unlock(other);
 		other->sk_data_ready(other);
 		sent += size;
+
+		if (zc) {
+			atomic_long_add(size, &unix_zerocopy_bytes);
+			atomic_long_inc(&unix_zerocopy_skbs);
+		}
 	}
 
+	sock_zerocopy_put(uarg);
 	scm_destroy(&scm);
 
 	return sent;
@@ -1915,6 +2031,11 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 		send_sig(SIGPIPE, current, 0);
 	err = -EPIPE;
 out_err:
+	/* Without data on the way the completion id is given back */
+	if (sent)
+		sock_zerocopy_put(uarg);
+	else
+		sock_zerocopy_put_abort(uarg, true);
 	scm_destroy(&scm);
 	return sent ? : err;
 }
@@ -2462,6 +2583,11 @@ static int unix_stream_recvmsg(struct socket *sock, struct msghdr *msg,
 		.flags = flags
 	};
 
+	/* Zero-copy completions use the same cmsg as on inet sockets */
+	if (flags & MSG_ERRQUEUE)
+		return sock_recv_errqueue(sock->sk, msg, size, SOL_IP,
+					  IP_RECVERR);
+
 	return unix_stream_read_generic(&state, true);
 }
 
@@ -2469,6 +2595,16 @@ static int unix_stream_splice_actor(struct sk_buff *skb,
 				    int skip, int chunk,
 				    struct unix_stream_read_state *state)
 {
+	int err;
+
+	/* The pipe would keep referencing the sender's pages after the
+	 * skb is consumed and its zero-copy completion has been reported,
+	 * so hand it private copies instead.
+	 */
+	err = skb_orphan_frags_rx(skb, GFP_KERNEL);
+	if (err)
+		return err;
+
 	return skb_splice_bits(skb, state->socket->sk,
 			       UNIXCB(skb).consumed + skip,
 			       state->pipe, chunk, state->splice_flags);
@@ -2608,6 +2744,23 @@ static int unix_open_file(struct sock *sk)
 	return fd;
 }
 
+static int unix_set_zerocopy(struct sock *sk, int __user *arg)
+{
+	int val;
+
+	if (sk->sk_type != SOCK_STREAM)
+		return -EOPNOTSUPP;
+	if (get_user(val, arg))
+		return -EFAULT;
+	if (val != 0 && val != 1)
+		return -EINVAL;
+
+	lock_sock(sk);
+	sock_valbool_flag(sk, SOCK_ZEROCOPY, val);
+	release_sock(sk);
+	return 0;
+}
+
 static int unix_ioctl(struct socket *sock, unsigned int cmd, unsigned long arg)
 {
 	struct sock *sk = sock->sk;
@@ -2629,6 +2782,9 @@ static int unix_ioctl(struct socket *sock, unsigned int cmd, unsigned long arg)
 	case SIOCUNIXFILE:
 		err = unix_open_file(sk);
 		break;
+	case SIOCUNIXZEROCOPY:
+		err = unix_set_zerocopy(sk, (int __user *)arg);
+		break;
 	default:
 		err = -ENOIOCTLCMD;
 		break;
@@ -2652,7 +2808,7 @@ static __poll_t unix_poll(struct file *file, struct socket *sock, poll_table *wa
 	mask = 0;
 
 	/* exceptional events? */
-	if (sk->sk_err)
+	if (sk->sk_err || !skb_queue_empty_lockless(&sk->sk_error_queue))
 		mask |= EPOLLERR;
 	if (sk->sk_shutdown == SHUTDOWN_MASK)
 		mask |= EPOLLHUP;
@@ -2865,6 +3021,15 @@ static const struct seq_operations unix_seq_ops = {
 	.stop   = unix_seq_stop,
 	.show   = unix_seq_show,
 };
+
+static int unix_zerocopy_seq_show(struct seq_file *seq, void *v)
+{
+	seq_printf(seq, "bytes %ld\n", atomic_long_read(&unix_zerocopy_bytes));
+	seq_printf(seq, "skbs %ld\n", atomic_long_read(&unix_zerocopy_skbs));
+	seq_printf(seq, "copied %ld\n",
+		   atomic_long_read(&unix_zerocopy_copied));
+	return 0;
+}
 #endif
 
 static const struct net_proto_family unix_family_ops = {
@@ -2888,6 +3053,24 @@ static int __net_init unix_net_init(struct net *net)
 		unix_sysctl_unregister(net);
 		goto out;
 	}
+
+	/* The collector is global, report on it from the initial netns */
+	if (net_eq(net, &init_net) &&
+	    !proc_create_single("unix_gc", 0444, net->proc_net,
+				unix_gc_seq_show)) {
+		remove_proc_entry("unix", net->proc_net);
+		unix_sysctl_unregister(net);
+		goto out;
+	}
+
+	if (net_eq(net, &init_net) &&
+	    !proc_create_single("unix_zerocopy", 0444, net->proc_net,
+				unix_zerocopy_seq_show)) {
+		remove_proc_entry("unix_gc", net->proc_net);
+		remove_proc_entry("unix", net->proc_net);
+		unix_sysctl_unregister(net);
+		goto out;
+	}
 #endif
 	error = 0;
 out:
@@ -2897,6 +3080,10 @@ static int __net_init unix_net_init(struct net *net)
 static void __net_exit unix_net_exit(struct net *net)
 {
 	unix_sysctl_unregister(net);
+	if (net_eq(net, &init_net)) {
+		remove_proc_entry("unix_zerocopy", net->proc_net);
+		remove_proc_entry("unix_gc", net->proc_net);
+	}
 	remove_proc_entry("unix", net->proc_net);
 }
 
@@ -2928,6 +3115,8 @@ static void __exit af_unix_exit(void)
 	sock_unregister(PF_UNIX);
 	proto_unregister(&unix_proto);
 	unregister_pernet_subsys(&unix_net_ops);
+	/* The last release may still have a collection queued */
+	unix_gc_flush();
 }
 
 /* Earlier than device_initcall() so that other drivers invoking
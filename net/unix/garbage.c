@@ -75,6 +75,11 @@
 #include <linux/proc_fs.h>
 #include <linux/mutex.h>
 #include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/cred.h>
+#include <linux/sched/user.h>
 
 #include <net/sock.h>
 #include <net/af_unix.h>
@@ -86,7 +91,20 @@
 /* Internal data structures and random procedures: */
 
 static LIST_HEAD(gc_candidates);
-static DECLARE_WAIT_QUEUE_HEAD(unix_gc_wait);
+
+/* Written by the GC worker only, which never runs concurrently with
+ * itself; read locklessly by unix_gc_seq_show().
+ */
+static struct {
+	u64	runs;
+	u64	total_ns;
+	u64	last_ns;
+	u64	max_ns;
+	u64	collected;
+} unix_gc_stats;
+
+/* Senders that had to wait for a running collection */
+static atomic_long_t unix_gc_throttled;
 
 static void scan_inflight(struct sock *x, void (*func)(struct unix_sock *),
 			  struct sk_buff_head *hitlist)
@@ -186,34 +204,20 @@ static void inc_inflight_move_tail(struct unix_sock *u)
 }
 
 static bool gc_in_progress;
-#define UNIX_INFLIGHT_TRIGGER_GC 16000
-
-void wait_for_unix_gc(void)
-{
-	/* If number of inflight sockets is insane,
-	 * force a garbage collect right now.
-	 */
-	if (unix_tot_inflight > UNIX_INFLIGHT_TRIGGER_GC && !gc_in_progress)
-		unix_gc();
-	wait_event(unix_gc_wait, gc_in_progress == false);
-}
 
-/* The external entry point: unix_gc() */
-void unix_gc(void)
+static void __unix_gc(struct work_struct *work)
 {
 	struct unix_sock *u;
 	struct unix_sock *next;
 	struct sk_buff_head hitlist;
 	struct list_head cursor;
 	LIST_HEAD(not_cycle_list);
+	u64 start, collected = 0;
 
-	spin_lock(&unix_gc_lock);
+	start = ktime_get_ns();
 
-	/* Avoid a recursive GC. */
-	if (gc_in_progress)
-		goto out;
+	spin_lock(&unix_gc_lock);
 
-	gc_in_progress = true;
 	/* First, select candidates for garbage collection.  Only
 	 * in-flight sockets are considered, and from those only ones
 	 * which don't have any external reference.
@@ -278,8 +282,10 @@ void unix_gc(void)
 	 * which are creating the cycle(s).
 	 */
 	skb_queue_head_init(&hitlist);
-	list_for_each_entry(u, &gc_candidates, link)
+	list_for_each_entry(u, &gc_candidates, link) {
 		scan_children(&u->sk, inc_inflight, &hitlist);
+		collected++;
+	}
 
 	/* not_cycle_list contains those sockets which do not make up a
 	 * cycle.  Restore these to the inflight list.
@@ -299,9 +305,83 @@ void unix_gc(void)
 
 	/* All candidates should have been detached by now. */
 	BUG_ON(!list_empty(&gc_candidates));
-	gc_in_progress = false;
-	wake_up(&unix_gc_wait);
 
- out:
+	/* Paired with READ_ONCE() in wait_for_unix_gc(). */
+	WRITE_ONCE(gc_in_progress, false);
+
 	spin_unlock(&unix_gc_lock);
+
+	start = ktime_get_ns() - start;
+	WRITE_ONCE(unix_gc_stats.runs, unix_gc_stats.runs + 1);
+	WRITE_ONCE(unix_gc_stats.total_ns, unix_gc_stats.total_ns + start);
+	WRITE_ONCE(unix_gc_stats.last_ns, start);
+	if (start > unix_gc_stats.max_ns)
+		WRITE_ONCE(unix_gc_stats.max_ns, start);
+	WRITE_ONCE(unix_gc_stats.collected,
+		   unix_gc_stats.collected + collected);
+}
+
+static DECLARE_WORK(unix_gc_work, __unix_gc);
+
+/* The external entry point: unix_gc()
+ *
+ * The collection itself runs from a work item, which is never run
+ * concurrently with itself, so nobody who triggers it has to wait for
+ * the scan.
+ */
+void unix_gc(void)
+{
+	WRITE_ONCE(gc_in_progress, true);
+	queue_work(system_unbound_wq, &unix_gc_work);
+}
+
+#define UNIX_INFLIGHT_TRIGGER_GC 16000
+#define UNIX_INFLIGHT_SANE_USER (SCM_MAX_FD * 8)
+
+void wait_for_unix_gc(void)
+{
+	struct user_struct *user = current_user();
+
+	/* If number of inflight sockets is insane,
+	 * force a garbage collect right now.
+	 */
+	if (READ_ONCE(unix_tot_inflight) > UNIX_INFLIGHT_TRIGGER_GC &&
+	    !READ_ONCE(gc_in_progress))
+		unix_gc();
+
+	/* Only senders who have a lot of fds in flight themselves wait
+	 * for a running collection; everybody else carries on.
+	 */
+	if (READ_ONCE(user->unix_inflight) < UNIX_INFLIGHT_SANE_USER)
+		return;
+
+	if (READ_ONCE(gc_in_progress)) {
+		atomic_long_inc(&unix_gc_throttled);
+		flush_work(&unix_gc_work);
+	}
+}
+
+/* Called on module unload, once all sockets are gone. */
+void unix_gc_flush(void)
+{
+	flush_work(&unix_gc_work);
+}
+
+#ifdef CONFIG_PROC_FS
+int unix_gc_seq_show(struct seq_file *seq, void *v)
+{
+	seq_printf(seq, "runs %llu\n", READ_ONCE(unix_gc_stats.runs));
+	seq_printf(seq, "total_us %llu\n",
+		   div_u64(READ_ONCE(unix_gc_stats.total_ns), NSEC_PER_USEC));
+	seq_printf(seq, "last_us %llu\n",
+		   div_u64(READ_ONCE(unix_gc_stats.last_ns), NSEC_PER_USEC));
+	seq_printf(seq, "max_us %llu\n",
+		   div_u64(READ_ONCE(unix_gc_stats.max_ns), NSEC_PER_USEC));
+	seq_printf(seq, "collected %llu\n",
+		   READ_ONCE(unix_gc_stats.collected));
+	seq_printf(seq, "throttled %ld\n",
+		   atomic_long_read(&unix_gc_throttled));
+	seq_printf(seq, "inflight %u\n", READ_ONCE(unix_tot_inflight));
+	return 0;
 }
+#endif
@@ -6,5 +6,10 @@ extern spinlock_t unix_gc_lock;
 
 int unix_attach_fds(struct scm_cookie *scm, struct sk_buff *skb);
 void unix_detach_fds(struct scm_cookie *scm, struct sk_buff *skb);
+void unix_gc_flush(void);
+
+#ifdef CONFIG_PROC_FS
+int unix_gc_seq_show(struct seq_file *seq, void *v);
+#endif
 
 #endif
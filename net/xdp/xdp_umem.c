@@ -18,6 +18,7 @@
 
 #include "xdp_umem.h"
 #include "xsk_queue.h"
+#include "xsk.h"
 
 #define XDP_UMEM_MIN_CHUNK_SIZE 2048
 
@@ -57,6 +58,7 @@ static int xdp_umem_addr_map(struct xdp_umem *umem, struct page **pages,
 static void xdp_umem_release(struct xdp_umem *umem)
 {
 	umem->zc = false;
+	xp_fill_share_release(umem);
 	ida_simple_remove(&umem_ida, umem->id);
 
 	xdp_umem_addr_unmap(umem);
@@ -371,15 +371,77 @@ static void xsk_destruct_skb(struct sk_buff *skb)
 	sock_wfree(skb);
 }
 
+/* Hand a burst of skbs to the driver under a single tx lock, setting
+ * xmit_more on all but the last one.  Returns the number of skbs the
+ * stack took ownership of; *ret is the status of the last attempt.
+ */
+static u32 xsk_direct_xmit_burst(struct xdp_sock *xs, struct sk_buff **skbs,
+				 u32 n, int *ret)
+{
+	struct net_device *dev = xs->dev;
+	struct netdev_queue *txq;
+	u32 i;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev))) {
+		atomic_long_inc(&dev->tx_dropped);
+		kfree_skb(skbs[0]);
+		*ret = NET_XMIT_DROP;
+		return 1;
+	}
+
+	txq = netdev_get_tx_queue(dev, xs->queue_id);
+
+	local_bh_disable();
+	dev_xmit_recursion_inc();
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	for (i = 0; i < n; i++) {
+		if (netif_xmit_frozen_or_drv_stopped(txq)) {
+			*ret = NETDEV_TX_BUSY;
+			break;
+		}
+		*ret = netdev_start_xmit(skbs[i], dev, txq, i + 1 < n);
+		if (!dev_xmit_complete(*ret))
+			break;
+	}
+	HARD_TX_UNLOCK(dev, txq);
+	dev_xmit_recursion_dec();
+	local_bh_enable();
+
+	return i;
+}
+
+/* Complete a descriptor that could not be turned into a valid skb
+ * without sending it, as the stack does for a dropped skb.
+ */
+static int xsk_drop_desc(struct xdp_sock *xs, u64 addr)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&xs->pool->cq_lock, flags);
+	if (xskq_prod_reserve(xs->pool->cq)) {
+		spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+		return 0;
+	}
+	xskq_prod_submit_addr(xs->pool->cq, addr);
+	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+
+	xskq_cons_release(xs->tx);
+	atomic_long_inc(&xs->dev->tx_dropped);
+	return -EBUSY;
+}
+
 static int xsk_generic_xmit(struct sock *sk)
 {
 	struct xdp_sock *xs = xdp_sk(sk);
-	u32 max_batch = TX_BATCH_SIZE;
-	bool sent_frame = false;
+	struct sk_buff *skbs[TX_BATCH_SIZE];
+	u32 cons[TX_BATCH_SIZE];
+	bool invalid = false;
+	struct sk_buff *skb, *vskb;
 	struct xdp_desc desc;
-	struct sk_buff *skb;
 	unsigned long flags;
-	int err = 0;
+	int err = 0, ret = 0;
+	u32 n = 0, sent, i;
+	bool again = false;
 	u32 hr, tr;
 
 	mutex_lock(&xs->mutex);
@@ -390,20 +452,25 @@ static int xsk_generic_xmit(struct sock *sk)
 	hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(xs->dev->needed_headroom));
 	tr = xs->dev->needed_tailroom;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->pool)) {
+	/* Build up to TX_BATCH_SIZE skbs before handing any of them to
+	 * the driver.  The descriptors are not published as consumed until
+	 * the burst is done, so the ones the driver did not take can be put
+	 * back.
+	 */
+	while (xskq_cons_peek_desc_deferred(xs->tx, &desc, xs->pool)) {
 		char *buffer;
 		u64 addr;
 		u32 len;
 
-		if (max_batch-- == 0) {
+		if (n == TX_BATCH_SIZE) {
 			err = -EAGAIN;
-			goto out;
+			goto xmit;
 		}
 
 		len = desc.len;
 		skb = sock_alloc_send_skb(sk, hr + len + tr, 1, &err);
 		if (unlikely(!skb))
-			goto out;
+			goto xmit;
 
 		skb_reserve(skb, hr);
 		skb_put(skb, len);
@@ -411,56 +478,85 @@ static int xsk_generic_xmit(struct sock *sk)
 		addr = desc.addr;
 		buffer = xsk_buff_raw_get_data(xs->pool, addr);
 		err = skb_store_bits(skb, 0, buffer, len);
+		if (unlikely(err)) {
+			kfree_skb(skb);
+			goto xmit;
+		}
+
+		skb->dev = xs->dev;
+		skb->priority = sk->sk_priority;
+		skb->mark = sk->sk_mark;
+		skb_set_queue_mapping(skb, xs->queue_id);
+
+		vskb = validate_xmit_skb_list(skb, xs->dev, &again);
+		if (unlikely(vskb != skb)) {
+			/* The skb is gone; the descriptor is dropped once
+			 * the ones before it have been sent.
+			 */
+			kfree_skb_list(vskb);
+			invalid = true;
+			goto xmit;
+		}
+
 		/* This is the backpressure mechanism for the Tx path.
 		 * Reserve space in the completion queue and only proceed
 		 * if there is space in it. This avoids having to implement
 		 * any buffering in the Tx path.
 		 */
 		spin_lock_irqsave(&xs->pool->cq_lock, flags);
-		if (unlikely(err) || xskq_prod_reserve(xs->pool->cq)) {
+		if (xskq_prod_reserve(xs->pool->cq)) {
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
 			kfree_skb(skb);
-			goto out;
+			goto xmit;
 		}
 		spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
 
-		skb->dev = xs->dev;
-		skb->priority = sk->sk_priority;
-		skb->mark = sk->sk_mark;
 		skb_shinfo(skb)->destructor_arg = (void *)(long)desc.addr;
 		skb->destructor = xsk_destruct_skb;
 
-		err = __dev_direct_xmit(skb, xs->queue_id);
-		if  (err == NETDEV_TX_BUSY) {
-			/* Tell user-space to retry the send */
-			skb->destructor = sock_wfree;
-			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			/* Free skb without triggering the perf drop trace */
-			consume_skb(skb);
-			err = -EAGAIN;
-			goto out;
-		}
-
+		cons[n] = xs->tx->cached_cons;
+		skbs[n++] = skb;
 		xskq_cons_release(xs->tx);
-		/* Ignore NET_XMIT_CN as packet might have been sent */
-		if (err == NET_XMIT_DROP) {
-			/* SKB completed but not sent */
-			err = -EBUSY;
-			goto out;
+	}
+
+	xs->tx->queue_empty_descs++;
+
+xmit:
+	sent = 0;
+	if (n) {
+		sent = xsk_direct_xmit_burst(xs, skbs, n, &ret);
+		xs->tx->tx_bursts++;
+		xs->tx->tx_burst_descs += sent;
+	}
+
+	if (sent < n) {
+		/* Tell user-space to retry the send of the rest */
+		for (i = sent; i < n; i++) {
+			skbs[i]->destructor = sock_wfree;
+			/* Free skb without triggering the perf drop trace */
+			consume_skb(skbs[i]);
 		}
+		spin_lock_irqsave(&xs->pool->cq_lock, flags);
+		xskq_prod_cancel_n(xs->pool->cq, n - sent);
+		spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+		xskq_cons_rewind(xs->tx, cons[sent]);
+		err = -EAGAIN;
+	} else if (invalid) {
+		err = xsk_drop_desc(xs, desc.addr);
+	}
 
-		sent_frame = true;
+	/* Ignore NET_XMIT_CN as packet might have been sent */
+	if (ret == NET_XMIT_DROP) {
+		/* SKB completed but not sent */
+		err = -EBUSY;
 	}
 
-	xs->tx->queue_empty_descs++;
+	__xskq_cons_release(xs->tx);
 
-out:
-	if (sent_frame)
-		if (xsk_tx_writeable(xs))
-			sk->sk_write_space(sk);
+	if (sent && xsk_tx_writeable(xs))
+		sk->sk_write_space(sk);
 
+out:
 	mutex_unlock(&xs->mutex);
 	return err;
 }
@@ -677,7 +773,7 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	flags = sxdp->sxdp_flags;
 	if (flags & ~(XDP_SHARED_UMEM | XDP_COPY | XDP_ZEROCOPY |
-		      XDP_USE_NEED_WAKEUP))
+		      XDP_USE_NEED_WAKEUP | XDP_SHARED_FILL))
 		return -EINVAL;
 
 	rtnl_lock();
@@ -705,7 +801,8 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 		struct socket *sock;
 
 		if ((flags & XDP_COPY) || (flags & XDP_ZEROCOPY) ||
-		    (flags & XDP_USE_NEED_WAKEUP)) {
+		    (flags & XDP_USE_NEED_WAKEUP) ||
+		    (flags & XDP_SHARED_FILL)) {
 			/* Cannot specify flags for shared sockets. */
 			err = -EINVAL;
 			goto out_unlock;
@@ -771,6 +868,12 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 		goto out_unlock;
 	} else {
 		/* This xsk has its own umem. */
+		if (flags & XDP_SHARED_FILL) {
+			err = xp_fill_share_create(xs->umem);
+			if (err)
+				goto out_unlock;
+		}
+
 		xs->pool = xp_create_and_assign_umem(xs, xs->umem);
 		if (!xs->pool) {
 			err = -ENOMEM;
@@ -28,6 +28,8 @@ struct xdp_mmap_offsets_v1 {
  * track which maps a certain socket reside in.
  */
 
+struct xdp_diag_fill_share;
+
 struct xsk_map_node {
 	struct list_head node;
 	struct xsk_map *map;
@@ -46,5 +48,9 @@ void xsk_map_put(struct xsk_map *map);
 void xsk_clear_pool_at_qid(struct net_device *dev, u16 queue_id);
 int xsk_reg_pool_at_qid(struct net_device *dev, struct xsk_buff_pool *pool,
 			u16 queue_id);
+int xp_fill_share_create(struct xdp_umem *umem);
+void xp_fill_share_release(struct xdp_umem *umem);
+bool xp_fill_share_stats(struct xdp_umem *umem,
+			 struct xdp_diag_fill_share *stats);
 
 #endif /* XSK_H_ */
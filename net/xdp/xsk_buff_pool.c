@@ -3,6 +3,9 @@
 #include <net/xsk_buff_pool.h>
 #include <net/xdp_sock.h>
 #include <net/xdp_sock_drv.h>
+#include <linux/xdp_diag.h>
+#include <linux/xarray.h>
+#include <linux/log2.h>
 
 #include "xsk_queue.h"
 #include "xdp_umem.h"
@@ -446,34 +449,206 @@ static bool xp_check_aligned(struct xsk_buff_pool *pool, u64 *addr)
 	return *addr < pool->addrs_cnt;
 }
 
+/* Free frames shared by all the buffer pools of a umem, enabled by binding
+ * the umem owner with XDP_SHARED_FILL. A pool whose fill ring runs dry
+ * borrows from here and marks the share hungry. As only the owning pool
+ * may consume a fill ring, pools with a backlog in theirs top the share
+ * up from their own alloc path while it is hungry.
+ *
+ * The share lives in a table keyed by umem id and is pinned by the umem
+ * reference every pool holds, so the alloc path needs no extra refcount.
+ */
+#define XP_FILL_SHARE_MAX	4096
+#define XP_FILL_SHARE_BATCH	32
+
+struct xp_fill_share {
+	spinlock_t lock; /* Protects the ring and the counters */
+	u32 prod;
+	u32 cons;
+	u32 mask;
+	bool hungry;
+	u64 starved;
+	u64 borrowed;
+	u64 donated;
+	u64 exhausted;
+	u64 addrs[];
+};
+
+static DEFINE_XARRAY(xp_fill_shares);
+static DEFINE_STATIC_KEY_FALSE(xp_fill_share_used);
+
+int xp_fill_share_create(struct xdp_umem *umem)
+{
+	struct xp_fill_share *share;
+	u32 nentries;
+	int err;
+
+	if (xa_load(&xp_fill_shares, umem->id))
+		return 0;
+
+	nentries = min_t(u32, roundup_pow_of_two(umem->chunks),
+			 XP_FILL_SHARE_MAX);
+	share = kvzalloc(struct_size(share, addrs, nentries), GFP_KERNEL);
+	if (!share)
+		return -ENOMEM;
+
+	spin_lock_init(&share->lock);
+	share->mask = nentries - 1;
+
+	err = xa_insert(&xp_fill_shares, umem->id, share, GFP_KERNEL);
+	if (err) {
+		kvfree(share);
+		return err == -EBUSY ? 0 : err;
+	}
+
+	static_branch_inc(&xp_fill_share_used);
+	return 0;
+}
+
+void xp_fill_share_release(struct xdp_umem *umem)
+{
+	struct xp_fill_share *share;
+
+	share = xa_erase(&xp_fill_shares, umem->id);
+	if (!share)
+		return;
+
+	static_branch_dec(&xp_fill_share_used);
+	kvfree(share);
+}
+
+bool xp_fill_share_stats(struct xdp_umem *umem,
+			 struct xdp_diag_fill_share *stats)
+{
+	struct xp_fill_share *share;
+
+	share = xa_load(&xp_fill_shares, umem->id);
+	if (!share)
+		return false;
+
+	spin_lock_bh(&share->lock);
+	stats->n_starved = share->starved;
+	stats->n_borrowed = share->borrowed;
+	stats->n_donated = share->donated;
+	stats->n_exhausted = share->exhausted;
+	stats->n_entries = share->prod - share->cons;
+	spin_unlock_bh(&share->lock);
+	return true;
+}
+
+static struct xp_fill_share *xp_fill_share(struct xsk_buff_pool *pool)
+{
+	return xa_load(&xp_fill_shares, pool->umem->id);
+}
+
+static bool xp_fill_share_borrow(struct xsk_buff_pool *pool, u64 *addr)
+{
+	struct xp_fill_share *share = xp_fill_share(pool);
+	bool ok = false;
+
+	if (!share)
+		return false;
+
+	spin_lock_bh(&share->lock);
+	share->starved++;
+	if (share->prod != share->cons) {
+		*addr = share->addrs[share->cons++ & share->mask];
+		share->borrowed++;
+		ok = true;
+	} else {
+		share->exhausted++;
+	}
+	if (share->prod - share->cons < XP_FILL_SHARE_BATCH)
+		WRITE_ONCE(share->hungry, true);
+	spin_unlock_bh(&share->lock);
+
+	return ok;
+}
+
+static void xp_fill_share_donate(struct xsk_buff_pool *pool)
+{
+	struct xsk_queue *fq = pool->fq;
+	struct xp_fill_share *share;
+	u32 room, i;
+	u64 addr;
+
+	/* Only give away frames from a backlog we already know about. */
+	if (fq->cached_prod - fq->cached_cons < 2 * XP_FILL_SHARE_BATCH)
+		return;
+
+	share = xp_fill_share(pool);
+	if (!share || !READ_ONCE(share->hungry))
+		return;
+
+	spin_lock_bh(&share->lock);
+	room = share->mask + 1 - (share->prod - share->cons);
+	room = min_t(u32, room, XP_FILL_SHARE_BATCH);
+	for (i = 0; i < room; i++) {
+		if (!xskq_cons_peek_addr_unchecked(fq, &addr))
+			break;
+		share->addrs[share->prod++ & share->mask] = addr;
+		xskq_cons_release(fq);
+	}
+	share->donated += i;
+	if (share->prod - share->cons >= XP_FILL_SHARE_BATCH)
+		WRITE_ONCE(share->hungry, false);
+	spin_unlock_bh(&share->lock);
+
+	__xskq_cons_release(fq);
+}
+
+static bool xp_fill_share_has_entries(struct xsk_buff_pool *pool, u32 cnt)
+{
+	struct xp_fill_share *share = xp_fill_share(pool);
+
+	if (!share)
+		return false;
+
+	if (READ_ONCE(share->prod) - READ_ONCE(share->cons) >= cnt)
+		return true;
+	WRITE_ONCE(share->hungry, true);
+	return false;
+}
+
 static struct xdp_buff_xsk *__xp_alloc(struct xsk_buff_pool *pool)
 {
 	struct xdp_buff_xsk *xskb;
+	bool ok, from_fq;
 	u64 addr;
-	bool ok;
 
 	if (pool->free_heads_cnt == 0)
 		return NULL;
 
+	if (static_branch_unlikely(&xp_fill_share_used))
+		xp_fill_share_donate(pool);
+
 	xskb = pool->free_heads[--pool->free_heads_cnt];
 
 	for (;;) {
-		if (!xskq_cons_peek_addr_unchecked(pool->fq, &addr)) {
+		from_fq = xskq_cons_peek_addr_unchecked(pool->fq, &addr);
+		if (!from_fq) {
 			pool->fq->queue_empty_descs++;
-			xp_release(xskb);
-			return NULL;
+			if (!static_branch_unlikely(&xp_fill_share_used) ||
+			    !xp_fill_share_borrow(pool, &addr)) {
+				xp_release(xskb);
+				return NULL;
+			}
 		}
 
+		/* Borrowed addresses came from another pool's fill ring
+		 * unchecked; every pool of the umem maps all of it, so the
+		 * same checks make them valid here.
+		 */
 		ok = pool->unaligned ? xp_check_unaligned(pool, &addr) :
 		     xp_check_aligned(pool, &addr);
+		if (from_fq)
+			xskq_cons_release(pool->fq);
 		if (!ok) {
 			pool->fq->invalid_descs++;
-			xskq_cons_release(pool->fq);
 			continue;
 		}
 		break;
 	}
-	xskq_cons_release(pool->fq);
 
 	xskb->orig_addr = addr;
 	xskb->xdp.data_hard_start = pool->addrs + addr + pool->headroom;
@@ -516,9 +691,19 @@ EXPORT_SYMBOL(xp_alloc);
 
 bool xp_can_alloc(struct xsk_buff_pool *pool, u32 count)
 {
+	u32 need;
+
 	if (pool->free_list_cnt >= count)
 		return true;
-	return xskq_cons_has_entries(pool->fq, count - pool->free_list_cnt);
+
+	need = count - pool->free_list_cnt;
+	if (xskq_cons_has_entries(pool->fq, need))
+		return true;
+	if (!static_branch_unlikely(&xp_fill_share_used))
+		return false;
+
+	need -= pool->fq->cached_prod - pool->fq->cached_cons;
+	return xp_fill_share_has_entries(pool, need);
 }
 EXPORT_SYMBOL(xp_can_alloc);
 
@@ -89,6 +89,30 @@ static int xsk_diag_put_stats(const struct xdp_sock *xs, struct sk_buff *nlskb)
 	return nla_put(nlskb, XDP_DIAG_STATS, sizeof(du), &du);
 }
 
+static int xsk_diag_put_tx_batch(const struct xdp_sock *xs,
+				 struct sk_buff *nlskb)
+{
+	struct xdp_diag_tx_batch db = {};
+
+	if (!xs->tx)
+		return 0;
+
+	db.n_tx_bursts = xs->tx->tx_bursts;
+	db.n_tx_burst_descs = xs->tx->tx_burst_descs;
+	return nla_put(nlskb, XDP_DIAG_TX_BATCH, sizeof(db), &db);
+}
+
+static int xsk_diag_put_fill_share(const struct xdp_sock *xs,
+				   struct sk_buff *nlskb)
+{
+	struct xdp_diag_fill_share ds = {};
+
+	if (!xs->umem || !xp_fill_share_stats(xs->umem, &ds))
+		return 0;
+
+	return nla_put(nlskb, XDP_DIAG_FILL_SHARE, sizeof(ds), &ds);
+}
+
 static int xsk_diag_fill(struct sock *sk, struct sk_buff *nlskb,
 			 struct xdp_diag_req *req,
 			 struct user_namespace *user_ns,
@@ -132,7 +156,9 @@ static int xsk_diag_fill(struct sock *sk, struct sk_buff *nlskb,
 		goto out_nlmsg_trim;
 
 	if ((req->xdiag_show & XDP_SHOW_STATS) &&
-	    xsk_diag_put_stats(xs, nlskb))
+	    (xsk_diag_put_stats(xs, nlskb) ||
+	     xsk_diag_put_tx_batch(xs, nlskb) ||
+	     xsk_diag_put_fill_share(xs, nlskb)))
 		goto out_nlmsg_trim;
 
 	mutex_unlock(&xs->mutex);
@@ -43,6 +43,8 @@ struct xsk_queue {
 	struct xdp_ring *ring;
 	u64 invalid_descs;
 	u64 queue_empty_descs;
+	u64 tx_bursts;
+	u64 tx_burst_descs;
 };
 
 /* The structure of the shared state of the rings are the same as the
@@ -246,6 +248,25 @@ static inline bool xskq_cons_peek_desc(struct xsk_queue *q,
 	return xskq_cons_read_desc(q, desc, pool);
 }
 
+/* Like xskq_cons_peek_desc(), but entries released since the consumer
+ * pointer was last published stay private to the kernel, so that they
+ * can still be handed back with xskq_cons_rewind().  The caller
+ * publishes them with __xskq_cons_release() when it is done.
+ */
+static inline bool xskq_cons_peek_desc_deferred(struct xsk_queue *q,
+						struct xdp_desc *desc,
+						struct xsk_buff_pool *pool)
+{
+	if (q->cached_prod == q->cached_cons)
+		__xskq_cons_peek(q);
+	return xskq_cons_read_desc(q, desc, pool);
+}
+
+static inline void xskq_cons_rewind(struct xsk_queue *q, u32 cached_cons)
+{
+	q->cached_cons = cached_cons;
+}
+
 static inline void xskq_cons_release(struct xsk_queue *q)
 {
 	/* To improve performance, only update local state here.
@@ -290,6 +311,11 @@ static inline void xskq_prod_cancel(struct xsk_queue *q)
 	q->cached_prod--;
 }
 
+static inline void xskq_prod_cancel_n(struct xsk_queue *q, u32 cnt)
+{
+	q->cached_prod -= cnt;
+}
+
 static inline int xskq_prod_reserve(struct xsk_queue *q)
 {
 	if (xskq_prod_is_full(q))
@@ -456,6 +456,41 @@ static int xfrm_inner_mode_input(struct xfrm_state *x,
 	return -EOPNOTSUPP;
 }
 
+/*
+ * Lockless test whether @net_seq is ahead of the replay window, which is
+ * the case for nearly all packets of an in-order flow.  A false answer
+ * only means the full check has to be done under x->lock; a stale window
+ * can at worst let a replayed packet through to decryption, where
+ * ->recheck() catches it.
+ */
+static bool xfrm_replay_ahead(struct xfrm_state *x, __be32 net_seq)
+{
+	struct xfrm_replay_state_esn *replay_esn = x->replay_esn;
+	u32 seq = ntohl(net_seq);
+	u32 wsize, top, bottom;
+
+	if (!replay_esn) {
+		if (!x->props.replay_window)
+			return true;
+		return seq && seq > READ_ONCE(x->replay.seq);
+	}
+
+	wsize = replay_esn->replay_window;
+	if (!wsize)
+		return true;
+	if (!seq)
+		return false;
+
+	top = READ_ONCE(replay_esn->seq);
+	if (!(x->props.flags & XFRM_STATE_ESN))
+		return seq > top;
+
+	bottom = top - wsize + 1;
+	if (likely(top >= wsize - 1))
+		return seq > top || seq < bottom;
+	return seq > top && seq < bottom;
+}
+
 int xfrm_input(struct sk_buff *skb, int nexthdr, __be32 spi, int encap_type)
 {
 	const struct xfrm_state_afinfo *afinfo;
@@ -472,6 +507,7 @@ int xfrm_input(struct sk_buff *skb, int nexthdr, __be32 spi, int encap_type)
 	int async = 0;
 	bool xfrm_gro = false;
 	bool crypto_done = false;
+	u8 state;
 	struct xfrm_offload *xo = xfrm_offload(skb);
 	struct sec_path *sp;
 
@@ -596,34 +632,33 @@ int xfrm_input(struct sk_buff *skb, int nexthdr, __be32 spi, int encap_type)
 		}
 
 lock:
-		spin_lock(&x->lock);
-
-		if (unlikely(x->km.state != XFRM_STATE_VALID)) {
-			if (x->km.state == XFRM_STATE_ACQ)
+		/* Cheap early checks; everything that decides the fate of
+		 * the packet is redone under x->lock once it is decrypted.
+		 */
+		state = READ_ONCE(x->km.state);
+		if (unlikely(state != XFRM_STATE_VALID)) {
+			if (state == XFRM_STATE_ACQ)
 				XFRM_INC_STATS(net, LINUX_MIB_XFRMACQUIREERROR);
 			else
 				XFRM_INC_STATS(net,
 					       LINUX_MIB_XFRMINSTATEINVALID);
-			goto drop_unlock;
+			goto drop;
 		}
 
 		if ((x->encap ? x->encap->encap_type : 0) != encap_type) {
 			XFRM_INC_STATS(net, LINUX_MIB_XFRMINSTATEMISMATCH);
-			goto drop_unlock;
-		}
-
-		if (x->repl->check(x, skb, seq)) {
-			XFRM_INC_STATS(net, LINUX_MIB_XFRMINSTATESEQERROR);
-			goto drop_unlock;
+			goto drop;
 		}
 
-		if (xfrm_state_check_expire(x)) {
-			XFRM_INC_STATS(net, LINUX_MIB_XFRMINSTATEEXPIRED);
-			goto drop_unlock;
+		if (!xfrm_replay_ahead(x, seq)) {
+			spin_lock(&x->lock);
+			if (x->repl->check(x, skb, seq)) {
+				XFRM_INC_STATS(net, LINUX_MIB_XFRMINSTATESEQERROR);
+				goto drop_unlock;
+			}
+			spin_unlock(&x->lock);
 		}
 
-		spin_unlock(&x->lock);
-
 		if (xfrm_tunnel_check(skb, x, family)) {
 			XFRM_INC_STATS(net, LINUX_MIB_XFRMINSTATEMODEERROR);
 			goto drop;
@@ -660,6 +695,11 @@ int xfrm_input(struct sk_buff *skb, int nexthdr, __be32 spi, int encap_type)
 		/* only the first xfrm gets the encap type */
 		encap_type = 0;
 
+		if (xfrm_state_check_expire(x)) {
+			XFRM_INC_STATS(net, LINUX_MIB_XFRMINSTATEEXPIRED);
+			goto drop_unlock;
+		}
+
 		if (x->repl->recheck(x, skb, seq)) {
 			XFRM_INC_STATS(net, LINUX_MIB_XFRMINSTATESEQERROR);
 			goto drop_unlock;
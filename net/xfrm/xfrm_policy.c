@@ -2049,17 +2049,61 @@ __xfrm_policy_eval_candidates(struct hlist_head *chain,
 	return NULL;
 }
 
+/* Gets the best (lowest) priority on a candidate list, false if empty.
+ * The lists are kept sorted by priority, so this is the first entry.
+ */
+static bool xfrm_policy_chain_priority(struct hlist_head *chain, u32 *prio)
+{
+	struct xfrm_policy *pol;
+
+	if (!chain)
+		return false;
+
+	pol = hlist_entry_safe(rcu_dereference_raw(hlist_first_rcu(chain)),
+			       struct xfrm_policy, bydst);
+	if (!pol)
+		return false;
+
+	*prio = READ_ONCE(pol->priority);
+	return true;
+}
+
 static struct xfrm_policy *
 xfrm_policy_eval_candidates(struct xfrm_pol_inexact_candidates *cand,
 			    struct xfrm_policy *prefer,
 			    const struct flowi *fl,
 			    u8 type, u16 family, int dir, u32 if_id)
 {
+	struct hlist_head *res[XFRM_POL_CAND_MAX];
+	u32 prio[XFRM_POL_CAND_MAX];
 	struct xfrm_policy *tmp;
-	int i;
+	int i, j, n = 0;
 
+	/* Walk the candidate lists best first.  Once the best match so far
+	 * has a lower priority than the head of the next list, neither that
+	 * list nor any later one can hold a better match: with many large
+	 * lists, most of them are never walked at all.
+	 */
 	for (i = 0; i < ARRAY_SIZE(cand->res); i++) {
-		tmp = __xfrm_policy_eval_candidates(cand->res[i],
+		u32 p;
+
+		if (!xfrm_policy_chain_priority(cand->res[i], &p))
+			continue;
+
+		for (j = n; j > 0 && prio[j - 1] > p; j--) {
+			prio[j] = prio[j - 1];
+			res[j] = res[j - 1];
+		}
+		prio[j] = p;
+		res[j] = cand->res[i];
+		n++;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (prefer && prio[i] > prefer->priority)
+			break;
+
+		tmp = __xfrm_policy_eval_candidates(res[i],
 						    prefer,
 						    fl, type, family, dir,
 						    if_id);
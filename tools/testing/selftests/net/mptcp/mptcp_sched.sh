@@ -0,0 +1,175 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+
+rndh=$(printf %x $sec)-$(mktemp -u XXXXXX)
+ns1="ns1-$rndh"
+ns2="ns2-$rndh"
+ksft_skip=4
+timeout=30
+test_cnt=1
+ret=0
+pids=()
+
+cleanup()
+{
+	rm -f "$large" "$small"
+	for pid in ${pids[@]}; do
+		[ -d /proc/$pid ] && kill -9 $pid >/dev/null 2>&1
+	done
+
+	local netns
+	for netns in "$ns1" "$ns2";do
+		ip netns del $netns
+	done
+}
+
+ip -Version > /dev/null 2>&1
+if [ $? -ne 0 ];then
+	echo "SKIP: Could not run test without ip tool"
+	exit $ksft_skip
+fi
+
+#  ns1            ns2
+#     ns1eth1    ns2eth1
+#     ns1eth2    ns2eth2
+
+setup()
+{
+	large=$(mktemp)
+	small=$(mktemp)
+	size=$((2048 * 4096))
+	dd if=/dev/zero of=$small bs=4096 count=20 >/dev/null 2>&1
+	dd if=/dev/zero of=$large bs=4096 count=$((size / 4096)) >/dev/null 2>&1
+
+	trap cleanup EXIT
+
+	for i in "$ns1" "$ns2";do
+		ip netns add $i || exit $ksft_skip
+		ip -net $i link set lo up
+	done
+
+	ip link add ns1eth1 netns "$ns1" type veth peer name ns2eth1 netns "$ns2"
+	ip link add ns1eth2 netns "$ns1" type veth peer name ns2eth2 netns "$ns2"
+
+	ip -net "$ns1" addr add 10.0.1.1/24 dev ns1eth1
+	ip -net "$ns1" link set ns1eth1 up
+	ip -net "$ns1" addr add 10.0.2.1/24 dev ns1eth2
+	ip -net "$ns1" link set ns1eth2 up
+
+	ip -net "$ns2" addr add 10.0.1.2/24 dev ns2eth1
+	ip -net "$ns2" link set ns2eth1 up
+	ip -net "$ns2" addr add 10.0.2.2/24 dev ns2eth2
+	ip -net "$ns2" link set ns2eth2 up
+
+	ip netns exec "$ns1" ./pm_nl_ctl limits 1 1
+	ip netns exec "$ns1" ./pm_nl_ctl add 10.0.2.1 dev ns1eth2 flags subflow
+	ip netns exec "$ns2" ./pm_nl_ctl limits 1 1
+}
+
+# $1: ns, $2: port
+wait_local_port_listen()
+{
+	local listener_ns="${1}"
+	local port="${2}"
+
+	local port_hex i
+
+	port_hex="$(printf "%04X" "${port}")"
+	for i in $(seq 10); do
+		ip netns exec "${listener_ns}" cat /proc/net/tcp* | \
+			awk "BEGIN {rc=1} {if (\$2 ~ /:${port_hex}\$/ && \$4 ~ /0A/) {rc=0; exit}} END {exit rc}" &&
+			break
+		sleep 0.1
+	done
+}
+
+chk_result()
+{
+	local msg="$1"
+	local err="$2"
+
+	printf "%-50s" "$msg"
+	if [ -n "$err" ]; then
+		echo "[ fail ] $err"
+		ret=$test_cnt
+	else
+		echo "[  ok  ]"
+	fi
+	test_cnt=$((test_cnt+1))
+}
+
+chk_sysctl()
+{
+	local err=""
+	local val
+
+	val=$(ip netns exec $ns1 sysctl -n net.mptcp.scheduler)
+	[ "$val" = "default" ] || err="initial value $val"
+	chk_result "scheduler sysctl defaults to default" "$err"
+
+	err=""
+	ip netns exec $ns1 sysctl -q net.mptcp.scheduler=nosuch 2>/dev/null &&
+		err="unknown name accepted"
+	val=$(ip netns exec $ns1 sysctl -n net.mptcp.scheduler)
+	[ "$val" = "default" ] || err="value changed to $val"
+	chk_result "unknown scheduler is rejected" "$err"
+}
+
+# $1: scheduler, $2: 1 if every subflow must carry data
+run_test()
+{
+	local sched=$1
+	local all=$2
+	local port=$((10000+$test_cnt))
+	local err=""
+	local stats total i
+
+	ip netns exec $ns1 sysctl -q net.mptcp.scheduler=$sched
+	if [ $? -ne 0 ]; then
+		chk_result "$sched: select scheduler" "sysctl write failed"
+		return
+	fi
+
+	ip netns exec $ns2 ./mptcp_connect -j -w 3 -t $timeout -l -p $port \
+		0.0.0.0 < "$small" > /dev/null &
+	pids[0]=$!
+	wait_local_port_listen "$ns2" "$port"
+
+	# the client keeps its subflows open for a few seconds once all data
+	# is written, long enough to read the counters
+	ip netns exec $ns1 ./mptcp_connect -j -w 3 -t $timeout -p $port \
+		10.0.1.2 < "$large" > /dev/null &
+	pids[1]=$!
+
+	for i in $(seq 50); do
+		stats=$(ip netns exec $ns1 ./mptcp_sched_info)
+		total=$(echo "$stats" | awk '{ s += $4 } END { print s + 0 }')
+		[ "$total" -ge "$size" ] && break
+		sleep 0.1
+	done
+
+	if [ "$(echo "$stats" | grep -c .)" -ne 2 ]; then
+		err="expected 2 subflows"
+	elif [ "$total" -ne "$size" ]; then
+		err="sent $total bytes, expected $size"
+	elif [ "$(echo "$stats" | awk '{ s += $3 } END { print s + 0 }')" -eq 0 ]; then
+		err="no burst scheduled"
+	elif [ $all -eq 1 ] &&
+	     echo "$stats" | awk '$3 == 0 || $4 == 0 { f = 1 } END { exit !f }'; then
+		err="idle subflow"
+	fi
+	[ -n "$err" ] && echo "$stats" 1>&2
+	chk_result "$sched: sched bursts/bytes" "$err"
+
+	wait ${pids[1]}
+	wait ${pids[0]}
+	pids=()
+}
+
+setup
+chk_sysctl
+run_test default 0
+run_test roundrobin 1
+run_test default 0
+
+exit $ret
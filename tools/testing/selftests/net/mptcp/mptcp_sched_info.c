@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Dump the scheduler counters of the MPTCP subflows in the current netns,
+ * one line per subflow: "<local port> <remote port> <bursts> <bytes>"
+ */
+
+#include <errno.h>
+#include <error.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+
+#include "linux/mptcp.h"
+
+static struct rtattr *rta_find(struct rtattr *attrs, int len, int type)
+{
+	while (RTA_OK(attrs, len)) {
+		if ((attrs->rta_type & ~NLA_F_NESTED) == type)
+			return attrs;
+		attrs = RTA_NEXT(attrs, len);
+	}
+	return NULL;
+}
+
+static void print_subflow(struct inet_diag_msg *r, int len)
+{
+	struct rtattr *ulp, *info, *rta;
+	__u64 bytes = 0;
+	__u32 bursts = 0;
+
+	ulp = rta_find((struct rtattr *)(r + 1), len, INET_DIAG_ULP_INFO);
+	if (!ulp)
+		return;
+	info = rta_find(RTA_DATA(ulp), RTA_PAYLOAD(ulp), INET_ULP_INFO_MPTCP);
+	if (!info)
+		return;
+
+	rta = rta_find(RTA_DATA(info), RTA_PAYLOAD(info),
+		       MPTCP_SUBFLOW_ATTR_SCHED_BURSTS);
+	if (rta)
+		memcpy(&bursts, RTA_DATA(rta), sizeof(bursts));
+	rta = rta_find(RTA_DATA(info), RTA_PAYLOAD(info),
+		       MPTCP_SUBFLOW_ATTR_SCHED_BYTES);
+	if (rta)
+		memcpy(&bytes, RTA_DATA(rta), sizeof(bytes));
+
+	printf("%u %u %u %llu\n", ntohs(r->id.idiag_sport),
+	       ntohs(r->id.idiag_dport), bursts, (unsigned long long)bytes);
+}
+
+static void dump_family(int fd, int family)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct inet_diag_req_v2 r;
+	} req = {
+		.nlh = {
+			.nlmsg_len = sizeof(req),
+			.nlmsg_type = SOCK_DIAG_BY_FAMILY,
+			.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+		},
+		.r = {
+			.sdiag_family = family,
+			.sdiag_protocol = IPPROTO_TCP,
+			/* the ULP info comes along with INET_DIAG_INFO */
+			.idiag_ext = 1 << (INET_DIAG_INFO - 1),
+			.idiag_states = ~0U,
+		},
+	};
+	char buf[32768];
+	struct nlmsghdr *nh;
+	int ret;
+
+	if (send(fd, &req, sizeof(req), 0) != sizeof(req))
+		error(1, errno, "send inet_diag request");
+
+	for (;;) {
+		ret = recv(fd, buf, sizeof(buf), 0);
+		if (ret < 0)
+			error(1, errno, "recv inet_diag reply");
+
+		/* Beware: the NLMSG_NEXT macro updates the 'ret' argument */
+		for (nh = (void *)buf; NLMSG_OK(nh, ret);
+		     nh = NLMSG_NEXT(nh, ret)) {
+			if (nh->nlmsg_type == NLMSG_DONE)
+				return;
+			if (nh->nlmsg_type == NLMSG_ERROR)
+				error(1, -((struct nlmsgerr *)NLMSG_DATA(nh))->error,
+				      "inet_diag dump");
+			print_subflow(NLMSG_DATA(nh),
+				      nh->nlmsg_len - NLMSG_LENGTH(sizeof(struct inet_diag_msg)));
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int fd;
+
+	fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_SOCK_DIAG);
+	if (fd < 0)
+		error(1, errno, "socket netlink");
+
+	dump_family(fd, AF_INET);
+	dump_family(fd, AF_INET6);
+
+	close(fd);
+	return 0;
+}
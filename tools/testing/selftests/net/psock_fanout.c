@@ -22,6 +22,7 @@
  *   - PACKET_FANOUT_ROLLOVER
  *   - PACKET_FANOUT_CBPF
  *   - PACKET_FANOUT_EBPF
+ *   - PACKET_FANOUT_FLOW
  *
  * Todo:
  * - functionality: PACKET_FANOUT_FLAG_DEFRAG
@@ -113,6 +114,28 @@ static void sock_fanout_set_cbpf(int fd)
 	}
 }
 
+/* Let flows move as soon as their member runs short of room */
+static void sock_fanout_set_flow(int fd)
+{
+	uint32_t idle_ms = 0;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT_DATA, &idle_ms,
+		       sizeof(idle_ms))) {
+		perror("fanout data flow");
+		exit(1);
+	}
+}
+
+static void sock_fanout_flow_stats(int fd, struct tpacket_fanout_stats *stats)
+{
+	socklen_t len = sizeof(*stats);
+
+	if (getsockopt(fd, SOL_PACKET, PACKET_FANOUT_STATS, stats, &len)) {
+		perror("fanout stats");
+		exit(1);
+	}
+}
+
 static void sock_fanout_getopts(int fd, uint16_t *typeflags, uint16_t *group_id)
 {
 	int sockopt;
@@ -363,6 +386,8 @@ static int test_datapath(uint16_t typeflags, int port_off,
 		sock_fanout_set_cbpf(fds[0]);
 	else if (type == PACKET_FANOUT_EBPF)
 		sock_fanout_set_ebpf(fds[0]);
+	else if (type == PACKET_FANOUT_FLOW)
+		sock_fanout_set_flow(fds[0]);
 
 	rings[0] = sock_fanout_open_ring(fds[0]);
 	rings[1] = sock_fanout_open_ring(fds[1]);
@@ -380,6 +405,21 @@ static int test_datapath(uint16_t typeflags, int port_off,
 	/* TODO: ensure consistent order between expect1 and expect2 */
 	ret |= sock_fanout_read(fds, rings, expect2);
 
+	/* Nothing was read from the full socket, so the flow on it must not
+	 * move: its later packets could be read before the earlier ones.
+	 */
+	if (type == PACKET_FANOUT_FLOW) {
+		struct tpacket_fanout_stats stats[2];
+
+		sock_fanout_flow_stats(fds[0], &stats[0]);
+		sock_fanout_flow_stats(fds[1], &stats[1]);
+		if (stats[0].tp_flows_out || stats[1].tp_flows_out ||
+		    !(stats[0].tp_held + stats[1].tp_held)) {
+			fprintf(stderr, "ERROR: unread flow moved or not held\n");
+			ret = 1;
+		}
+	}
+
 	if (munmap(rings[1], RING_NUM_FRAMES * getpagesize()) ||
 	    munmap(rings[0], RING_NUM_FRAMES * getpagesize())) {
 		fprintf(stderr, "close rings\n");
@@ -421,6 +461,7 @@ int main(int argc, char **argv)
 	const int expect_cpu0[2][2]	= { { 20, 0 },  { 20, 0 } };
 	const int expect_cpu1[2][2]	= { { 0, 20 },  { 0, 20 } };
 	const int expect_bpf[2][2]	= { { 15, 5 },  { 15, 20 } };
+	const int expect_flow[2][2]	= { { 15, 5 },  { 20, 5 } };
 	const int expect_uniqueid[2][2] = { { 20, 20},  { 20, 20 } };
 	int port_off = 2, tries = 20, ret;
 
@@ -452,6 +493,8 @@ int main(int argc, char **argv)
 			     port_off, expect_bpf[0], expect_bpf[1]);
 	ret |= test_datapath(PACKET_FANOUT_EBPF,
 			     port_off, expect_bpf[0], expect_bpf[1]);
+	ret |= test_datapath(PACKET_FANOUT_FLOW,
+			     port_off, expect_flow[0], expect_flow[1]);
 
 	set_cpuaffinity(0);
 	ret |= test_datapath(PACKET_FANOUT_CPU, port_off,
@@ -95,6 +95,7 @@ union frame_map {
 };
 
 static unsigned int total_packets, total_bytes;
+static unsigned int v3_ft_req;
 
 static int pfsocket(int ver)
 {
@@ -581,6 +582,8 @@ void __v3_flush_block(struct block_desc *pbd)
 static void walk_v3_rx(int sock, struct ring *ring)
 {
 	unsigned int block_num = 0;
+	struct tpacket_stats_v3 st;
+	socklen_t len = sizeof(st);
 	struct pollfd pfd;
 	struct block_desc *pbd;
 	int udp_sock[2];
@@ -616,6 +619,16 @@ static void walk_v3_rx(int sock, struct ring *ring)
 		exit(1);
 	}
 
+	if (getsockopt(sock, SOL_PACKET, PACKET_STATISTICS, &st, &len)) {
+		perror("getsockopt");
+		exit(1);
+	}
+
+	if (len == sizeof(st) && !st.tp_blk_full_cnt && !st.tp_blk_tmo_cnt) {
+		fprintf(stderr, "walk_v3_rx: no retired blocks accounted\n");
+		exit(1);
+	}
+
 	fprintf(stderr, " %u pkts (%u bytes)", NUM_PACKETS, total_bytes >> 1);
 }
 
@@ -648,7 +661,8 @@ static void __v3_fill(struct ring *ring, unsigned int blocks, int type)
 	if (type == PACKET_RX_RING) {
 		ring->req3.tp_retire_blk_tov = 64;
 		ring->req3.tp_sizeof_priv = 0;
-		ring->req3.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+		ring->req3.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH |
+						 v3_ft_req;
 	}
 	ring->req3.tp_block_size = getpagesize() << 2;
 	ring->req3.tp_frame_size = TPACKET_ALIGNMENT << 7;
@@ -842,6 +856,9 @@ int main(void)
 	ret |= test_tpacket(TPACKET_V3, PACKET_RX_RING);
 	ret |= test_tpacket(TPACKET_V3, PACKET_TX_RING);
 
+	v3_ft_req = TP_FT_REQ_BATCH_WAKEUP;
+	ret |= test_tpacket(TPACKET_V3, PACKET_RX_RING);
+
 	if (ret)
 		return 1;
 
@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Measure the RDS message rate over the loopback transport.
+ *
+ * Runs a number of sender/receiver socket pairs bound to 127.0.0.1, one
+ * thread per socket.  RDS connections between local addresses use the
+ * loop transport, so every message goes through the core send path,
+ * the send and receive workers and the receive queue without touching
+ * the network.  Reports the number of messages received per second.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <error.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef AF_RDS
+#define AF_RDS		21
+#endif
+
+#define MAX_PAIRS	64
+
+static unsigned int	cfg_pairs	= 4;
+static unsigned int	cfg_size	= 64;
+static unsigned int	cfg_duration	= 3;
+static uint16_t		cfg_port	= 4000;
+
+static volatile bool	stop;
+
+struct pair {
+	pthread_t		tx_thread;
+	pthread_t		rx_thread;
+	int			tx_fd;
+	int			rx_fd;
+	struct sockaddr_in	rx_addr;
+	unsigned long		sent;
+	unsigned long		received;
+};
+
+static struct pair pairs[MAX_PAIRS];
+
+static void usage(const char *prog)
+{
+	error(1, 0, "usage: %s [-n <pairs>] [-s <msg size>] [-t <secs>] [-p <base port>]",
+	      prog);
+}
+
+static void parse_opts(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "n:p:s:t:")) != -1) {
+		switch (c) {
+		case 'n':
+			cfg_pairs = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			cfg_port = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			cfg_size = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			cfg_duration = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!cfg_pairs || cfg_pairs > MAX_PAIRS || !cfg_size || !cfg_duration)
+		usage(argv[0]);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		error(1, errno, "clock_gettime");
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int rds_socket(uint16_t port, struct sockaddr_in *addr)
+{
+	struct timeval tv = { .tv_usec = 100 * 1000 };
+	int fd;
+
+	fd = socket(AF_RDS, SOCK_SEQPACKET, 0);
+	if (fd == -1)
+		error(1, errno, "socket");
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr->sin_port = htons(port);
+	if (bind(fd, (void *)addr, sizeof(*addr)))
+		error(1, errno, "bind %u", port);
+
+	/* Let blocked threads notice the end of the run */
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) ||
+	    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)))
+		error(1, errno, "setsockopt timeout");
+
+	return fd;
+}
+
+static void *do_tx(void *arg)
+{
+	struct pair *p = arg;
+	char *buf;
+
+	buf = calloc(1, cfg_size);
+	if (!buf)
+		error(1, ENOMEM, "tx buffer");
+
+	while (!stop) {
+		if (sendto(p->tx_fd, buf, cfg_size, 0, (void *)&p->rx_addr,
+			   sizeof(p->rx_addr)) == -1) {
+			if (errno == EAGAIN || errno == ENOBUFS ||
+			    errno == EINTR)
+				continue;
+			error(1, errno, "sendto");
+		}
+		p->sent++;
+	}
+
+	free(buf);
+	return NULL;
+}
+
+static void *do_rx(void *arg)
+{
+	struct pair *p = arg;
+	char *buf;
+
+	buf = malloc(cfg_size);
+	if (!buf)
+		error(1, ENOMEM, "rx buffer");
+
+	while (!stop) {
+		if (recv(p->rx_fd, buf, cfg_size, 0) == -1) {
+			if (errno == EAGAIN || errno == EINTR)
+				continue;
+			error(1, errno, "recv");
+		}
+		p->received++;
+	}
+
+	free(buf);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long sent = 0, received = 0;
+	struct sockaddr_in addr;
+	double start, elapsed;
+	unsigned int i;
+
+	parse_opts(argc, argv);
+
+	for (i = 0; i < cfg_pairs; i++) {
+		pairs[i].rx_fd = rds_socket(cfg_port + 2 * i,
+					    &pairs[i].rx_addr);
+		pairs[i].tx_fd = rds_socket(cfg_port + 2 * i + 1, &addr);
+	}
+
+	start = now();
+	for (i = 0; i < cfg_pairs; i++) {
+		if (pthread_create(&pairs[i].rx_thread, NULL, do_rx, &pairs[i]) ||
+		    pthread_create(&pairs[i].tx_thread, NULL, do_tx, &pairs[i]))
+			error(1, errno, "pthread_create");
+	}
+
+	sleep(cfg_duration);
+	stop = true;
+
+	for (i = 0; i < cfg_pairs; i++) {
+		pthread_join(pairs[i].tx_thread, NULL);
+		pthread_join(pairs[i].rx_thread, NULL);
+		sent += pairs[i].sent;
+		received += pairs[i].received;
+		close(pairs[i].tx_fd);
+		close(pairs[i].rx_fd);
+	}
+	elapsed = now() - start;
+
+	printf("%lu msgs/s (%lu sent, %lu received)\n",
+	       (unsigned long)(received / elapsed), sent, received);
+
+	return 0;
+}
@@ -0,0 +1,63 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Measure the RDS message rate over the loopback transport against the
+# number of concurrent sender/receiver socket pairs.
+#
+# Send and receive work of each connection path runs on a per-cpu
+# workqueue, so the aggregate rate should scale with the number of pairs
+# instead of flattening out behind a single krdsd thread.
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+ret=0
+
+pair_counts="${PAIR_COUNTS:-1 2 4 8}"
+msg_size="${MSG_SIZE:-64}"
+duration="${DURATION:-3}"
+
+sfx=$(mktemp -u "XXXXXXXX")
+ns="ns-$sfx"
+
+if [ "$(id -u)" -ne 0 ];then
+	echo "SKIP: Need root privileges"
+	exit $ksft_skip
+fi
+
+ip -Version > /dev/null 2>&1
+if [ $? -ne 0 ];then
+	echo "SKIP: Could not run test without ip tool"
+	exit $ksft_skip
+fi
+
+if [ ! -x ./rds_loop_bench ]; then
+	echo "SKIP: rds_loop_bench not built"
+	exit $ksft_skip
+fi
+
+modprobe -q rds
+if [ ! -d /proc/sys/net/rds ]; then
+	echo "SKIP: Could not run test without rds"
+	exit $ksft_skip
+fi
+
+cleanup() {
+	ip netns del "$ns" 2>/dev/null
+}
+
+trap cleanup EXIT
+
+ip netns add "$ns" || exit $ksft_skip
+ip -net "$ns" link set lo up
+
+for pairs in $pair_counts; do
+	printf "%3u pairs: " "$pairs"
+	ip netns exec "$ns" ./rds_loop_bench -n "$pairs" -s "$msg_size" \
+		-t "$duration"
+	if [ $? -ne 0 ]; then
+		ret=1
+		break
+	fi
+done
+
+exit $ret
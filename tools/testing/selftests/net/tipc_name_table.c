@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: GPL-2.0
+/* TIPC name table: bulk withdrawals and concurrent binds of distinct types */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/tipc.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "../kselftest_harness.h"
+
+#define TEST_TYPE	4242
+
+/* Enough withdrawals to need several messages at any MTU */
+#define NR_BINDS	512
+
+#define NR_THREADS	8
+#define NR_ROUNDS	100
+#define NR_INSTANCES	16
+
+static int bind_instance(int fd, __u32 type, __u32 instance)
+{
+	struct sockaddr_tipc addr = {
+		.family = AF_TIPC,
+		.addrtype = TIPC_ADDR_NAMESEQ,
+		.scope = TIPC_CLUSTER_SCOPE,
+		.addr.nameseq.type = type,
+		.addr.nameseq.lower = instance,
+		.addr.nameseq.upper = instance,
+	};
+
+	return bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+/* Connects to the topology server, subscribed to all instances of type */
+static int subscribe(__u32 type, __u32 filter, __u32 timeout)
+{
+	struct sockaddr_tipc srv = {
+		.family = AF_TIPC,
+		.addrtype = TIPC_ADDR_NAME,
+		.addr.name.name.type = TIPC_TOP_SRV,
+		.addr.name.name.instance = TIPC_TOP_SRV,
+	};
+	struct tipc_subscr sub = {
+		.seq.type = type,
+		.seq.lower = 0,
+		.seq.upper = ~0U,
+		.timeout = timeout,
+		.filter = filter,
+	};
+	struct timeval tv = { .tv_sec = 5 };
+	int fd;
+
+	fd = socket(AF_TIPC, SOCK_SEQPACKET, 0);
+	if (fd < 0)
+		return -1;
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) ||
+	    connect(fd, (struct sockaddr *)&srv, sizeof(srv)) ||
+	    send(fd, &sub, sizeof(sub), 0) != sizeof(sub)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* Reads n events, returns how many of them were evt */
+static int read_events(int top, __u32 evt, int n)
+{
+	struct tipc_event ev;
+	int cnt = 0;
+
+	while (n--) {
+		if (recv(top, &ev, sizeof(ev), 0) != sizeof(ev))
+			break;
+		if (ev.event == evt)
+			cnt++;
+	}
+	return cnt;
+}
+
+FIXTURE(bulk)
+{
+	int fd;
+	int top;
+};
+
+FIXTURE_SETUP(bulk)
+{
+	int i;
+
+	self->top = subscribe(TEST_TYPE, TIPC_SUB_PORTS, TIPC_WAIT_FOREVER);
+	ASSERT_GE(self->top, 0);
+
+	self->fd = socket(AF_TIPC, SOCK_RDM, 0);
+	ASSERT_GE(self->fd, 0);
+	for (i = 0; i < NR_BINDS; i++)
+		ASSERT_EQ(bind_instance(self->fd, TEST_TYPE, i), 0);
+
+	ASSERT_EQ(read_events(self->top, TIPC_PUBLISHED, NR_BINDS), NR_BINDS);
+}
+
+FIXTURE_TEARDOWN(bulk)
+{
+	close(self->top);
+	if (self->fd >= 0)
+		close(self->fd);
+}
+
+TEST_F(bulk, unbind_all)
+{
+	struct tipc_event ev;
+
+	ASSERT_EQ(bind(self->fd, NULL, 0), 0);
+	EXPECT_EQ(read_events(self->top, TIPC_WITHDRAWN, NR_BINDS), NR_BINDS);
+	EXPECT_EQ(recv(self->top, &ev, sizeof(ev), MSG_DONTWAIT), -1);
+	EXPECT_EQ(errno, EAGAIN);
+
+	/* The socket can bind the same names again */
+	ASSERT_EQ(bind_instance(self->fd, TEST_TYPE, 0), 0);
+	EXPECT_EQ(read_events(self->top, TIPC_PUBLISHED, 1), 1);
+}
+
+TEST_F(bulk, release)
+{
+	struct tipc_event ev;
+
+	close(self->fd);
+	self->fd = -1;
+	EXPECT_EQ(read_events(self->top, TIPC_WITHDRAWN, NR_BINDS), NR_BINDS);
+	EXPECT_EQ(recv(self->top, &ev, sizeof(ev), MSG_DONTWAIT), -1);
+	EXPECT_EQ(errno, EAGAIN);
+}
+
+static void *bind_loop(void *arg)
+{
+	__u32 type = (unsigned long)arg;
+	int round, i, fd;
+
+	for (round = 0; round < NR_ROUNDS; round++) {
+		fd = socket(AF_TIPC, SOCK_RDM, 0);
+		if (fd < 0)
+			return (void *)-1L;
+		for (i = 0; i < NR_INSTANCES; i++) {
+			if (bind_instance(fd, type, i)) {
+				close(fd);
+				return (void *)-1L;
+			}
+		}
+		/* Alternate between the two bulk withdrawal paths */
+		if (round & 1 && bind(fd, NULL, 0)) {
+			close(fd);
+			return (void *)-1L;
+		}
+		close(fd);
+	}
+	return NULL;
+}
+
+TEST(concurrent_types)
+{
+	pthread_t threads[NR_THREADS];
+	struct tipc_event ev;
+	void *ret;
+	int top;
+	long t;
+
+	for (t = 0; t < NR_THREADS; t++)
+		ASSERT_EQ(pthread_create(&threads[t], NULL, bind_loop,
+					 (void *)(TEST_TYPE + 1 + t)), 0);
+	for (t = 0; t < NR_THREADS; t++) {
+		ASSERT_EQ(pthread_join(threads[t], &ret), 0);
+		EXPECT_EQ(ret, NULL);
+	}
+
+	/* Nothing is left bound: the subscriptions just time out */
+	for (t = 0; t < NR_THREADS; t++) {
+		top = subscribe(TEST_TYPE + 1 + t, TIPC_SUB_SERVICE, 100);
+		ASSERT_GE(top, 0);
+		ASSERT_EQ(recv(top, &ev, sizeof(ev), 0), sizeof(ev));
+		EXPECT_EQ(ev.event, TIPC_SUBSCR_TIMEOUT);
+		close(top);
+	}
+}
+
+TEST_HARNESS_MAIN
@@ -24,6 +24,7 @@
 
 #define TLS_PAYLOAD_MAX_LEN 16384
 #define SOL_TLS 282
+#define TLS_RECORD_TYPE_DATA 23
 
 FIXTURE(tls_basic)
 {
@@ -213,6 +214,73 @@ TEST_F(tls, send_then_sendfile)
 	EXPECT_EQ(recv(self->cfd, buf, st.st_size, MSG_WAITALL), st.st_size);
 }
 
+TEST_F(tls, tx_inflight)
+{
+	struct tls_tx_inflight info;
+	socklen_t len = sizeof(info);
+	char buf[TLS_PAYLOAD_MAX_LEN * 4];
+	char recv_buf[sizeof(buf)];
+
+	if (self->notls)
+		return;
+
+	memset(buf, 0xa5, sizeof(buf));
+	EXPECT_EQ(send(self->fd, buf, sizeof(buf), 0), sizeof(buf));
+	EXPECT_EQ(recv(self->cfd, recv_buf, sizeof(buf), MSG_WAITALL),
+		  sizeof(buf));
+	EXPECT_EQ(memcmp(buf, recv_buf, sizeof(buf)), 0);
+
+	/* Everything was received, so nothing can be left in flight */
+	ASSERT_EQ(getsockopt(self->fd, SOL_TLS, TLS_TX_INFLIGHT, &info, &len),
+		  0);
+	EXPECT_EQ(len, sizeof(info));
+	EXPECT_EQ(info.records, 0);
+	EXPECT_EQ(info.encrypting, 0);
+
+	/* Not available on the receive-only side */
+	EXPECT_EQ(getsockopt(self->cfd, SOL_TLS, TLS_TX_INFLIGHT, &info,
+			     &len), -1);
+	EXPECT_EQ(errno, EINVAL);
+}
+
+TEST_F(tls, tx_parallel)
+{
+	char buf[TLS_PAYLOAD_MAX_LEN * 16];
+	char recv_buf[sizeof(buf)];
+	socklen_t len = sizeof(int);
+	int one = 1, val = 2;
+	int i;
+
+	if (self->notls)
+		return;
+
+	ASSERT_EQ(setsockopt(self->fd, SOL_TLS, TLS_TX_PARALLEL, &val,
+			     sizeof(val)), -1);
+	EXPECT_EQ(errno, EINVAL);
+	ASSERT_EQ(setsockopt(self->fd, SOL_TLS, TLS_TX_PARALLEL, &one,
+			     sizeof(one)), 0);
+	ASSERT_EQ(getsockopt(self->fd, SOL_TLS, TLS_TX_PARALLEL, &val, &len),
+		  0);
+	EXPECT_EQ(len, sizeof(val));
+	EXPECT_EQ(val, 1);
+
+	/* Records encrypted on several CPUs still arrive in order */
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i / TLS_PAYLOAD_MAX_LEN;
+	EXPECT_EQ(send(self->fd, buf, sizeof(buf), 0), sizeof(buf));
+	EXPECT_EQ(recv(self->cfd, recv_buf, sizeof(buf), MSG_WAITALL),
+		  sizeof(buf));
+	EXPECT_EQ(memcmp(buf, recv_buf, sizeof(buf)), 0);
+
+	/* Not available on the receive-only side */
+	EXPECT_EQ(setsockopt(self->cfd, SOL_TLS, TLS_TX_PARALLEL, &one,
+			     sizeof(one)), -1);
+	EXPECT_EQ(errno, EINVAL);
+	EXPECT_EQ(getsockopt(self->cfd, SOL_TLS, TLS_TX_PARALLEL, &val, &len),
+		  -1);
+	EXPECT_EQ(errno, EINVAL);
+}
+
 static void chunked_sendfile(struct __test_metadata *_metadata,
 			     struct _test_data_tls *self,
 			     uint16_t chunk_size,
@@ -1166,6 +1234,62 @@ TEST_F(tls, control_msg)
 	EXPECT_EQ(memcmp(buf, test_str, send_len), 0);
 }
 
+TEST_F(tls, data_then_control_msg)
+{
+	char cbuf[CMSG_SPACE(sizeof(char))];
+	char const *data_str = "test_data";
+	char const *ctrl_str = "test_ctrl";
+	int send_len = 10;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec vec;
+	char buf[64];
+	int one = 1;
+
+	if (self->notls)
+		return;
+
+	/* Let TLS 1.3 try to decrypt straight into the user buffer */
+	ASSERT_EQ(setsockopt(self->cfd, SOL_TLS, TLS_RX_EXPECT_NO_PAD, &one,
+			     sizeof(one)), 0);
+
+	EXPECT_EQ(send(self->fd, data_str, send_len, 0), send_len);
+
+	vec.iov_base = (char *)ctrl_str;
+	vec.iov_len = send_len;
+	memset(&msg, 0, sizeof(struct msghdr));
+	msg.msg_iov = &vec;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof(cbuf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_TLS;
+	cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(char));
+	*CMSG_DATA(cmsg) = 100;
+	msg.msg_controllen = cmsg->cmsg_len;
+	EXPECT_EQ(sendmsg(self->fd, &msg, 0), send_len);
+
+	/* Room for both records, but only the data record is returned,
+	 * whether or not it was decrypted straight into the buffer.
+	 */
+	vec.iov_base = buf;
+	vec.iov_len = sizeof(buf);
+	msg.msg_controllen = sizeof(cbuf);
+	EXPECT_EQ(recvmsg(self->cfd, &msg, 0), send_len);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	ASSERT_NE(cmsg, NULL);
+	EXPECT_EQ(*((unsigned char *)CMSG_DATA(cmsg)), TLS_RECORD_TYPE_DATA);
+	EXPECT_EQ(memcmp(buf, data_str, send_len), 0);
+
+	msg.msg_controllen = sizeof(cbuf);
+	EXPECT_EQ(recvmsg(self->cfd, &msg, 0), send_len);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	ASSERT_NE(cmsg, NULL);
+	EXPECT_EQ(*((unsigned char *)CMSG_DATA(cmsg)), 100);
+	EXPECT_EQ(memcmp(buf, ctrl_str, send_len), 0);
+}
+
 TEST_F(tls, shutdown)
 {
 	char const *test_str = "test_read";
@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Zero-copy sends on AF_UNIX stream sockets (SIOCUNIXZEROCOPY) */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/errqueue.h>
+#include <linux/sockios.h>
+#include <linux/un.h>
+
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "../kselftest_harness.h"
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY	0x4000000
+#endif
+
+#ifndef SIOCUNIXZEROCOPY
+#define SIOCUNIXZEROCOPY (SIOCPROTOPRIVATE + 1)
+#endif
+
+/* Sends of at least this many pages are passed by reference */
+#define ZC_PAGES	16
+
+FIXTURE(unix_zc)
+{
+	int fd[2];
+	size_t len;
+	char *buf;
+	char *rbuf;
+};
+
+FIXTURE_SETUP(unix_zc)
+{
+	int one = 1;
+
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, self->fd), 0);
+	ASSERT_EQ(ioctl(self->fd[0], SIOCUNIXZEROCOPY, &one), 0);
+
+	self->len = ZC_PAGES * sysconf(_SC_PAGESIZE);
+	self->buf = mmap(NULL, self->len, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	ASSERT_NE(self->buf, MAP_FAILED);
+	self->rbuf = malloc(self->len);
+	ASSERT_NE(self->rbuf, NULL);
+	memset(self->buf, 0x5a, self->len);
+}
+
+FIXTURE_TEARDOWN(unix_zc)
+{
+	free(self->rbuf);
+	munmap(self->buf, self->len);
+	close(self->fd[0]);
+	close(self->fd[1]);
+}
+
+/* Reads one completion, returns its code or -errno */
+static int read_completion(int fd, __u32 *lo, __u32 *hi)
+{
+	char control[CMSG_SPACE(sizeof(struct sock_extended_err))];
+	struct sock_extended_err *serr;
+	struct msghdr msg = {};
+	struct cmsghdr *cm;
+
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+		return -errno;
+
+	cm = CMSG_FIRSTHDR(&msg);
+	if (!cm || cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR)
+		return -EPROTO;
+
+	serr = (void *)CMSG_DATA(cm);
+	if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno)
+		return -EPROTO;
+
+	*lo = serr->ee_info;
+	*hi = serr->ee_data;
+	return serr->ee_code;
+}
+
+TEST_F(unix_zc, flag_ignored_without_ioctl)
+{
+	__u32 lo, hi;
+
+	/* fd[1] never enabled zero-copy, the flag has no effect there */
+	ASSERT_EQ(send(self->fd[1], self->buf, self->len, MSG_ZEROCOPY),
+		  self->len);
+	ASSERT_EQ(recv(self->fd[0], self->rbuf, self->len, MSG_WAITALL),
+		  self->len);
+	EXPECT_EQ(read_completion(self->fd[1], &lo, &hi), -EAGAIN);
+}
+
+TEST_F(unix_zc, completion_after_read)
+{
+	struct pollfd pfd = { .fd = self->fd[0] };
+	__u32 lo, hi;
+
+	ASSERT_EQ(send(self->fd[0], self->buf, self->len, MSG_ZEROCOPY),
+		  self->len);
+
+	/* The peer still references the pages */
+	EXPECT_EQ(read_completion(self->fd[0], &lo, &hi), -EAGAIN);
+
+	ASSERT_EQ(recv(self->fd[1], self->rbuf, self->len, MSG_WAITALL),
+		  self->len);
+	EXPECT_EQ(memcmp(self->buf, self->rbuf, self->len), 0);
+
+	ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+	EXPECT_TRUE(pfd.revents & POLLERR);
+
+	EXPECT_EQ(read_completion(self->fd[0], &lo, &hi), 0);
+	EXPECT_EQ(lo, 0);
+	EXPECT_EQ(hi, 0);
+}
+
+TEST_F(unix_zc, small_send_copied)
+{
+	__u32 lo, hi;
+
+	/* Too small to be worth pinning, reported as copied right away */
+	ASSERT_EQ(send(self->fd[0], self->buf, 100, MSG_ZEROCOPY), 100);
+	EXPECT_EQ(read_completion(self->fd[0], &lo, &hi),
+		  SO_EE_CODE_ZEROCOPY_COPIED);
+	EXPECT_EQ(lo, 0);
+	EXPECT_EQ(hi, 0);
+
+	/* Reusing the buffer cannot change what the peer reads */
+	memset(self->buf, 0, 100);
+	ASSERT_EQ(recv(self->fd[1], self->rbuf, 100, MSG_WAITALL), 100);
+	EXPECT_EQ(self->rbuf[0], 0x5a);
+	EXPECT_EQ(self->rbuf[99], 0x5a);
+}
+
+TEST_F(unix_zc, splice_copies_pages)
+{
+	int pfd[2];
+	__u32 lo, hi;
+
+	ASSERT_EQ(pipe(pfd), 0);
+	ASSERT_EQ(fcntl(pfd[1], F_SETPIPE_SZ, self->len), self->len);
+
+	ASSERT_EQ(send(self->fd[0], self->buf, self->len, MSG_ZEROCOPY),
+		  self->len);
+	ASSERT_EQ(splice(self->fd[1], NULL, pfd[1], NULL, self->len, 0),
+		  self->len);
+
+	/* The pipe got its own copy, so the send completed as copied */
+	EXPECT_EQ(read_completion(self->fd[0], &lo, &hi),
+		  SO_EE_CODE_ZEROCOPY_COPIED);
+
+	/* Reusing the buffer cannot change what the pipe reader sees */
+	memset(self->buf, 0, self->len);
+	ASSERT_EQ(read(pfd[0], self->rbuf, self->len), self->len);
+	EXPECT_EQ(self->rbuf[0], 0x5a);
+	EXPECT_EQ(self->rbuf[self->len - 1], 0x5a);
+
+	close(pfd[0]);
+	close(pfd[1]);
+}
+
+TEST_F(unix_zc, plain_send_no_completion)
+{
+	__u32 lo, hi;
+
+	ASSERT_EQ(send(self->fd[0], self->buf, self->len, 0), self->len);
+	ASSERT_EQ(recv(self->fd[1], self->rbuf, self->len, MSG_WAITALL),
+		  self->len);
+	EXPECT_EQ(read_completion(self->fd[0], &lo, &hi), -EAGAIN);
+}
+
+TEST_HARNESS_MAIN
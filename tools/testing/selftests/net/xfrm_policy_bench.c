@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Measure the rate of xfrm policy lookups.
+ *
+ * Sends small UDP datagrams from an unconnected socket, cycling through
+ * a range of IPv4 destinations.  Every sendto() does its own route and
+ * xfrm policy lookup, so for packets that go out a dummy device the
+ * send rate tracks the policy lookup cost.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <error.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static struct in_addr	cfg_dst;
+static unsigned int	cfg_ndst	= 256;
+static unsigned int	cfg_duration	= 3;
+static uint16_t		cfg_port	= 9;
+
+static void usage(const char *prog)
+{
+	error(1, 0, "usage: %s -D <first dst> [-n <num dsts>] [-t <secs>] [-p <port>]",
+	      prog);
+}
+
+static void parse_opts(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "D:n:p:t:")) != -1) {
+		switch (c) {
+		case 'D':
+			if (inet_pton(AF_INET, optarg, &cfg_dst) != 1)
+				error(1, 0, "ipv4 parse error: %s", optarg);
+			break;
+		case 'n':
+			cfg_ndst = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			cfg_port = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			cfg_duration = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!cfg_dst.s_addr || !cfg_ndst || !cfg_duration)
+		usage(argv[0]);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		error(1, errno, "clock_gettime");
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long sent = 0, failed = 0;
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+	};
+	double start, elapsed;
+	char buf[16] = {};
+	unsigned int i;
+	int fd;
+
+	parse_opts(argc, argv);
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd == -1)
+		error(1, errno, "socket");
+
+	addr.sin_port = htons(cfg_port);
+	start = now();
+
+	do {
+		for (i = 0; i < cfg_ndst; i++) {
+			addr.sin_addr.s_addr = htonl(ntohl(cfg_dst.s_addr) + i);
+			if (sendto(fd, buf, sizeof(buf), 0,
+				   (void *)&addr, sizeof(addr)) == -1)
+				failed++;
+			else
+				sent++;
+		}
+		elapsed = now() - start;
+	} while (elapsed < cfg_duration);
+
+	printf("%lu lookups/s (%lu failed)\n",
+	       (unsigned long)((sent + failed) / elapsed), failed);
+
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,85 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Benchmark inexact xfrm policy lookups against the number of policies.
+#
+# A catch-all "any:any" policy with a good priority matches all traffic,
+# while N worse priority saddr:daddr policies, one per TCP port, share
+# the inexact tree node the traffic falls into but never match it (the
+# traffic is UDP).  The lookup rate should not degrade with N, since no
+# candidate list whose best priority is already beaten gets walked.
+#
+# The rate is measured by xfrm_policy_bench, which does one route and
+# policy lookup per sendto() over a dummy device.
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+ret=0
+
+counts="${POLICY_COUNTS:-0 100 1000 10000}"
+duration="${DURATION:-3}"
+
+sfx=$(mktemp -u "XXXXXXXX")
+ns="ns-$sfx"
+
+if [ "$(id -u)" -ne 0 ];then
+	echo "SKIP: Need root privileges"
+	exit $ksft_skip
+fi
+
+ip -Version > /dev/null 2>&1
+if [ $? -ne 0 ];then
+	echo "SKIP: Could not run test without ip tool"
+	exit $ksft_skip
+fi
+
+if [ ! -x ./xfrm_policy_bench ]; then
+	echo "SKIP: xfrm_policy_bench not built"
+	exit $ksft_skip
+fi
+
+cleanup() {
+	ip netns del "$ns" 2>/dev/null
+}
+
+trap cleanup EXIT
+
+ip netns add "$ns" || exit $ksft_skip
+ip -net "$ns" link add dummy0 type dummy || exit $ksft_skip
+ip -net "$ns" link set dummy0 up
+ip -net "$ns" addr add 10.0.0.1/8 dev dummy0
+
+# Keep everything but host routes in the inexact tree.
+ip -net "$ns" xfrm policy set hthresh4 32 32
+
+add_policies() {
+	local count=$1
+	local i
+
+	ip -net "$ns" xfrm policy flush
+	{
+		echo "xfrm policy add src 0.0.0.0/0 dst 0.0.0.0/0 dir out priority 100 action allow"
+		for i in $(seq 1 "$count"); do
+			echo "xfrm policy add src 10.0.0.0/16 dst 10.1.0.0/16 proto tcp dport $i dir out priority 2000 action allow"
+		done
+	} | ip -net "$ns" -batch -
+}
+
+for count in $counts; do
+	add_policies "$count"
+	if [ $? -ne 0 ]; then
+		echo "FAIL: could not add $count policies"
+		ret=1
+		break
+	fi
+
+	printf "%6u policies: " "$count"
+	ip netns exec "$ns" ./xfrm_policy_bench -D 10.1.0.1 -n 256 \
+		-t "$duration"
+	if [ $? -ne 0 ]; then
+		ret=1
+		break
+	fi
+done
+
+exit $ret
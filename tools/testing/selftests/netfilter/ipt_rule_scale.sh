@@ -0,0 +1,179 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Measure iptables packet rate against the number of rules in a chain.
+#
+# pktgen in ns1 sends UDP packets over a veth pair to ns2, where the
+# raw PREROUTING chain holds N rules for other destination addresses
+# followed by a catch-all DROP.  The packet rate is read back from the
+# DROP rule counter.  Exact address rules are indexed when the table is
+# loaded, so the rate of the "exact" ruleset should stay roughly flat as
+# N grows while the "prefix" ruleset (same rules, /31 masks) degrades
+# linearly.
+#
+# Before measuring, check that a matching rule in the middle of a large
+# indexed run still wins over the rules after it.
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+ret=0
+
+rule_counts="${RULE_COUNTS:-0 10 100 1000 10000}"
+duration="${DURATION:-3}"
+
+sfx=$(mktemp -u "XXXXXXXX")
+ns1="ns1-$sfx"
+ns2="ns2-$sfx"
+
+iptables-restore --version > /dev/null 2>&1
+if [ $? -ne 0 ];then
+	echo "SKIP: Could not run test without iptables-restore"
+	exit $ksft_skip
+fi
+
+ip -Version > /dev/null 2>&1
+if [ $? -ne 0 ];then
+	echo "SKIP: Could not run test without ip tool"
+	exit $ksft_skip
+fi
+
+modprobe -q pktgen
+if [ ! -d /proc/net/pktgen ]; then
+	echo "SKIP: Could not run test without pktgen"
+	exit $ksft_skip
+fi
+
+cleanup() {
+	ip netns pids "$ns1" 2>/dev/null | xargs -r kill 2>/dev/null
+	ip netns del "$ns1" 2>/dev/null
+	ip netns del "$ns2" 2>/dev/null
+}
+
+trap cleanup EXIT
+
+setup() {
+	ip netns add "$ns1" || return $ksft_skip
+	ip netns add "$ns2" || return $ksft_skip
+
+	ip link add veth0 netns "$ns1" type veth peer name veth1 netns "$ns2" \
+		|| return $ksft_skip
+
+	ip -net "$ns1" link set veth0 up
+	ip -net "$ns2" link set veth1 up
+	ip -net "$ns1" addr add 10.0.1.1/24 dev veth0
+	ip -net "$ns2" addr add 10.0.1.2/24 dev veth1
+
+	if [ ! -d /proc/net/pktgen ] || \
+	   ! ip netns exec "$ns1" test -w /proc/net/pktgen/pgctrl; then
+		echo "SKIP: pktgen not available in network namespace"
+		return $ksft_skip
+	fi
+
+	return 0
+}
+
+pg() {
+	ip netns exec "$ns1" sh -c "echo '$2' > /proc/net/pktgen/$1"
+}
+
+pktgen_start() {
+	local mac
+
+	mac=$(ip -net "$ns2" link show veth1 | awk '/link\/ether/ { print $2 }')
+
+	pg kpktgend_0 "rem_device_all"
+	pg kpktgend_0 "add_device veth0"
+	pg veth0 "count 0"
+	pg veth0 "delay 0"
+	pg veth0 "pkt_size 60"
+	pg veth0 "clone_skb 0"
+	pg veth0 "dst 10.0.1.2"
+	pg veth0 "dst_mac $mac"
+	pg veth0 "udp_dst_min 9"
+	pg veth0 "udp_dst_max 9"
+
+	ip netns exec "$ns1" sh -c "echo start > /proc/net/pktgen/pgctrl" &
+	pktgen_pid=$!
+}
+
+pktgen_stop() {
+	ip netns exec "$ns1" sh -c "echo stop > /proc/net/pktgen/pgctrl"
+	wait $pktgen_pid 2>/dev/null
+}
+
+# load_rules <count> <mask> [<position of the rule matching the packet>]
+load_rules() {
+	local count=$1
+	local mask=$2
+	local hit=$3
+	local i
+
+	{
+		echo "*raw"
+		echo ":PREROUTING ACCEPT [0:0]"
+		for i in $(seq 1 "$count"); do
+			if [ "$i" = "$hit" ]; then
+				echo "-A PREROUTING -d 10.0.1.2/32 -j DROP"
+			fi
+			echo "-A PREROUTING -d 198.18.$((i / 250)).$((i % 250 + 2))/$mask -j DROP"
+		done
+		echo "-A PREROUTING -j DROP"
+		echo "COMMIT"
+	} | ip netns exec "$ns2" iptables-restore
+}
+
+# Packet count of rule <n> of the raw PREROUTING chain
+rule_packets() {
+	ip netns exec "$ns2" iptables -t raw -L PREROUTING -v -n -x | \
+		awk -v n="$1" 'NR == n + 2 { print $1 }'
+}
+
+test_first_match() {
+	local hit last
+
+	load_rules 1000 32 500
+	pktgen_start
+	sleep 1
+	pktgen_stop
+
+	hit=$(rule_packets 500)
+	last=$(rule_packets 1002)
+
+	if [ -z "$hit" ] || [ "$hit" -eq 0 ] || [ "$last" -ne 0 ]; then
+		echo "FAIL: matching rule 500 saw ${hit:-?} packets, final rule saw ${last:-?}"
+		return 1
+	fi
+
+	echo "PASS: first match preserved in indexed rule run"
+	return 0
+}
+
+measure() {
+	local mask=$1
+	local name=$2
+	local count pkts
+
+	for count in $rule_counts; do
+		load_rules "$count" "$mask"
+		pktgen_start
+		sleep "$duration"
+		pktgen_stop
+
+		pkts=$(rule_packets $((count + 1)))
+		printf "%-8s %6u rules: %10u pps\n" "$name" "$count" \
+			$((pkts / duration))
+	done
+}
+
+setup
+ret=$?
+if [ $ret -ne 0 ]; then
+	exit $ret
+fi
+
+test_first_match || ret=1
+
+measure 32 exact
+measure 31 prefix
+
+exit $ret